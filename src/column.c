@@ -0,0 +1,133 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use 
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative 
+* use is non-commercial in nature.  Proper attribution        
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome 
+* comparison with feature frequency profiles (FFP) and 
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "hash.h"
+#include "utils.h"
+#include "profile.h"
+#include "column.h"
+
+
+
+/** A count and its column, see columnProfiles */
+
+typedef struct {
+    uint32_t col;	/**< Column of the count */
+    uint32_t pos;	/**< Position of the key in its row */
+    unsigned val;	/**< The count */
+} ENTRY;
+
+
+
+static int cmpEntry(const void *a, const void *b)
+{
+    const ENTRY *x = (const ENTRY *) a;
+    const ENTRY *y = (const ENTRY *) b;
+
+    if (x->col != y->col)
+	return x->col < y->col ? -1 : 1;
+    return x->pos < y->pos ? -1 : x->pos > y->pos;
+}
+
+
+
+/**
+ * Columnizes keyed FFP rows in memory
+ *
+ * The keys of all rows are numbered in a hash table exactly
+ * as ffpcol numbers the keys of its input: invalid keys are
+ * dropped and the columns are ordered by the position of
+ * their keys in the table.  A key given twice in a row keeps
+ * its last count, like the dense row ffpcol prints.
+ *
+ * @param keys The keys of each row
+ * @param vals The counts of the keys of each row
+ * @param n The number of keys of each row
+ * @param rows Number of rows
+ * @param mode A hash_modes value
+ * @param isClass Class the keys, ffpcol without -d
+ * @return The rows as count profiles, values in double precision
+ */
+
+PROFILES *columnProfiles(char ***keys, unsigned **vals, unsigned *n,
+			 uint32_t rows, int mode, bool isClass)
+{
+    HASHTABLE *h = hashCreate(mode, isClass, NULL);
+    PROFILES *p = (PROFILES *) chkcalloc(sizeof(PROFILES), 1);
+    ENTRY *e = NULL;
+    unsigned *ref, *order, *dense;
+    unsigned cols = 0;
+    uint64_t nnz = 0, total = 0, k;
+    uint32_t r, i, m;
+
+    for (r = 0; r < rows; r++)
+	total += n[r];
+
+    p->rows = rows;
+    p->index = (uint64_t *) chkmalloc(sizeof(uint64_t), rows + 1);
+    p->col = (uint32_t *) chkmalloc(sizeof(uint32_t), total + 1);
+    p->val = (double *) chkmalloc(sizeof(double), total + 1);
+
+    for (r = 0; r < rows; r++) {
+	p->index[r] = nnz;
+	for (i = 0; i < n[r]; i++) {
+	    if ((ref = hashRef(h, keys[r][i])) == NULL)	// invalid key
+		continue;
+	    if (*ref == 0)
+		*ref = ++cols;
+	    p->col[nnz] = *ref - 1;
+	    p->val[nnz++] = vals[r][i];
+	}
+    }
+    p->index[rows] = nnz;
+    p->cols = cols;
+
+    // columns are numbered by position in the hash table
+    hashValues(h, &order);
+    dense = (unsigned *) chkmalloc(sizeof(unsigned), cols + 1);
+    for (i = 0; i < cols; i++)
+	dense[order[i] - 1] = i;
+    free(order);
+    hashDestroy(h);
+
+    // sort each row by column, the last of a repeated key wins
+    for (r = 0, nnz = 0; r < rows; r++) {
+	m = profileLength(p, r);
+	if ((e = (ENTRY *) realloc(e, sizeof(ENTRY) * (m + 1))) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+	for (i = 0, k = p->index[r]; i < m; i++, k++) {
+	    e[i].col = dense[p->col[k]];
+	    e[i].pos = i;
+	    e[i].val = (unsigned) p->val[k];
+	}
+	qsort(e, m, sizeof(ENTRY), cmpEntry);
+	p->index[r] = nnz;
+	for (i = 0; i < m; i++) {
+	    if (i + 1 < m && e[i + 1].col == e[i].col)
+		continue;
+	    p->col[nnz] = e[i].col;
+	    p->val[nnz++] = e[i].val;
+	}
+    }
+    p->index[rows] = nnz;
+
+    free(e);
+    free(dense);
+    return p;
+}
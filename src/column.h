@@ -0,0 +1,28 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use 
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative 
+* use is non-commercial in nature.  Proper attribution        
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome 
+* comparison with feature frequency profiles (FFP) and 
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+/* _COLUMN_H_ */
+#ifndef _COLUMN_H_
+#define _COLUMN_H_
+#include <stdint.h>
+#include <stdbool.h>
+#include "profile.h"
+
+/* prototypes */
+PROFILES *columnProfiles(char ***keys, unsigned **vals, unsigned *n,
+			 uint32_t rows, int mode, bool isClass);
+
+#endif				/* _COLUMN_H_ */
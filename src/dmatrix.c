@@ -0,0 +1,189 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#define _POSIX_C_SOURCE  200809L  // To use fseeko and mmap
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+#include "dmatrix.h"
+
+/**
+ * Binary distance matrix header
+ *
+ * The header is followed by n names of namelen bytes and
+ * the n(n-1)/2 entries above the diagonal (double or float)
+ * padded to an 8 byte boundary, so matrices can be
+ * concatenated.  All values are in host byte order.
+ */
+typedef struct {
+    char magic[8];	/**< DMATRIX_MAGIC */
+    uint32_t n;		/**< Number of taxa */
+    uint32_t valsize;	/**< Size of an entry, 4 or 8 bytes */
+    uint32_t namelen;	/**< DMATRIX_NAMELEN */
+    uint32_t reserved;	/**< Zero */
+} DMATRIX_HEADER;
+
+#define padded(n) (((n) + 7) & ~(size_t) 7) /**< Rounds n up to a multiple of 8 */
+#define entryBytes(n,valsize) ((size_t) (n) * ((n) - 1) / 2 * (valsize)) /**< Size of the entries */
+
+
+/**
+ * Writes the header and taxa names of a binary distance matrix
+ *
+ * The caller then writes the entries above the diagonal
+ * row by row and finishes with writeMatrixEnd.
+ *
+ * @param fp A file pointer opened for writing
+ * @param n Number of taxa
+ * @param valsize Size of each entry, sizeof(double) or sizeof(float)
+ * @param names Taxa names, or NULL to name the taxa by row number
+ * @return None
+ */
+
+void writeMatrixHeader(FILE * fp, uint32_t n, uint32_t valsize,
+		       char **names)
+{
+    DMATRIX_HEADER h;
+    char name[DMATRIX_NAMELEN];
+    uint32_t i;
+
+    memset(&h, 0, sizeof(h));
+    strcpy(h.magic, DMATRIX_MAGIC);
+    h.n = n;
+    h.valsize = valsize;
+    h.namelen = DMATRIX_NAMELEN;
+    fwrite(&h, sizeof(h), 1, fp);
+
+    for (i = 0; i < n; i++) {
+	memset(name, 0, sizeof(name));
+	if (names)
+	    strncpy(name, names[i], DMATRIX_NAMELEN - 1);
+	else
+	    snprintf(name, sizeof(name), "%u", i + 1);
+	fwrite(name, 1, DMATRIX_NAMELEN, fp);
+    }
+}
+
+
+
+/**
+ * Finishes a binary distance matrix
+ *
+ * @param fp A file pointer opened for writing
+ * @param n Number of taxa
+ * @param valsize Size of each entry, sizeof(double) or sizeof(float)
+ * @return None
+ */
+
+void writeMatrixEnd(FILE * fp, uint32_t n, uint32_t valsize)
+{
+    char pad[8] = { 0 };
+    size_t bytes = entryBytes(n, valsize);
+
+    fwrite(pad, 1, padded(bytes) - bytes, fp);
+    if (ferror(fp))
+	fatal_msg("Error writing distance matrix: %s\n", strerror(errno));
+}
+
+
+
+/**
+ * Reads the next binary distance matrix from a stream
+ *
+ * When fp is a regular file the names and entries are
+ * mapped into memory rather than read, and fp is moved
+ * past the matrix.  Otherwise, as with a pipe, they are
+ * read into memory.
+ *
+ * @param fp A file pointer positioned at a matrix header
+ * @return A pointer to the matrix
+ */
+
+DMATRIX *readMatrix(FILE * fp)
+{
+    DMATRIX_HEADER h;
+    DMATRIX *m;
+    struct stat st;
+    off_t start;
+    size_t names, size, skip;
+    char *data;
+
+    if (fread(&h, sizeof(h), 1, fp) != 1
+	|| strncmp(h.magic, DMATRIX_MAGIC, sizeof(h.magic)))
+	fatal_msg("Not a binary distance matrix.\n");
+
+    if (h.valsize != sizeof(float) && h.valsize != sizeof(double))
+	fatal_msg("Unknown distance matrix value size %u.\n", h.valsize);
+
+    if (h.namelen != DMATRIX_NAMELEN || !h.n)
+	fatal_msg("Invalid binary distance matrix.\n");
+
+    names = (size_t) h.n * DMATRIX_NAMELEN;
+    size = names + padded(entryBytes(h.n, h.valsize));
+
+    m = (DMATRIX *) chkcalloc(sizeof(DMATRIX), 1);
+    m->n = h.n;
+
+    start = ftello(fp);
+    if (start != -1 && !(start % 8) && !fstat(fileno(fp), &st)
+	&& S_ISREG(st.st_mode)) {
+	if ((size_t) start + size > (size_t) st.st_size)
+	    fatal_msg("Truncated binary distance matrix.\n");
+	skip = start % sysconf(_SC_PAGESIZE);
+	m->mapsize = skip + size;
+	if ((m->map = mmap(NULL, m->mapsize, PROT_READ, MAP_SHARED,
+			   fileno(fp), start - skip)) == MAP_FAILED)
+	    fatal_msg("%s\n", strerror(errno));
+	data = (char *) m->map + skip;
+	if (fseeko(fp, start + size, SEEK_SET))
+	    fatal_msg("%s\n", strerror(errno));
+    } else {
+	m->buf = chkmalloc(1, size);
+	if (fread(m->buf, 1, size, fp) != size)
+	    fatal_msg("Truncated binary distance matrix.\n");
+	data = m->buf;
+    }
+
+    m->names = data;
+    if (h.valsize == sizeof(float))
+	m->fval = (float *) (data + names);
+    else
+	m->val = (double *) (data + names);
+
+    return m;
+}
+
+
+
+/**
+ * Releases a matrix read with readMatrix
+ *
+ * @param m Matrix to release
+ * @return None
+ */
+
+void freeMatrix(DMATRIX * m)
+{
+    if (m->map)
+	munmap(m->map, m->mapsize);
+    free(m->buf);
+    free(m);
+}
@@ -0,0 +1,57 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+/* _DMATRIX_H_ */
+#ifndef _DMATRIX_H_
+#define _DMATRIX_H_
+#include <stdio.h>
+#include <stdint.h>
+
+#define DMATRIX_MAGIC "FFPDM01" /**< Magic string at the start of a binary distance matrix */
+#define DMATRIX_NAMELEN 56 /**< Bytes stored for each taxa name, including the terminating NUL */
+
+/**
+ * A condensed symmetric distance matrix with taxa names.
+ *
+ * Only the entries above the diagonal are stored, row by
+ * row, so entry (i,j) with i < j is val[condensedIndex(n,i,j)].
+ * Single precision matrices keep their entries in fval
+ * instead and leave val NULL, see matrixValue.
+ * When the matrix was read from a regular file the arrays
+ * point into a mapping of the file and map is non-NULL.
+ */
+typedef struct {
+    uint32_t n;		/**< Number of taxa */
+    char *names;	/**< n NUL padded names of DMATRIX_NAMELEN bytes */
+    double *val;	/**< Entries above the diagonal */
+    float *fval;	/**< Entries above the diagonal in single precision */
+    void *map;		/**< Start of the mapping, or NULL */
+    size_t mapsize;	/**< Size of the mapping in bytes */
+    void *buf;		/**< Names and entries read from a stream, or NULL */
+} DMATRIX;
+
+#define condensedIndex(n,i,j) ((size_t) (i) * (2 * (size_t) (n) - (i) - 1) / 2 + (j) - (i) - 1) /**< Index of entry (i,j), i < j */
+#define matrixName(m,i) ((m)->names + (size_t) (i) * DMATRIX_NAMELEN) /**< Name of taxon i */
+#define matrixValue(m,k) ((m)->fval ? (double) (m)->fval[(k)] : (m)->val[(k)]) /**< Entry k above the diagonal */
+
+/* prototypes */
+void writeMatrixHeader(FILE * fp, uint32_t n, uint32_t valsize,
+		       char **names);
+void writeMatrixEnd(FILE * fp, uint32_t n, uint32_t valsize);
+DMATRIX *readMatrix(FILE * fp);
+void freeMatrix(DMATRIX * m);
+
+#endif				/* _DMATRIX_H_ */
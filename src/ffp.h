@@ -0,0 +1,87 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+/* _FFP_H_ */
+#ifndef _FFP_H_
+#define _FFP_H_
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * libffp, the C interface of the FFP pipeline
+ *
+ *   ffpry FILE... | ffpcol | ffprwn | ffpjsd -p NAMES | ffptree
+ *
+ * for programs that build trees in process.  A counter counts the
+ * features of nucleotide FASTA text as ffpry, a set puts the
+ * profiles of several counts in columns and normalizes them as
+ * ffpcol and ffprwn, ffpDistances is the matrix of ffpjsd and
+ * ffpTree builds the tree of ffptree.  Every counter and set is a
+ * context of its own, so different threads may use different ones
+ * at the same time.  The trees are built one at a time.
+ *
+ * A call that fails returns NULL, -1 or 0 as documented in
+ * libffp.c, and ffpError gives its message; the process goes
+ * on.  Only running out of memory in the threads of ffptree -T
+ * ends the process.  Warnings are printed on standard error as
+ * in the programs.
+ */
+
+/* The library is built with hidden symbols, see Makefile.am, so
+ * only the functions declared here are exported. */
+#if defined(__GNUC__) && __GNUC__ >= 4
+#define FFP_API __attribute__ ((visibility ("default")))
+#else
+#define FFP_API
+#endif
+
+typedef struct ffp_counter FFP_COUNTER;	/**< Counts the features of FASTA text */
+typedef struct ffp_set FFP_SET;	/**< Profiles put in columns */
+
+/* prototypes */
+FFP_API FFP_COUNTER *ffpCounterNew(int length, bool ry, bool reverse,
+				   bool multiple);
+FFP_API int ffpCount(FFP_COUNTER * c, const char *buf, size_t n);
+FFP_API int ffpCountEnd(FFP_COUNTER * c);
+FFP_API int ffpProfile(FFP_COUNTER * c, char ***keys, unsigned **vals,
+		       unsigned *n);
+FFP_API void ffpCounterFree(FFP_COUNTER * c);
+
+FFP_API FFP_SET *ffpSetNew(bool ry);
+FFP_API uint32_t ffpSetAdd(FFP_SET * s, char **keys, unsigned *vals,
+			   unsigned n);
+FFP_API int ffpNormalize(FFP_SET * s, bool largest, int precision);
+FFP_API int64_t ffpSetRow(FFP_SET * s, uint32_t row,
+			  const uint32_t ** cols, const double **vals);
+FFP_API double *ffpDistances(FFP_SET * s);
+FFP_API void ffpSetFree(FFP_SET * s);
+
+FFP_API int ffpTree(const double *D, char **names, uint32_t n,
+		    int precision, const char *options, FILE * tree,
+		    FILE * progress);
+FFP_API char *ffpNewick(const double *D, char **names, uint32_t n,
+			int precision, const char *options);
+FFP_API const char *ffpError(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif				/* _FFP_H_ */
@@ -56,6 +56,7 @@
 
 char PROG_NAME[FILENAME_MAX];
 
+static void initHash(HASH *);
 static void parseFile(HASH *, FILE *);
 static void loopFeatureList(HASH * h, FILE * fp);
 static void loopRaw(HASH * h, FILE * fp);
@@ -65,6 +66,7 @@ int Length = DEFAULT_WORD_LENGTH;
 				/**< Feature length to use if not specified by opt -l */
 int Buffsize = CHAR_BUFFER_SIZE;/**< File input buffer, increase value for larger genomes. opt -b can be used to change this value */
 int maxWordSize = MAX_WORD_SIZE;
+int threads = 1;     /**< -T Files counted at the same time */
 
 
 bool wflag = false;	     /**<-w Supply a mismatch character mask */
@@ -92,6 +94,7 @@ length 4.\n\
 \t-q, --quiet\n\
 \t-d, --disable-classes\n\
 \t-m, --multiple\n\
+\t-T INT, --threads=INT\n\
 \t-h, --help\n\
 \t-v, --version\n\n\
 Copyright (c) %s\n\
@@ -102,6 +105,7 @@ int main(int argc, char **argv)
 {
     int opt;
     FILE *fp;
+    RNG rng;
     HASH h;
 
     int option_index = 0;
@@ -116,13 +120,14 @@ int main(int argc, char **argv)
 	{"quiet", no_argument, 0, 'q'},
 	{"help", no_argument, 0, 'h'},
 	{"multiple", no_argument, 0, 'm'},
+	{"threads", required_argument, 0, 'T'},
 	{"version", no_argument, 0, 'v'},
 	{0, 0, 0, 0}
     };
 
   initSignalHandlers();
 
-    while ((opt = getopt_long(argc, argv, "l:dw:z:s:qf:h?mv",
+    while ((opt = getopt_long(argc, argv, "l:dw:z:s:qf:h?mvT:",
 			      long_options, &option_index)) != -1)
 
 	switch (opt) {
@@ -154,6 +159,11 @@ int main(int argc, char **argv)
 	case 'm':
 	    mflag = !mflag;
 	    break;
+	case 'T':
+	    threads = atoi(optarg);
+	    if (threads < 1)
+		fatal_msg("Number of threads must be at least 1\n");
+	    break;
 	case 'h':
 	    printUsageStr();
 	    exit(EXIT_SUCCESS);
@@ -177,9 +187,9 @@ int main(int argc, char **argv)
 	    fatal_msg("%d: Max Word size is : %d",Length,maxWordSize);
 
     if (sflag)
-	srand((unsigned) sflagN);
+	rngInit(&rng, (unsigned) sflagN);
     else
-	srand((unsigned) time(NULL)*getpid());
+	rngInit(&rng, (unsigned) time(NULL) * getpid());
 
 
     if (wflag) {
@@ -195,23 +205,20 @@ int main(int argc, char **argv)
 	while (zflagN > Length - 1)
 	    zflagN--;
 	weightVector = (char *) malloc(sizeof(char) * (Length + 1));
-	randweight(weightVector, Length, zflagN);
+	randweight(weightVector, Length, zflagN, &rng);
 	if (!qflag)
 	    warn_msg("USING FEATURE MASK: %s\n", weightVector);
     }
-    // Initialize the rolling hash
-    // reverse is not applicable, therefore 0
-    init(&h, (zflag || wflag), amino, !dflag, 0, Length);
-
-
-    // If provided a feature list read it and store in hash
-
-    if (fflag) 
-	parseFeatureList(&h,fvalue,Length,amino);
+    initHash(&h);
 
 // Must now process file arguments
     argv += optind;
 
+    if (threads > 1 && argc - optind > 1) {
+	countFiles(&h, argv, argc - optind, threads, initHash, parseFile);
+	return EXIT_SUCCESS;
+    }
+
     do {
 	fp = stdin;
 	if (*argv) {
@@ -242,6 +249,26 @@ int main(int argc, char **argv)
 
 
 
+// Initializes a hash with the options and the feature list of -f
+
+static void initHash(HASH * h)
+{
+    // Initialize the rolling hash
+    // reverse is not applicable, therefore 0
+    init(h, weightVector, amino, !dflag, 0, Length);
+    h->multiple = mflag;
+    h->list = fflag;
+
+
+    // If provided a feature list read it and store in hash
+
+    if (fflag) 
+	parseFeatureList(h,fvalue,Length,amino);
+}
+
+
+
+
 /**
  *
  *  Parses FASTA format FNA file
@@ -305,7 +332,6 @@ static void loopFeatureList(HASH * h, FILE * fp)
 
     printFeatures(h);
     free(buf);
-    freeHash(h);
 }
 
 
@@ -346,4 +372,3 @@ static void loopRaw(HASH * h, FILE * fp)
     freeHash(h);
     free(buf);
 }
-
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "vstring.h"
 #include "utils.h"
+#include "profile.h"
 #include "sighandle.h"
 #include "../config.h"
 
@@ -34,8 +35,11 @@ char PROG_NAME[] = "ffpboot";
 #define DEFAULT_JACK 0.36787944117144232159 /**< Default Jackknife probability of deletion: 1/exp(1) */
 #define INIT_ROWSIZE 10
 
-void bootstrap(FILE * fp);
-void jacknife(FILE * fp, float);
+unsigned *readColumnar(FILE * fp, int *rows, unsigned *cols);
+void bootstrap(unsigned *vals, int rows, unsigned cols, RNG * rng);
+void jacknife(unsigned *vals, int rows, unsigned cols, float, RNG * rng);
+PROFILES *bootstrapProfiles(PROFILES * p, RNG * rng);
+PROFILES *jacknifeProfiles(PROFILES * p, float del, RNG * rng);
 
 char usage_str[] = "Usage: %s [OPTIONS] ... [FILE] ...\n\
 This program performs bootstrap permutations of the FFP vector\n\n\
@@ -43,7 +47,11 @@ Given no options, the defeault behavior of the program is to\n\
 calculate a bootstrap permutation.\n\
 \t-j, --jackknife\n\
 \t-p PROB, --delete-prob=PROB\n\
+\t-n N, --replicates=N\n\
 \t-s INT, --rand-seed=INT\n\
+\t-S, --sparse\tPrint sparse FFPs\n\
+\t-x, --binary\tPrint binary FFPs\n\
+\t-d, --dense\tPrint dense FFPs\n\
 \t-v, --version\n\
 \t-h, --help\n\n\
 Copyright (c) %s\n\
@@ -58,6 +66,15 @@ int main(int argc, char **argv)
     char jflag = 0;
     char sflag = 0;
     unsigned svalue = 0;
+    unsigned seed;
+    int nvalue = 1;
+    unsigned long replicate = 0;
+    RNG rng;
+    unsigned *vals;
+    PROFILES *p, *q;
+    int format, oformat = -1;
+    int rows;
+    unsigned cols;
     float pvalue = DEFAULT_JACK;
     int option_index = 0;
 
@@ -65,14 +82,18 @@ int main(int argc, char **argv)
 	{"help", no_argument, 0, 'h'},
 	{"delete-prob", required_argument, 0, 'p'},
 	{"jackknife", no_argument, 0, 'j'},
+	{"replicates", required_argument, 0, 'n'},
 	{"rand-seed", required_argument, 0, 's'},
-	{"version", no_argument, 0, 's'},
+	{"sparse", no_argument, 0, 'S'},
+	{"binary", no_argument, 0, 'x'},
+	{"dense", no_argument, 0, 'd'},
+	{"version", no_argument, 0, 'v'},
 	{0, 0, 0, 0}
     };
 
     initSignalHandlers();
 
-    while ((opt = getopt_long(argc, argv, "jp:s:vh",
+    while ((opt = getopt_long(argc, argv, "jp:n:s:Sxdvh",
 			      long_options, &option_index)) != -1)
 
 	switch (opt) {
@@ -82,10 +103,22 @@ int main(int argc, char **argv)
 	case 'j':
 	    jflag = 1;
 	    break;
+	case 'n':
+	    nvalue = atoi(optarg);
+	    break;
 	case 's':
 	    sflag = 1;
 	    svalue = atoi(optarg);
 	    break;
+	case 'S':
+	    oformat = PROFILE_SPARSE;
+	    break;
+	case 'x':
+	    oformat = PROFILE_BINARY;
+	    break;
+	case 'd':
+	    oformat = PROFILE_DENSE;
+	    break;
 	case 'v':
 	    printVersion();
 	    exit(EXIT_SUCCESS);
@@ -101,15 +134,18 @@ int main(int argc, char **argv)
 	}
 
     if (sflag)
-	srand((unsigned) svalue);
+	seed = svalue;
     else
-	srand((unsigned) time(NULL) * getpid());
+	seed = (unsigned) time(NULL) * getpid();
 
 
     if (pvalue > 1 || pvalue < 0) {
 	fatal_msg("Jacknife deletion probability must be betwen 0 and 1\n");
     }
 
+    if (nvalue < 1)
+	fatal_msg("Number of replicates must be at least 1\n");
+
 
 
     
@@ -132,15 +168,54 @@ int main(int argc, char **argv)
 	    printErrorUsageStr();
 
 	if (!isRegularFile(fp)) 
-	    fp = convertPipeToFile(fp);
+	    fp = rewindablePipe(fp);
 
 	if (isKeyBased(fp))
 	    fatal_msg("Input is not columnar format\n");
 
-	if (jflag)
-	    jacknife(fp, pvalue);
-	else
-	    bootstrap(fp);
+	/*
+	 * The matrix is read once for all replicates.  Replicate k,
+	 * counted from 0 over all files, is drawn from its own stream
+	 * seeded with seed + k so it can be made again on its own.
+	 * Replicates are separated by a blank line, except in
+	 * binary output.  Sparse and binary FFPs are resampled
+	 * in sparse form with the same columns as dense ones.
+	 */
+	format = profileFormat(fp);
+	if (oformat == -1)
+	    oformat = format;
+	if (format != PROFILE_DENSE || oformat != PROFILE_DENSE) {
+	    p = readProfiles(fp, false);
+	    if (!p->rows)
+		fatal_msg("Input is empty\n");
+	    for (int k = 0; k < nvalue; k++, replicate++) {
+		if (replicate && nvalue > 1 && oformat != PROFILE_BINARY)
+		    putchar('\n');
+		rngInit(&rng, seed + replicate);
+		if (jflag)
+		    q = jacknifeProfiles(p, pvalue, &rng);
+		else
+		    q = bootstrapProfiles(p, &rng);
+		printProfiles(q, stdout, oformat);
+		freeProfiles(q);
+	    }
+	    freeProfiles(p);
+	    if (fp != stdin)
+		fclose(fp);
+	    continue;
+	}
+
+	vals = readColumnar(fp, &rows, &cols);
+	for (int k = 0; k < nvalue; k++, replicate++) {
+	    if (replicate && nvalue > 1)
+		putchar('\n');
+	    rngInit(&rng, seed + replicate);
+	    if (jflag)
+		jacknife(vals, rows, cols, pvalue, &rng);
+	    else
+		bootstrap(vals, rows, cols, &rng);
+	}
+	free(vals);
 
 	if (fp != stdin)
 	    fclose(fp);
@@ -154,67 +229,107 @@ int main(int argc, char **argv)
 
 /**
  *
- * Performs a bootsrap permutation of a columnar FFP.
+ * Reads a columnar FFP.
  *
- * Column numbers are sampled with replacement up to the
- * number of columns in the original matrix and
- * the chosen columns are printed to stdout.
+ * Blank lines are skipped and every row must have the
+ * same number of columns as the first one.
  *
  * @param fp A file pointer to an FFP.
- * @return void
+ * @param rows Returns the number of rows.
+ * @param cols Returns the number of columns.
+ * @return The values in row order.
  *
  */
 
 
 
-void bootstrap(FILE * fp)
+unsigned *readColumnar(FILE * fp, int *rows, unsigned *cols)
 {
-    long unsigned i, j;
-    unsigned *randCols;
-    int rows;
+    READER *r = readerOpen(fp);
+    SPAN line;
+    const char *s, *next, *end;
+    long unsigned i, c, v;
     unsigned *vals;
-    unsigned cols;
-    unsigned size = COL_SIZE;	/* Inital guess */
-    int rowsize = INIT_ROWSIZE;	/* initial guess */
-    char s[2];
-    int d;
+    size_t size = COL_SIZE;	/* Inital guess */
 
 
-    vals = (unsigned *) malloc(sizeof(unsigned) * size);
+    vals = (unsigned *) chkmalloc(sizeof(unsigned), size);
 
     i = 0;
-    rows = 0;
-    while (!feof(fp)) {
-	if (i < size) {
-	    d = fscanf(fp, "%u%[\n\r]", &vals[i++], s);
-	    if (d == 2) {
-		rows++;
-		if (rows > rowsize) {
-		    rowsize += INIT_ROWSIZE;
-		}
+    *rows = 0;
+    while (readLine(r, &line)) {
+	end = line.s + line.len;
+	for (s = line.s, c = 0;; s = next, c++) {
+	    if ((next = parseUlong(s, end, &v)) == s)
+		break;
+	    if (i == size) {
+		size *= 2;
+		if ((vals = (unsigned *) realloc(vals,
+				sizeof(unsigned) * size)) == NULL)
+		    fatal_msg("%s\n", strerror(ENOMEM));
 	    }
-	} else {
-	    size += COL_SIZE;
-	    vals = (unsigned *) realloc(vals, sizeof(unsigned) * size);
+	    vals[i++] = (unsigned) v;
 	}
+	while (s < end && isspace((unsigned char) *s))
+	    s++;
+	if (s < end)
+	    fatal_msg("Row %d: Not a columnar FFP of counts.\n", *rows + 1);
+	if (!c)			// blank line
+	    continue;
+	if (!*rows)
+	    *cols = c;
+	else if (c != *cols)
+	    fatal_msg("Row %d has %lu columns, expected %u.\n",
+		      *rows + 1, c, *cols);
+	(*rows)++;
     }
+    readerClose(r);
+
+    if (!*rows)
+	fatal_msg("Input is empty\n");
+
+    return vals;
+}
 
-    cols = (unsigned) i / rows;
 
-    //Now we know the number of columns
+
+/**
+ *
+ * Performs a bootsrap permutation of a columnar FFP.
+ *
+ * Column numbers are sampled with replacement up to the
+ * number of columns in the original matrix and
+ * the chosen columns are printed to stdout.
+ *
+ * @param vals The FFP values in row order.
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param rng The random number stream of the replicate.
+ * @return void
+ *
+ */
+
+
+
+void bootstrap(unsigned *vals, int rows, unsigned cols, RNG * rng)
+{
+    long unsigned i, j;
+    unsigned *randCols;
+    WRITER *w = writerOpen(stdout);
 
     randCols = (unsigned *) malloc(sizeof(unsigned) * cols);
 
     for (i = 0; i < cols; i++)
-	randCols[i] = rand() % cols;
+	randCols[i] = rngBelow(rng, cols);
 
-    for (i = 0; i < rows; i++) {
-	for (j = 0; j < cols-1; j++)
-	    printf("%u\t", vals[i * cols + randCols[j]]);
-	printf("%u\n", vals[i * cols + randCols[j]]);
-    }
+    for (i = 0; i < rows; i++)
+	for (j = 0; j < cols; j++) {
+	    writeUlong(w, vals[i * cols + randCols[j]]);
+	    writeChar(w, j + 1 < cols ? '\t' : '\n');
+	}
 
-    free(vals);
+    writerClose(w);
+    free(randCols);
 }
 
 
@@ -228,61 +343,168 @@ void bootstrap(FILE * fp)
  * of being deleted equal to the second argument del. 
  * The remainin columns are printed to stdout.
  *
- * @param fp A file pointer to an FFP.
+ * @param vals The FFP values in row order.
+ * @param rows The number of rows.
+ * @param cols The number of columns.
  * @param del The deletion probability.
+ * @param rng The random number stream of the replicate.
  * @return void
  *
  */
 
-void jacknife(FILE * fp, float del)
+void jacknife(unsigned *vals, int rows, unsigned cols, float del, RNG * rng)
 {
-    long unsigned i, j;
+    long unsigned i, j, k;
     char *randCols;
-    int rows;
-    unsigned *vals;
-    unsigned cols;
-    unsigned size = COL_SIZE;	/* Inital guess of column number */
-    int rowsize = INIT_ROWSIZE;	
-    char s[2];
-    int d;
+    WRITER *w = writerOpen(stdout);
 
+    randCols = (char *) malloc(sizeof(char) * cols);
 
-    vals = (unsigned *) malloc(sizeof(unsigned) * size);
+    for (i = 0; i < cols; i++) {
+	randCols[i] = (rngUniform(rng) > del);
+    }
 
-    i = 0;
-    rows = 0;
-    while (!feof(fp)) {
-	if (i < size) {
-	    d = fscanf(fp, "%u%[\n\r]", &vals[i++], s);
-	    if (d == 2) {
-
-		rows++;
-		if (rows > rowsize) {
-		    rowsize += INIT_ROWSIZE;
-		}
+    for (i = 0; i < rows; i++) {
+	for (j = 0, k = 0; j < cols; j++)
+	    if (randCols[j]) {
+		if (k++)
+		    writeChar(w, '\t');
+		writeUlong(w, vals[i * cols + j]);
 	    }
-	} else {
-	    size += COL_SIZE;
-	    vals = (unsigned *) realloc(vals, sizeof(unsigned) * size);
-	}
+	writeChar(w, '\n');
     }
 
-    cols = (unsigned) i / rows;
+    writerClose(w);
+    free(randCols);
+}
 
-    //Now we know the number of columns
 
-    randCols = (char *) malloc(sizeof(char) * cols);
 
-    for (i = 0; i < cols; i++) {
-	randCols[i] = ((float) rand() / INT_MAX > del);
+/**
+ *
+ * Compares two packed (column, entry) keys.
+ *
+ */
+
+static int cmpKey(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+
+
+/**
+ *
+ * Performs a bootstrap permutation of sparse profiles.
+ *
+ * The columns are drawn as in bootstrap, so a sparse FFP
+ * gives the same replicate as the dense FFP it stands for.
+ * Each non-zero entry is copied to every replicate column
+ * that drew its column, and only the non-zero entries of
+ * a row are visited.
+ *
+ * @param p The profiles to resample.
+ * @param rng The random number stream of the replicate.
+ * @return Newly allocated replicate profiles.
+ *
+ */
+
+PROFILES *bootstrapProfiles(PROFILES * p, RNG * rng)
+{
+    PROFILES *q;
+    unsigned *start, *pos, *draw;
+    uint64_t *key;
+    uint64_t e, f, n, nnz;
+    uint32_t r, c, j;
+
+    /* pos[start[c]] ... pos[start[c+1]-1] are the copies of c */
+    start = (unsigned *) chkcalloc(sizeof(unsigned), p->cols + 2);
+    pos = (unsigned *) chkmalloc(sizeof(unsigned), p->cols + 1);
+    draw = (unsigned *) chkmalloc(sizeof(unsigned), p->cols + 1);
+    for (j = 0; j < p->cols; j++) {
+	draw[j] = rngBelow(rng, p->cols);
+	start[draw[j] + 2]++;
+    }
+    for (c = 0; c < p->cols; c++)
+	start[c + 2] += start[c + 1];
+    for (j = 0; j < p->cols; j++)
+	pos[start[draw[j] + 1]++] = j;
+    free(draw);
+
+    for (e = 0, nnz = 0; e < p->index[p->rows]; e++)
+	nnz += start[p->col[e] + 1] - start[p->col[e]];
+
+    q = (PROFILES *) chkcalloc(sizeof(PROFILES), 1);
+    q->rows = p->rows;
+    q->cols = p->cols;
+    q->index = (uint64_t *) chkmalloc(sizeof(uint64_t), p->rows + 1);
+    q->col = (uint32_t *) chkmalloc(sizeof(uint32_t), nnz + 1);
+    q->val = (double *) chkmalloc(sizeof(double), nnz + 1);
+    key = (uint64_t *) chkmalloc(sizeof(uint64_t), p->cols + 1);
+
+    q->index[0] = 0;
+    for (r = 0, f = 0; r < p->rows; r++) {
+	for (e = p->index[r], n = 0; e < p->index[r + 1]; e++)
+	    for (j = start[p->col[e]]; j < start[p->col[e] + 1]; j++)
+		key[n++] = (uint64_t) pos[j] << 32 | (e - p->index[r]);
+	qsort(key, n, sizeof(uint64_t), cmpKey);
+	for (j = 0; j < n; j++, f++) {
+	    q->col[f] = key[j] >> 32;
+	    q->val[f] = profileValue(p, p->index[r] + (uint32_t) key[j]);
+	}
+	q->index[r + 1] = f;
     }
 
-    for (i = 0; i < rows; i++) {
-	for (j = 0; j < cols; j++)
-	    if (randCols[j])
-		printf("%u\t", vals[i * cols + j]);
-	printf("%u\n", vals[i * cols + j]);
+    free(start);
+    free(pos);
+    free(key);
+    return q;
+}
+
+
+
+/**
+ *
+ * Performs a jackknife resampling of sparse profiles.
+ *
+ * The columns are deleted as in jacknife and the kept
+ * columns are numbered in order.
+ *
+ * @param p The profiles to resample.
+ * @param del The deletion probability.
+ * @param rng The random number stream of the replicate.
+ * @return Newly allocated replicate profiles.
+ *
+ */
+
+PROFILES *jacknifeProfiles(PROFILES * p, float del, RNG * rng)
+{
+    PROFILES *q;
+    uint32_t *keep;
+    uint64_t e, f;
+    uint32_t r, c;
+
+    q = (PROFILES *) chkcalloc(sizeof(PROFILES), 1);
+    keep = (uint32_t *) chkmalloc(sizeof(uint32_t), p->cols + 1);
+    for (c = 0; c < p->cols; c++)
+	keep[c] = rngUniform(rng) > del ? ++q->cols : 0;
+
+    q->rows = p->rows;
+    q->index = (uint64_t *) chkmalloc(sizeof(uint64_t), p->rows + 1);
+    q->col = (uint32_t *) chkmalloc(sizeof(uint32_t), p->index[p->rows] + 1);
+    q->val = (double *) chkmalloc(sizeof(double), p->index[p->rows] + 1);
+
+    q->index[0] = 0;
+    for (r = 0, f = 0; r < p->rows; r++) {
+	for (e = p->index[r]; e < p->index[r + 1]; e++)
+	    if (keep[p->col[e]]) {
+		q->col[f] = keep[p->col[e]] - 1;
+		q->val[f++] = profileValue(p, e);
+	    }
+	q->index[r + 1] = f;
     }
 
-    free(vals);
+    free(keep);
+    return q;
 }
@@ -24,23 +24,42 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <stdint.h>
 #include "hash.h"
+#include "profile.h"
 #include "utils.h"
 #include "vstring.h"
 #include "sighandle.h"
 #include "../config.h"
 
-#define MAX_WORD_LENGTH 40 /**< Maximum feature length */
+
+/**
+ * A sorted stream of keys, one per line, merged by emitVocab
+ */
+typedef struct {
+    FILE *fp;		/**< The stream */
+    READER *r;		/**< Reader of fp */
+    char *line;		/**< Copy of key */
+    size_t size;	/**< Allocated size of line */
+    char *key;		/**< Current key, NULL at the end of the stream */
+    char *last;		/**< Previous key, to check the order */
+    size_t lastsize;	/**< Allocated size of last */
+    unsigned lineno;	/**< Line number of key */
+    char *name;		/**< Name of the stream for messages */
+} KEYSTREAM;
 
 char PROG_NAME[FILENAME_MAX];
 
-void hashCol(FILE * fp);
+void hashCol(HASHTABLE * h, FILE * fp, int format);
+void convertCol(FILE * fp, int format);
+unsigned loadVocab(HASHTABLE * h, char *fname);
+void addKeyStream(HASHTABLE * h, FILE * fp, char *name);
+void emitVocab(HASHTABLE * h);
 int isKeyBased(FILE * fp);
-int getKeyLength(FILE * fp);
 
-char *weightVector;
-int Length = MAX_WORD_LENGTH;
-			    /**< Feature length */
+unsigned vocabSize = 0;	/**< Keys of the --vocab file, 0 without one */
+KEYSTREAM *streams = NULL; /**< Sorted key streams of --emit-vocab */
+int numStreams = 0;	/**< Number of streams */
 
 
 
@@ -52,6 +71,12 @@ generate columnar FFPs for Nucleic acids.\n\
 \t-a, --amino\tInput is Amino acid\n\
 \t-t, --text\tInput is text\n\
 \t-d, --disable\tDisable classing of AAs and Nuc.\n\
+\t-S, --sparse\tPrint a sparse FFP.\n\
+\t-x, --binary\tPrint a binary FFP.\n\
+\t-k FILE, --vocab=FILE\tUse the sorted keys of FILE as columns.\n\
+\t-e, --emit-vocab\tPrint the sorted union of the input keys.\n\
+Columnar FFP input is converted to the output format,\n\
+which is dense unless -S or -x is given.\n\
 \t-V, --verbose\tBe more verbose.\n\
 \t-h, --help\tThis text.\n\
 \t-v, --version\n\n\
@@ -66,10 +91,15 @@ bool flagV = false;
 int main(int argc, char **argv)
 {
     FILE *fp = NULL;
+    HASHTABLE *h;
+    char *name;
     int opt;
     bool flagA = false;
     bool flagT = false;
     bool flagD = false;
+    int format = PROFILE_DENSE;
+    char *kvalue = NULL;
+    bool flagE = false;
 
     int mode = nucleotide;
     int option_index = 0;
@@ -79,6 +109,10 @@ int main(int argc, char **argv)
 	{"amino", no_argument, 0, 'a'},
 	{"text", no_argument, 0, 't'},
 	{"disable", no_argument, 0, 'd'},
+	{"sparse", no_argument, 0, 'S'},
+	{"binary", no_argument, 0, 'x'},
+	{"vocab", required_argument, 0, 'k'},
+	{"emit-vocab", no_argument, 0, 'e'},
 	{"version", no_argument, 0, 'v'},
 	{"verbose", no_argument, 0, 'V'},
 	{0, 0, 0, 0}
@@ -88,7 +122,7 @@ int main(int argc, char **argv)
     
     strcpy( PROG_NAME, basename(argv[0]) );
 
-    while ((opt = getopt_long(argc, argv, "hatdvV",
+    while ((opt = getopt_long(argc, argv, "hatdSxk:evV",
 			      long_options, &option_index)) != -1)
 	switch (opt) {
 	case 'a':
@@ -100,6 +134,18 @@ int main(int argc, char **argv)
 	case 'd':
 	    flagD = !flagD;
 	    break;
+	case 'S':
+	    format = PROFILE_SPARSE;
+	    break;
+	case 'x':
+	    format = PROFILE_BINARY;
+	    break;
+	case 'k':
+	    kvalue = optarg;
+	    break;
+	case 'e':
+	    flagE = true;
+	    break;
 	case 'V':
 	    flagV = !flagV;
 	    break;
@@ -128,17 +174,24 @@ int main(int argc, char **argv)
     else {
     }
 
-    initHash(0, mode, !flagD);
+    h = hashCreate(mode, !flagD, NULL);
 
+    if (kvalue && flagE)
+	fatal_msg("Option -k or -e not both\n");
 
-    if ((argc - optind) > 1)
+    if (kvalue)
+	vocabSize = loadVocab(h, kvalue);
+
+    if ((argc - optind) > 1 && !flagE)
 	fatal_msg("Specify only one file argument.\n");
 
     argv += optind;
 
    do {
 	fp = stdin;
+	name = "-";
 	if (*argv) {
+	    name = *argv;
 	    if (!strcmp(*argv, "-"))
 		fp = stdin;
 	    else if ((fp = fopen(*argv, "r")) == NULL){
@@ -154,132 +207,539 @@ int main(int argc, char **argv)
 		printErrorUsageStr();
 	}
 
-	if (!isRegularFile(fp)) 
-	    fp = convertPipeToFile(fp);
-
-        if (!isKeyBased(fp))
-	    fatal_msg("%s: Not a key valued FFP.\n", *argv);
-
+	if (flagE) {
+	    addKeyStream(h, fp, name);
+	    continue;
+	}
 
+	if ((opt = getc(fp)) == '#') {	// sparse or binary columnar FFP
+	    // its columns are numbers, there are no keys to look up
+	    if (vocabSize)
+		fatal_msg("%s: Option -k needs a key valued FFP, not a "
+			  "sparse or binary one.\n", name);
+	    ungetc(opt, fp);
+	    convertCol(fp, format);
+	    fclose(fp);
+	    continue;
+	}
+	ungetc(opt, fp);
 
+	// an empty line is the row of an input without keys
+        if (opt != '\n' && !isKeyBased(fp))
+	    fatal_msg("%s: Not a key valued FFP.\n", *argv);
 
-	Length = getKeyLength(fp);
-	hashCol(fp);
+	hashCol(h, fp, format);
 
 	fclose(fp);
 
     } while (*argv);
 
+    if (flagE)
+	emitVocab(h);
+
+    hashDestroy(h);
     return EXIT_SUCCESS;
 }
 
 
+/**
+ * Compares two packed (column, value) entries by column
+ */
+
+static int cmpEntry(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+
+
+/**
+ * Prints the rows gathered by hashCol as a sparse or binary FFP
+ *
+ * The entries of each row are gathered in dense, so a
+ * repeated column keeps its last value and zeros are
+ * dropped, and are then sorted by column.
+ *
+ * @param id Column of each entry
+ * @param val Value of each entry
+ * @param start First entry of each row, rows+1 values
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param dense Zeroed scratch array of cols values
+ * @param format A profile_formats value for the output
+ * @return none
+ */
+
+static void printSparse(uint32_t * id, unsigned *val, size_t * start,
+			unsigned rows, unsigned cols, unsigned *dense,
+			int format)
+{
+    PROFILES p = { 0 };
+    uint64_t *entry;
+    size_t e, k, first, n;
+    unsigned r;
+
+    n = rows ? start[rows] : 0;
+    p.rows = rows;
+    p.cols = cols;
+    p.index = (uint64_t *) chkmalloc(sizeof(uint64_t), rows + 1);
+    p.col = (uint32_t *) chkmalloc(sizeof(uint32_t), n + 1);
+    p.val = (double *) chkmalloc(sizeof(double), n + 1);
+    entry = (uint64_t *) chkmalloc(sizeof(uint64_t), n + 1);
+
+    p.index[0] = 0;
+    for (r = 0, k = 0; r < rows; r++) {
+	first = k;
+	for (e = start[r]; e < start[r + 1]; e++)
+	    dense[id[e]] = val[e];
+	for (e = start[r]; e < start[r + 1]; e++)
+	    if (dense[id[e]]) {
+		entry[k++] = (uint64_t) id[e] << 32 | dense[id[e]];
+		dense[id[e]] = 0;
+	    }
+	qsort(entry + first, k - first, sizeof(uint64_t), cmpEntry);
+	for (e = first; e < k; e++) {
+	    p.col[e] = entry[e] >> 32;
+	    p.val[e] = (uint32_t) entry[e];
+	}
+	p.index[r + 1] = k;
+    }
+
+    printProfiles(&p, stdout, format);
+    free(entry);
+    free(p.index);
+    free(p.col);
+    free(p.val);
+}
+
+
+
+/**
+ * Converts a sparse or binary columnar FFP
+ *
+ * Every set of the input, such as the replicates written
+ * by ffpboot, is converted in turn.  Text sets are
+ * separated by blank lines.
+ *
+ * @param fp A file pointer to a sparse or binary columnar FFP
+ * @param format A profile_formats value for the output
+ * @return none
+ */
+
+void convertCol(FILE * fp, int format)
+{
+    READER *r = readerOpen(fp);
+    PROFILES *p;
+    SPAN line;
+    unsigned sets = 0;
+    int c;
+
+    while ((c = readerPeek(r)) != EOF) {
+	if (c == '\n' || c == '\r') {
+	    readLine(r, &line);
+	    continue;
+	}
+	if (sets++ && format != PROFILE_BINARY)
+	    putchar('\n');
+	p = parseProfiles(r, false);
+	printProfiles(p, stdout, format);
+	freeProfiles(p);
+    }
+    readerClose(r);
+}
+
+
+
 /**
  * Convert a (key,value) FFP to a columnar FFP
  *
- * FFP in fp must be columnar FFP.
+ * The input is read once with a READER, and the
+ * values are parsed with parseUlong.  Each key is given a dense
+ * column id the first time it is seen, and each row is
+ * held in memory as a list of (id, value) pairs, so a
+ * row costs one hash lookup per key.  The columns are
+ * printed in the order of the keys in the hash table,
+ * as before, and a key repeated in a row keeps its last
+ * value.  With a vocabulary, see loadVocab, the columns
+ * are the keys of the vocabulary in its order, and other
+ * keys are dropped without being added to the hash, so it
+ * keeps the size of the vocabulary.
  *
+ * @param h The hash of the keys
  * @param fp A file pointer to a (key,value) FFP
+ * @param format A profile_formats value for the output
  * @return none
  */
 
+void hashCol(HASHTABLE * h, FILE * fp, int format)
+{
+    READER *rd = readerOpen(fp);
+    WRITER *out;
+    SPAN line, f;
+    char *key = NULL;
+    size_t keysize = 0;
+    unsigned lineno = 0;
+    uint32_t *id = NULL;	/* column ids of all rows */
+    unsigned *val = NULL;	/* values of all rows */
+    size_t n = 0, nsize = 0;
+    size_t *start = NULL;	/* first entry of each row */
+    unsigned rows = 0, rsize = 0;
+    unsigned cols = 0;
+    unsigned *ref, *order, *dense;
+    long unsigned unknown = 0;
+    unsigned long v;
+    unsigned r, i;
+    size_t e;
+    bool empty;
+
+    while (readLine(rd, &line)) {
+	lineno++;
+	// an empty line is the row of an input without keys
+	if (!(empty = line.len == 0) && !nextPair(&line, &f, &v))
+	    continue;
+
+	if (rows + 1 >= rsize) {
+	    rsize = rsize ? 2 * rsize : 64;
+	    if ((start = (size_t *) realloc(start,
+				sizeof(size_t) * rsize)) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
+	}
+	start[rows++] = n;
+	if (empty)
+	    continue;
+
+	do {
+	    spanCopy(&f, &key, &keysize);
+	    if (vocabSize) {
+		// looked up without being added, so the table keeps its size
+		if ((ref = hashFind(h, key)) == NULL) {	// not in the vocabulary
+		    unknown++;
+		    continue;
+		}
+	    } else if ((ref = hashRef(h, key)) == NULL)	// invalid key
+		continue;
+	    else if (*ref == 0)
+		*ref = ++cols;
+
+	    if (n == nsize) {
+		nsize = nsize ? 2 * nsize : 1024;
+		if ((id = (uint32_t *) realloc(id,
+				sizeof(uint32_t) * nsize)) == NULL ||
+		    (val = (unsigned *) realloc(val,
+				sizeof(unsigned) * nsize)) == NULL)
+		    fatal_msg("%s\n", strerror(ENOMEM));
+	    }
+	    id[n] = *ref - 1;
+	    val[n++] = (unsigned) v;
+	} while (nextPair(&line, &f, &v));
+
+	if (flagV)
+	    fprintf(stderr,"Processed Line: %d\n",lineno);
+    }
+
+    readerClose(rd);
+
+    if (rows)
+	start[rows] = n;
+
+    if (vocabSize) {
+	// columns are numbered by position in the vocabulary
+	if (flagV || unknown)
+	    warn_msg("%lu keys not in the vocabulary were dropped\n",
+		     unknown);
+	cols = vocabSize;
+	dense = (unsigned *) chkcalloc(sizeof(unsigned), cols + 1);
+    } else {
+	// columns are numbered by position in the hash table
+	hashValues(h, &order);
+	dense = (unsigned *) chkmalloc(sizeof(unsigned), cols + 1);
+	for (i = 0; i < cols; i++)
+	    dense[order[i] - 1] = i;
+	for (e = 0; e < n; e++)
+	    id[e] = dense[id[e]];
+	memset(dense, 0, sizeof(unsigned) * (cols + 1));
+	free(order);
+    }
+
+    if (format != PROFILE_DENSE) {
+	printSparse(id, val, start, rows, cols, dense, format);
+	rows = 0;
+    }
+
+    out = writerOpen(stdout);
+    for (r = 0; r < rows && cols; r++) {
+	for (e = start[r]; e < start[r + 1]; e++)
+	    dense[id[e]] = val[e];
+	for (i = 0; i < cols; i++) {
+	    writeUlong(out, dense[i]);
+	    writeChar(out, i + 1 < cols ? '\t' : '\n');
+	}
+	for (e = start[r]; e < start[r + 1]; e++)
+	    dense[id[e]] = 0;
+    }
+    writerClose(out);
+
+    free(key);
+    free(id);
+    free(val);
+    free(start);
+    free(dense);
+}
+
+
+
+/**
+ * Loads a vocabulary for --vocab
+ *
+ * The vocabulary has one key per line, such as written
+ * by --emit-vocab.  The keys are stored in the hash with
+ * their column number, counted from 1, so every FFP
+ * columnized with the same vocabulary has the same
+ * columns in the same order.
+ *
+ * @param h The hash of the keys
+ * @param fname Name of the vocabulary file
+ * @return Number of keys in the vocabulary
+ */
+
+unsigned loadVocab(HASHTABLE * h, char *fname)
+{
+    FILE *fp;
+    READER *r;
+    SPAN line, f;
+    char *key = NULL;
+    size_t size = 0;
+    unsigned keys = 0;
+    unsigned *ref;
+
+    if ((fp = fopen(fname, "r")) == NULL)
+	fatal_msg("%s: %s.\n", fname, strerror(errno));
+
+    r = readerOpen(fp);
+    while (readLine(r, &line)) {
+	if (!nextField(&line, &f))
+	    continue;
+	if ((ref = hashRef(h, spanCopy(&f, &key, &size))) == NULL)
+	    fatal_msg("%s: Invalid key at line %lu.\n", fname, r->lineno);
+	if (*ref)
+	    fatal_msg("%s: Repeated key at line %lu.\n", fname, r->lineno);
+	*ref = ++keys;
+    }
 
+    if (!keys)
+	fatal_msg("%s: Empty vocabulary.\n", fname);
 
-void hashCol(FILE * fp)
+    free(key);
+    readerClose(r);
+    fclose(fp);
+    return keys;
+}
+
+
+
+/**
+ * Reads the next key of a sorted key stream
+ *
+ * @param s A key stream
+ * @return The key, or NULL at the end of the stream
+ */
+
+static char *nextKey(KEYSTREAM * s)
 {
-    //for accepting input via pipe      
-    // Used in all cases
-    unsigned val;
-    char * s;
-    char **keys;
-    unsigned i;
-    char c[3];
-    int items;
-    unsigned lineno=1;
-    off_t line_offset=0;
-
-
-
-    s=(char *) chkmalloc(sizeof(char),(Length+1));
-
-//@TODO move this comment to description of convertFilePtr
-
-// cut here
-// If file is stdin we need to create a tmp file
-// This is equivalent to to:
-//  stdin | cat > /tmp/tmp.1a321asf 
-// However we don't want a file passed to the
-// program via  ffpcol < infile, to undergo this
-// process, since a file opened in this manner
-// is seekable and doesn't need to be copied.
-// File opened this way ffpcol <(ffpry *.fna) 
-// i.e. via process substitution is not seekable
-
-    // Find all keys in the file.
-
-    errno=0;
-
-   
-
-    //@TODO see if this can be sped up by using %*u to skip reading and conversion of val.
-    while ( (items=fscanf(fp, "%s %u%[\r\n]", s, &val,c)) != EOF ) { 
-	//if (errno) 
-	//	fatal_msg("Parse error at line %u char %ld: %s. %d\n",
-	//		lineno,ftell(fp)-line_offset, strerror(errno),errno );
-	
-	switch (items) {
-	        case 3:
-			if (flagV)
-				fprintf(stderr,"Processed Line: %d\n",lineno);
-			line_offset=ftell(fp);
-			lineno++;	  
-		case 2:
-			hashInc(s);		// increments hash by value;
-		break;	
-		default:
-			fatal_msg("Parse error at line %u char %ld.\n",
-			lineno,ftell(fp)-line_offset);
-		break;
+    SPAN line, f;
+    size_t len;
+
+    if (s->key) {
+	len = strlen(s->key) + 1;
+	if (len > s->lastsize) {
+	    s->lastsize = 2 * len;
+	    if ((s->last = (char *) realloc(s->last, s->lastsize)) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
 	}
+	memcpy(s->last, s->key, len);
     }
 
-    if (ferror(fp)) 
-    	fatal_msg("Read Error: %s",strerror(errno));
+    s->key = NULL;
+    while (readLine(s->r, &line))
+	if (nextField(&line, &f)) {
+	    s->key = spanCopy(&f, &s->line, &s->size);
+	    s->lineno = s->r->lineno;
+	    break;
+	}
 
-    hashKeys(&keys);
+    if (s->key && strcmp(s->last, s->key) >= 0)
+	fatal_msg("%s: Keys are not sorted at line %u.\n", s->name,
+		  s->lineno);
+    return s->key;
+}
 
-    rewind(fp);
 
-    fflush(fp); // Flush last character read
 
+/**
+ * Adds an input of --emit-vocab
+ *
+ * A vocabulary, with one key per line, is kept open as a
+ * sorted key stream.  The keys of a (key,value) FFP are
+ * added to the hash instead, and emitVocab sorts them.
+ *
+ * @param h The hash of the keys
+ * @param fp A file pointer to a vocabulary or (key,value) FFP
+ * @param name Name of the input for messages
+ * @return none
+ */
 
-    //zero out the hash
+void addKeyStream(HASHTABLE * h, FILE * fp, char *name)
+{
+    KEYSTREAM *s;
+    SPAN line, rest, f;
+    char *key;
+    int tokens = 0;
+
+    if ((streams = (KEYSTREAM *) realloc(streams,
+		    sizeof(KEYSTREAM) * (numStreams + 1))) == NULL)
+	fatal_msg("%s\n", strerror(ENOMEM));
+    s = &streams[numStreams];
+    memset(s, 0, sizeof(KEYSTREAM));
+    s->fp = fp;
+    s->r = readerOpen(fp);
+    s->name = name;
+
+    // a vocabulary line holds a single key
+    while (readLine(s->r, &line)) {
+	for (rest = line, tokens = 0; nextField(&rest, &f); tokens++);
+	if (tokens)
+	    break;
+    }
 
-    for (i = 0; i < numKeys(); i++) {
-	hashAssign(keys[i], 0);
+    if (tokens == 1) {
+	nextField(&line, &f);
+	s->key = spanCopy(&f, &s->line, &s->size);
+	s->lineno = s->r->lineno;
+	numStreams++;
+	return;
     }
 
+    rest = line;
+    if (tokens && nextField(&rest, &f) && !isalpha((unsigned char) *f.s))
+	fatal_msg("%s: Not a key valued FFP or vocabulary.\n", name);
 
-	while ((items = fscanf(fp, "%s %u%[\r\n]", s, &val, c)) != EOF) {
-
-	    switch (items) {
-		    case 2:
-	    		hashAssign(s, val);
-		    break;
-		    case 3:
-	    		hashAssign(s, val);
-	   		for (i = 0; i < numKeys()-1; i++) {
-				printf("%u\t", hashval(keys[i]));
-				hashAssign(keys[i], 0);
-	   		}
-	    		printf("%u\n",hashval(keys[i]));
-	    		hashAssign(keys[i], 0);
-		    break;
-	    }
+    for (; tokens; tokens = readLine(s->r, &line))
+	while (nextField(&line, &f)) {
+	    if (isdigit((unsigned char) *f.s))	// a value
+		continue;
+	    key = spanCopy(&f, &s->line, &s->size);
+	    hashRef(h, key);
 	}
 
-  free(s);
-  // No need to free keys, since program terminates
+    free(s->line);
+    readerClose(s->r);
+    if (fp != stdin)
+	fclose(fp);
 }
 
 
+
+/**
+ * Compares two keys for qsort
+ */
+
+static int cmpKey(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+
+
+/**
+ * Restores the heap order of key streams below position i
+ */
+
+static void siftDown(KEYSTREAM ** heap, int n, int i)
+{
+    KEYSTREAM *t;
+    int j;
+
+    for (; (j = 2 * i + 1) < n; i = j) {
+	if (j + 1 < n && strcmp(heap[j + 1]->key, heap[j]->key) < 0)
+	    j++;
+	if (strcmp(heap[i]->key, heap[j]->key) <= 0)
+	    break;
+	t = heap[i];
+	heap[i] = heap[j];
+	heap[j] = t;
+    }
+}
+
+
+
+/**
+ * Prints the sorted union of the keys of all inputs
+ *
+ * The keys of (key,value) FFPs are sorted into one more
+ * stream, and all the sorted streams are merged with a
+ * heap, so vocabularies of many shards are merged
+ * without holding them in memory.
+ *
+ * @param h The hash of the keys of (key,value) FFPs
+ * @return none
+ */
+
+void emitVocab(HASHTABLE * h)
+{
+    KEYSTREAM **heap;
+    KEYSTREAM *s;
+    char **keys;
+    char *last = NULL;
+    size_t lastsize = 0, len;
+    int i, n = 0;
+
+    if (numKeys(h)) {
+	FILE *tmp;
+	if ((tmp = tmpfile()) == NULL)
+	    fatal_msg("%s\n", strerror(errno));
+	hashKeys(h, &keys);
+	qsort(keys, numKeys(h), sizeof(char *), cmpKey);
+	for (i = 0; i < numKeys(h); i++) {
+	    fprintf(tmp, "%s\n", keys[i]);
+	    free(keys[i]);
+	}
+	free(keys);
+	rewind(tmp);
+	addKeyStream(h, tmp, "(key,value) FFP");
+    }
+
+    heap = (KEYSTREAM **) chkmalloc(sizeof(KEYSTREAM *), numStreams + 1);
+    for (i = 0; i < numStreams; i++)
+	if (streams[i].key)
+	    heap[n++] = &streams[i];
+    for (i = n / 2 - 1; i >= 0; i--)
+	siftDown(heap, n, i);
+
+    while (n) {
+	s = heap[0];
+	if (!last || strcmp(last, s->key)) {
+	    puts(s->key);
+	    len = strlen(s->key) + 1;
+	    if (len > lastsize) {
+		lastsize = 2 * len;
+		if ((last = (char *) realloc(last, lastsize)) == NULL)
+		    fatal_msg("%s\n", strerror(ENOMEM));
+	    }
+	    memcpy(last, s->key, len);
+	}
+	if (nextKey(s) == NULL) {
+	    heap[0] = heap[--n];
+	    readerClose(s->r);
+	    if (s->fp != stdin)
+		fclose(s->fp);
+	    free(s->line);
+	    free(s->last);
+	}
+	siftDown(heap, n, 0);
+    }
+
+    free(last);
+    free(heap);
+    free(streams);
+}
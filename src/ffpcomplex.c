@@ -34,10 +34,10 @@
 char PROG_NAME[FILENAME_MAX];
 #define MAX_WORD_LENGTH 40 /**< Maximum feature length */
 
-void hashCol(FILE * fp);
+void hashCol(HASHTABLE * h, FILE * fp);
 int isKeyBased(FILE * fp);
 int getKeyLength(FILE * fp);
-float complexity(char *key);
+float complexity(HASHTABLE * h, char *key);
 
 char usage_str[] = "Usage: %s [OPTIONS]... [FILE]...\n\
 This program filters words by complexity\n\n\
@@ -58,7 +58,6 @@ Copyright (c) %s\n\
 %s\n\
 Contact %s\n";
 
-char *weightVector;
 int Length = MAX_WORD_LENGTH;
 			    /**< Feature length */
 
@@ -78,6 +77,7 @@ float upper = FLT_MAX;
 int main(int argc, char **argv)
 {
     FILE *fp = NULL;
+    HASHTABLE *h;
     struct stat input;
     int opt;
 
@@ -152,7 +152,7 @@ int main(int argc, char **argv)
     else if (flagT)
 	mode = text;
 
-    initHash(0, mode, !flagD);
+    h = hashCreate(mode, !flagD, NULL);
 
     if ((argc - optind) > 1)
 	fatal_msg("Specify only one File argument\n");
@@ -177,7 +177,7 @@ int main(int argc, char **argv)
     	// process if its a pipe
 
    	 if (!isRegularFile(fp)) {
-		fp = convertPipeToFile(fp);
+		fp = rewindablePipe(fp);
     	}
     	// gather complexity stats.
 
@@ -185,12 +185,13 @@ int main(int argc, char **argv)
 	   fatal_msg("%s: Not a key valued FFP.\n", *argv);
 
 	Length = getKeyLength(fp);
-	hashCol(fp);
+	hashCol(h, fp);
 
 	fclose(fp);
 
     } while (*argv);
 
+    hashDestroy(h);
     return EXIT_SUCCESS;
 }
 
@@ -201,14 +202,13 @@ int main(int argc, char **argv)
  * From this the log2 based Shannon Entropy is calculated.  
  * Lower values indicate lower complexity.
  *
+ * @param h An empty hash, left empty, to count the sub-words in
  * @param key an amino acid, nucleotide or text feature 
  * @return float Value indicates the Shannon entropy 
- * @todo It would simplify the use of complexity for filtration if this function had its own
- *       Internal hash variable
  */
 
 
-float complexity(char *key)
+float complexity(HASHTABLE * h, char *key)
 {
     int L, i, N;
     char s[Length];
@@ -221,19 +221,22 @@ float complexity(char *key)
 	for (i = 0; i < Length - L + 1; i++) {
 	    strncpy(s, &key[i], L);
 	    s[L] = '\0';
-	    hashInc(s);
+	    hashInc(h, s);
 	}
 	L++;
 	N += L;
     }
 
-    hashKeys(&keys);
+    hashKeys(h, &keys);
 
-    for (i = 0; i < numKeys(); i++)
+    for (i = 0; i < numKeys(h); i++)
 	entropy -=
-	    (float) hashval(keys[i]) / N * log2((float) hashval(keys[i]) / N);
+	    (float) hashval(h, keys[i]) / N * log2((float) hashval(h, keys[i]) / N);
 
-    freeHash();
+    for (i = 0; i < numKeys(h); i++)
+	free(keys[i]);
+    free(keys);
+    hashClear(h);
 
     return entropy;
 }
@@ -247,17 +250,20 @@ float complexity(char *key)
  *
  * FFP in fp must be columnar FFP.
  *
+ * @param h An empty hash for complexity
  * @param fp A file pointer to a (key,value) FFP
  * @return none
  */
 
 
 
-void hashCol(FILE * fp)
+void hashCol(HASHTABLE * h, FILE * fp)
 {
-    unsigned val;
-    char s[Length];
-    char c[2];
+    READER *r = readerOpen(fp);
+    WRITER *out;
+    SPAN line, key, rest;
+    unsigned long val;
+    char s[Length + 1];
     bool deleteKey;
     float cval;
     float cvalMin=FLT_MAX;
@@ -267,43 +273,22 @@ void hashCol(FILE * fp)
     double sigma;
     double zscore;
     unsigned ctr = 0;
-    unsigned items;
-    unsigned lineno=0;
-    unsigned line_offset=0;
-
-    errno=0;
-    while ( (items=fscanf(fp, "%s %u%[\r\n]", s, &val,c)) != EOF ) { 
-	//fprintf(stderr,"%s %d\n",strerror(errno),items);
-	if (errno) 
-		fatal_msg("Parse error at line %u char %ld: %s.\n",
-			lineno,ftell(fp)-line_offset, strerror(errno) );
-	
-	switch (items) {
-	        case 3:
-			line_offset=ftell(fp);
-			lineno++;	  
-		case 2:
-			cval = complexity(s);
-			x1 += cval;
-			x2 += cval * cval;
-			ctr++;
-		break;	
-		default:
-			fatal_msg("Parse error at line %u char %ld.\n",
-			lineno,ftell(fp)-line_offset);
-		break;
-	}
 
+    while (readLine(r, &line))
+	while (nextPair(&line, &key, &val)) {
+	    cval = complexity(h, spanToString(&key, s, sizeof(s)));
+	    x1 += cval;
+	    x2 += cval * cval;
+	    ctr++;
 
-	if (flagS) {
+	    if (flagS) {
 		if (cval < cvalMin) 
 			cvalMin=cval;
 		if (cval > cvalMax)
 			cvalMax=cval;
+	    }
 	}
 
-    }
-
 
     x1 /= ctr;
     x2 /= ctr;
@@ -315,18 +300,16 @@ void hashCol(FILE * fp)
 	fprintf(stderr, "%lf\t%lf\t%f\t%f\n", x1, sigma,cvalMin,cvalMax);
     }
 
-    rewind(fp);
+    readerRewind(r);
+    out = writerOpen(stdout);
 
     // perform tests here to decide whether to keep ffp.
 
-    errno=0;
-    while ( (items=fscanf(fp, "%s %u%[\r\n]", s, &val,c)) != EOF ) { 
-	//fprintf(stderr,"%s %d\n",strerror(errno),items);
-	if (errno) 
-		fatal_msg("Parse error at line %u char %ld: %s.\n",
-			lineno,ftell(fp)-line_offset, strerror(errno) );
-	
-	    cval = complexity(s);
+    while (readLine(r, &line)) {
+	if (!nextPair(&line, &key, &val))
+	    continue;
+	do {
+	    cval = complexity(h, spanToString(&key, s, sizeof(s)));
 	    zscore = ((float) cval - x1) / sigma;
 
 	    deleteKey = false;
@@ -345,24 +328,17 @@ void hashCol(FILE * fp)
 		    deleteKey = true;
 	    }
 
-	    if (!deleteKey)
-		printf("%s %u", s, val);
-
-
-	switch (items) {
-	        case 3:
-			printf("\n");
-			line_offset=ftell(fp);
-			lineno++;
-	     	break;		
-		case 2:
-			printf("\t");
-		break;	
-		default:
-			fatal_msg("Parse error at line %u char %ld.\n",
-			lineno,ftell(fp)-line_offset);
-		break;
-	}
+	    if (!deleteKey) {
+		writeString(out, s);
+		writeChar(out, ' ');
+		writeUlong(out, val);
+	    }
+
+	    rest = line;
+	    writeChar(out, nextField(&rest, &key) ? '\t' : '\n');
+	} while (nextPair(&line, &key, &val));
     }
+    readerClose(r);
+    writerClose(out);
 
 }
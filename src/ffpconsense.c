@@ -0,0 +1,1015 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#define _POSIX_C_SOURCE  200809L  // To use strdup
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include "vstring.h"
+#include "utils.h"
+#include "sighandle.h"
+#include "../config.h"
+
+char PROG_NAME[] = "ffpconsense";
+
+#define MAX_COL_NEWICK 55	/**< Maximum characters output per line in a tree */
+#define DEFAULT_THRESHOLD 50.0	/**< Percent of trees a split must exceed by default */
+#define INIT_NODES 256		/**< Initial node capacity of a tree buffer */
+#define INIT_SPLITS 1024	/**< Initial size of the split hash table */
+#define NOTEXT SIZE_MAX		/**< Offset of a missing name, label or length */
+#define NOBITS SIZE_MAX		/**< Offset of a split whose bitset is not stored */
+#define NOTREE UINT32_MAX	/**< Tree number of a split not yet counted */
+#define DELIMS "(),:;["		/**< Characters ending a name, label or length */
+
+#define bitWords(n) (((n) + 63) / 64)	/**< Words in the bitset of n taxa */
+#define setBit(b,i) ((b)[(i) / 64] |= (uint64_t) 1 << ((i) % 64))
+#define testBit(b,i) (((b)[(i) / 64] >> ((i) % 64)) & 1)
+#define support(s) (100.0 * (s)->count / ntrees)	/**< Percent of trees with split s */
+
+
+/**
+ * A node of a tree read from Newick input.
+ *
+ * Nodes are stored in the order their first character appears in
+ * the input, which is a preorder of the tree, so the subtree of node
+ * i occupies nodes i to end.
+ */
+typedef struct {
+    int parent;			/**< Parent node, -1 at the root */
+    int child;			/**< First child, -1 at a tip */
+    int sibling;		/**< Next child of the parent, or -1 */
+    int last;			/**< Last child, for appending */
+    int end;			/**< Last node in the subtree */
+    int taxon;			/**< Taxon number of a tip, -1 otherwise */
+    size_t name;		/**< Offset of the tip name or node label */
+    size_t length;		/**< Offset of the branch length text */
+} TNODE;
+
+/** A tree and the scratch space used to count its splits */
+typedef struct {
+    TNODE *node;		/**< Nodes in preorder */
+    int n;			/**< Number of nodes */
+    int size;			/**< Capacity of node and the arrays below */
+    uint64_t *f1, *f2;		/**< Fingerprint of each subtree */
+    int *tips;			/**< Number of tips in each subtree */
+    int zero;			/**< Tip of the first taxon */
+    char *text;			/**< Names, labels and lengths */
+    size_t textlen;		/**< Used bytes of text */
+    size_t textsize;		/**< Capacity of text */
+} TREEBUF;
+
+/**
+ * A bipartition of the taxa and the number of trees containing it.
+ *
+ * A split is identified by the side that excludes the first taxon.
+ * The fingerprint is the exclusive or of two random 64 bit keys
+ * per taxon on that side, so the fingerprint of a subtree follows
+ * from those of its children without building its bitset.  The
+ * bitset is only copied into the pool the second time a split is
+ * seen, or for the splits of the first tree.  Splits found in a
+ * single tree cannot be in a majority consensus of two or more
+ * trees, and they make up most of the distinct splits of noisy
+ * replicates.
+ */
+typedef struct {
+    uint64_t f1, f2;		/**< Fingerprint of the split */
+    uint32_t count;		/**< Number of trees containing the split */
+    uint32_t last;		/**< Last tree counted, to skip repeats */
+    uint32_t seq;		/**< Order first seen from 1, 0 if unused */
+    uint32_t tips;		/**< Taxa on the side without the first taxon */
+    size_t bits;		/**< Offset of the bitset in the pool */
+} SPLIT;
+
+void readTrees(FILE * fp);
+bool readTree(FILE * fp, TREEBUF * t);
+void addTaxa(TREEBUF * t);
+void hashTree(TREEBUF * t);
+int nodeSplit(TREEBUF * t, int i, uint64_t * f1, uint64_t * f2);
+void countSplits(TREEBUF * t, bool insert);
+SPLIT *findSplit(uint64_t f1, uint64_t f2);
+SPLIT *addSplit(uint64_t f1, uint64_t f2);
+void storeBits(SPLIT * s, TREEBUF * t, int i);
+void consensus(void);
+void annotate(TREEBUF * t);
+int cmpSupport(const void *a, const void *b);
+int cmpTips(const void *a, const void *b);
+int cmpKeys(const void *a, const void *b);
+
+char usage_str[] = "Usage: %s [OPTIONS] ... [FILE] ...\n\
+This program builds a majority rule consensus of the Newick\n\
+trees in the input, such as the trees of bootstrap replicates.\n\n\
+\t-e, --extended\t\tResolve with less supported splits.\n\
+\t-t P, --threshold=P\tKeep splits in more than P%% of trees [P=50].\n\
+\t-r FILE, --reference=FILE\tAnnotate support on the tree in FILE.\n\
+\t-v, --version\t\tVersion Info.\n\
+\t-h, --help\t\tThis message.\n\n\
+Copyright (c) %s\n\
+%s\n\
+Contact %s\n";
+
+bool extended = false;		//Option -e
+bool refmode = false;		//Option -r
+double threshold = DEFAULT_THRESHOLD;	//Option -t
+uint32_t ntrees = 0;		//Trees read
+int ntaxa = 0;			//Taxa in the first tree
+char **taxname = NULL;		//Taxa names
+int *namehash = NULL;		//Open addressing table of taxa numbers
+int namesize = 0;		//Size of namehash
+uint64_t *key1, *key2;		//Random fingerprint keys of each taxon
+uint64_t all1, all2;		//Fingerprint of all taxa
+uint32_t *seen;			//Last tree containing each taxon
+uint32_t stamp = 0;		//Trees hashed, to mark seen taxa
+SPLIT *splits = NULL;		//Open addressing table of splits
+size_t splitsize = 0;		//Size of splits
+size_t nsplits = 0;		//Used entries of splits
+uint64_t *pool = NULL;		//Stored split bitsets
+size_t poollen = 0, poolsize = 0;
+TREEBUF tree;			//Tree being counted
+
+
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    int opt;
+    char *rvalue = NULL;
+    char *end;
+    uint64_t f1, f2;
+    TREEBUF ref;
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"extended", no_argument, 0, 'e'},
+	{"threshold", required_argument, 0, 't'},
+	{"reference", required_argument, 0, 'r'},
+	{"help", no_argument, 0, 'h'},
+	{"version", no_argument, 0, 'v'},
+	{0, 0, 0, 0}
+    };
+
+    initSignalHandlers();
+
+    while ((opt = getopt_long(argc, argv, "et:r:vh",
+			      long_options, &option_index)) != -1)
+
+	switch (opt) {
+	case 'e':
+	    extended = true;
+	    break;
+	case 't':
+	    threshold = strtod(optarg, &end);
+	    if (end == optarg || *end || threshold < 50.0 || threshold >= 100.0)
+		fatal_msg("Threshold must be at least 50 and below 100\n");
+	    break;
+	case 'r':
+	    rvalue = optarg;
+	    refmode = true;
+	    break;
+	case 'v':
+	    printVersion();
+	    exit(EXIT_SUCCESS);
+	    break;
+	case 'h':
+	    printUsageStr();
+	    exit(EXIT_SUCCESS);
+	    break;
+	default:
+	    printErrorUsageStr();
+	    exit(EXIT_FAILURE);
+	    break;
+	}
+
+    /* The reference tree fixes the taxa and the only splits counted */
+    memset(&ref, 0, sizeof(TREEBUF));
+    if (rvalue) {
+	if ((fp = fopen(rvalue, "r")) == NULL)
+	    fatal_msg("%s: %s\n", rvalue, strerror(errno));
+	if (isDirectory(rvalue))
+	    fatal_msg("%s: %s\n", rvalue, strerror(EISDIR));
+	if (!readTree(fp, &ref))
+	    fatal_msg("%s: No tree found\n", rvalue);
+	fclose(fp);
+	addTaxa(&ref);
+	hashTree(&ref);
+	for (int i = 1; i < ref.n; i++)
+	    if (ref.node[i].child >= 0 && nodeSplit(&ref, i, &f1, &f2) > 0)
+		addSplit(f1, f2);
+    }
+
+    argv += optind;
+
+    do {
+	fp = stdin;
+	if (*argv) {
+	    if (!strcmp(*argv, "-"))
+		fp = stdin;
+	    else if ((fp = fopen(*argv, "r")) == NULL)
+		fatal_msg("%s: %s\n", *argv, strerror(errno));
+
+	    if (isDirectory(*argv))
+		fatal_msg("%s: %s\n", *argv, strerror(EISDIR));
+
+	    argv++;
+
+	} else if (isatty(STDIN_FILENO))
+	    printErrorUsageStr();
+
+	readTrees(fp);
+
+	if (fp != stdin)
+	    fclose(fp);
+
+    } while (*argv);
+
+    if (!ntrees)
+	fatal_msg("No trees found in input\n");
+
+    if (rvalue)
+	annotate(&ref);
+    else
+	consensus();
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/**
+ *
+ * Counts the splits of every tree in a stream.
+ *
+ * Trees are read one at a time, so memory does not grow with the
+ * number of trees, only with the number of distinct splits.  When
+ * a reference tree was given only its splits are counted.
+ *
+ * @param fp A file pointer to Newick trees.
+ * @return void
+ *
+ */
+
+void readTrees(FILE * fp)
+{
+    while (readTree(fp, &tree)) {
+	if (!ntaxa)
+	    addTaxa(&tree);
+	countSplits(&tree, !refmode);
+	ntrees++;
+    }
+}
+
+
+
+/* Returns the next character that is not white space or in a comment */
+static int nextChar(FILE * fp)
+{
+    int c;
+
+    while ((c = getc(fp)) != EOF) {
+	if (c == '[') {
+	    while ((c = getc(fp)) != EOF && c != ']');
+	    if (c == EOF)
+		fatal_msg("Unterminated comment in tree %u\n", ntrees + 1);
+	} else if (!isspace(c))
+	    break;
+    }
+    return c;
+}
+
+
+
+/* Reads a name, label or length starting with c into the tree text */
+static size_t readText(FILE * fp, TREEBUF * t, int c)
+{
+    size_t start = t->textlen;
+
+    do {
+	if (t->textlen + 1 >= t->textsize) {
+	    t->textsize = t->textsize ? 2 * t->textsize : INIT_NODES;
+	    if ((t->text = (char *) realloc(t->text, t->textsize)) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
+	}
+	t->text[t->textlen++] = c;
+    } while ((c = getc(fp)) != EOF && !isspace(c) && !strchr(DELIMS, c));
+
+    if (c != EOF)
+	ungetc(c, fp);
+    t->text[t->textlen++] = '\0';
+    return start;
+}
+
+
+
+/* Appends a node below parent */
+static int newNode(TREEBUF * t, int parent)
+{
+    TNODE *p;
+
+    if (t->n >= t->size) {
+	t->size = t->size ? 2 * t->size : INIT_NODES;
+	if ((t->node = (TNODE *) realloc(t->node,
+				sizeof(TNODE) * t->size)) == NULL ||
+	    (t->f1 = (uint64_t *) realloc(t->f1,
+				sizeof(uint64_t) * t->size)) == NULL ||
+	    (t->f2 = (uint64_t *) realloc(t->f2,
+				sizeof(uint64_t) * t->size)) == NULL ||
+	    (t->tips = (int *) realloc(t->tips,
+				sizeof(int) * t->size)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    p = &t->node[t->n];
+    p->parent = parent;
+    p->child = p->sibling = p->last = -1;
+    p->end = t->n;
+    p->taxon = -1;
+    p->name = p->length = NOTEXT;
+    t->f1[t->n] = t->f2[t->n] = 0;
+    t->tips[t->n] = 0;
+    if (parent >= 0) {
+	if (t->node[parent].last >= 0)
+	    t->node[t->node[parent].last].sibling = t->n;
+	else
+	    t->node[parent].child = t->n;
+	t->node[parent].last = t->n;
+    }
+    return t->n++;
+}
+
+
+
+/**
+ *
+ * Reads the next Newick tree of a stream.
+ *
+ * The tree is parsed without recursion, one character at a time,
+ * into the nodes of t.  Names, labels and branch lengths are kept
+ * as text.
+ *
+ * @param fp A file pointer to Newick trees.
+ * @param t The tree buffer to fill.
+ * @return false at the end of the stream.
+ *
+ */
+
+bool readTree(FILE * fp, TREEBUF * t)
+{
+    int c, x;
+    int cur = -1;
+
+    t->n = 0;
+    t->textlen = 0;
+
+    if ((c = nextChar(fp)) == EOF)
+	return false;
+
+    for (;;) {
+	/* a node starts */
+	if (c == '(') {
+	    cur = newNode(t, cur);
+	    c = nextChar(fp);
+	    continue;
+	}
+	if (c == EOF || strchr(DELIMS, c))
+	    fatal_msg("Missing taxon name in tree %u\n", ntrees + 1);
+	x = newNode(t, cur);
+	t->node[x].name = readText(fp, t, c);
+
+	/* a node ends, followed by its length and a delimiter */
+	for (;;) {
+	    if ((c = nextChar(fp)) == ':') {
+		if ((c = nextChar(fp)) == EOF || strchr(DELIMS, c))
+		    fatal_msg("Missing branch length in tree %u\n",
+			      ntrees + 1);
+		t->node[x].length = readText(fp, t, c);
+		c = nextChar(fp);
+	    }
+	    if (c == ')' && cur >= 0) {
+		x = cur;
+		t->node[x].end = t->n - 1;
+		cur = t->node[x].parent;
+		if ((c = nextChar(fp)) != EOF && !strchr(DELIMS, c))
+		    t->node[x].name = readText(fp, t, c);
+		else if (c != EOF)
+		    ungetc(c, fp);
+	    } else if (c == ',' && cur >= 0) {
+		c = nextChar(fp);
+		break;
+	    } else if (c == ';' && cur < 0) {
+		return true;
+	    } else
+		fatal_msg("Malformed tree %u\n", ntrees + 1);
+	}
+    }
+}
+
+
+
+/* Hash of a taxon name */
+static unsigned nameHash(const char *s)
+{
+    unsigned h = 2166136261u;
+
+    while (*s)
+	h = (h ^ (unsigned char) *s++) * 16777619u;
+    return h;
+}
+
+
+
+/* Finds the slot of a taxon name in namehash */
+static int nameSlot(const char *s)
+{
+    int i = nameHash(s) & (namesize - 1);
+
+    while (namehash[i] >= 0 && strcmp(taxname[namehash[i]], s))
+	i = (i + 1) & (namesize - 1);
+    return i;
+}
+
+
+
+/* Splitmix64 generator for the fingerprint keys */
+static uint64_t splitmix(uint64_t * x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+
+/**
+ *
+ * Takes the taxa from the tips of the first tree.
+ *
+ * Taxa are numbered in the order their names appear.  Each taxon
+ * gets two random keys for the split fingerprints from a fixed seed,
+ * so the output does not depend on the run.
+ *
+ * @param t The first tree.
+ * @return void
+ *
+ */
+
+void addTaxa(TREEBUF * t)
+{
+    int i, j;
+    uint64_t x = 1;
+
+    for (i = 0; i < t->n; i++)
+	if (t->node[i].child < 0)
+	    ntaxa++;
+
+    for (namesize = 16; namesize < 2 * ntaxa; namesize *= 2);
+    namehash = (int *) chkmalloc(sizeof(int), namesize);
+    for (i = 0; i < namesize; i++)
+	namehash[i] = -1;
+
+    taxname = (char **) chkmalloc(sizeof(char *), ntaxa);
+    key1 = (uint64_t *) chkmalloc(sizeof(uint64_t), ntaxa);
+    key2 = (uint64_t *) chkmalloc(sizeof(uint64_t), ntaxa);
+    seen = (uint32_t *) chkcalloc(sizeof(uint32_t), ntaxa);
+    all1 = all2 = 0;
+
+    for (i = 0, j = 0; i < t->n; i++)
+	if (t->node[i].child < 0) {
+	    taxname[j] = t->text + t->node[i].name;
+	    if (namehash[nameSlot(taxname[j])] >= 0)
+		fatal_msg("Taxon %s appears twice in tree %u\n",
+			  taxname[j], ntrees + 1);
+	    taxname[j] = strdup(taxname[j]);
+	    namehash[nameSlot(taxname[j])] = j;
+	    key1[j] = splitmix(&x);
+	    key2[j] = splitmix(&x);
+	    all1 ^= key1[j];
+	    all2 ^= key2[j];
+	    j++;
+	}
+}
+
+
+
+
+
+
+/**
+ *
+ * Numbers the tips of a tree and fingerprints its subtrees.
+ *
+ * Nodes are visited in reverse preorder, so the fingerprint and tip
+ * count of each subtree are complete when it is reached and can be
+ * added to its parent.  Every taxon must appear exactly once.
+ *
+ * @param t The tree.
+ * @return void
+ *
+ */
+
+void hashTree(TREEBUF * t)
+{
+    int i, j, tips = 0;
+    TNODE *p;
+
+    stamp++;
+    t->zero = -1;
+    for (i = t->n - 1; i >= 0; i--) {
+	p = &t->node[i];
+	if (p->child < 0) {
+	    j = namehash[nameSlot(t->text + p->name)];
+	    if (j < 0)
+		fatal_msg("Unknown taxon %s in tree %u\n",
+			  t->text + p->name, ntrees + 1);
+	    if (seen[j] == stamp)
+		fatal_msg("Taxon %s appears twice in tree %u\n",
+			  t->text + p->name, ntrees + 1);
+	    seen[j] = stamp;
+	    p->taxon = j;
+	    if (!j)
+		t->zero = i;
+	    t->f1[i] = key1[j];
+	    t->f2[i] = key2[j];
+	    t->tips[i] = 1;
+	    tips++;
+	}
+	if (i > 0) {
+	    t->f1[p->parent] ^= t->f1[i];
+	    t->f2[p->parent] ^= t->f2[i];
+	    t->tips[p->parent] += t->tips[i];
+	}
+    }
+
+    if (tips != ntaxa)
+	fatal_msg("Tree %u has %d of the %d taxa\n", ntrees + 1, tips, ntaxa);
+}
+
+
+
+/**
+ *
+ * Finds the split defined by the subtree of a node.
+ *
+ * The split is given by the side that excludes the first taxon,
+ * which is the complement of the subtree when the subtree holds it.
+ *
+ * @param t A tree passed to hashTree.
+ * @param i The node.
+ * @param f1 Returns the first half of the fingerprint.
+ * @param f2 Returns the second half of the fingerprint.
+ * @return The number of taxa on the side without the first taxon,
+ * or 0 if either side has fewer than two taxa.
+ *
+ */
+
+int nodeSplit(TREEBUF * t, int i, uint64_t * f1, uint64_t * f2)
+{
+    int tips = t->tips[i];
+
+    *f1 = t->f1[i];
+    *f2 = t->f2[i];
+    if (t->zero >= i && t->zero <= t->node[i].end) {
+	*f1 ^= all1;
+	*f2 ^= all2;
+	tips = ntaxa - tips;
+    }
+    return tips < 2 || tips > ntaxa - 2 ? 0 : tips;
+}
+
+
+
+/**
+ *
+ * Counts the splits of a tree.
+ *
+ * Each internal node below the root defines the split between its
+ * tips and the rest.  A split is counted once per tree, as the two
+ * children of a rooted tree define the same split.
+ *
+ * @param t The tree.
+ * @param insert Add splits not seen before, otherwise skip them.
+ * @return void
+ *
+ */
+
+void countSplits(TREEBUF * t, bool insert)
+{
+    int i, tips;
+    uint64_t f1, f2;
+    SPLIT *s;
+
+    hashTree(t);
+
+    for (i = 1; i < t->n; i++) {
+	if (t->node[i].child < 0 || !(tips = nodeSplit(t, i, &f1, &f2)))
+	    continue;
+	if ((s = insert ? addSplit(f1, f2) : findSplit(f1, f2)) == NULL ||
+	    s->last == ntrees)
+	    continue;
+	s->last = ntrees;
+	s->count++;
+	s->tips = tips;
+	if (insert && s->bits == NOBITS && (!ntrees || s->count == 2))
+	    storeBits(s, t, i);
+    }
+}
+
+
+
+/* Slot of a fingerprint in the split table */
+static SPLIT *splitSlot(uint64_t f1, uint64_t f2)
+{
+    size_t i = f1 & (splitsize - 1);
+
+    while (splits[i].seq && (splits[i].f1 != f1 || splits[i].f2 != f2))
+	i = (i + 1) & (splitsize - 1);
+    return &splits[i];
+}
+
+
+
+/**
+ *
+ * Looks up a split by its fingerprint.
+ *
+ * @param f1 The first half of the fingerprint.
+ * @param f2 The second half of the fingerprint.
+ * @return The split or NULL if it was never added.
+ *
+ */
+
+SPLIT *findSplit(uint64_t f1, uint64_t f2)
+{
+    SPLIT *s;
+
+    if (!splitsize)
+	return NULL;
+    s = splitSlot(f1, f2);
+    return s->seq ? s : NULL;
+}
+
+
+
+/**
+ *
+ * Looks up a split by its fingerprint, adding it when missing.
+ *
+ * The table is doubled when half full.  Two 64 bit fingerprints of
+ * the same split always agree, while different splits collide with
+ * negligible probability, so splits are not compared taxon by taxon.
+ *
+ * @param f1 The first half of the fingerprint.
+ * @param f2 The second half of the fingerprint.
+ * @return The split.
+ *
+ */
+
+SPLIT *addSplit(uint64_t f1, uint64_t f2)
+{
+    SPLIT *s, *old;
+    size_t i, oldsize;
+
+    if (2 * (nsplits + 1) > splitsize) {
+	old = splits;
+	oldsize = splitsize;
+	splitsize = splitsize ? 2 * splitsize : INIT_SPLITS;
+	splits = (SPLIT *) chkcalloc(sizeof(SPLIT), splitsize);
+	for (i = 0; i < oldsize; i++)
+	    if (old[i].seq)
+		*splitSlot(old[i].f1, old[i].f2) = old[i];
+	free(old);
+    }
+
+    s = splitSlot(f1, f2);
+    if (!s->seq) {
+	s->f1 = f1;
+	s->f2 = f2;
+	s->count = 0;
+	s->last = NOTREE;
+	s->seq = ++nsplits;
+	s->bits = NOBITS;
+    }
+    return s;
+}
+
+
+
+/**
+ *
+ * Copies the bitset of a split into the pool.
+ *
+ * The tips of the subtree of node i are nodes i to end, so the
+ * bitset is built from that range and complemented when it holds
+ * the first taxon.
+ *
+ * @param s The split.
+ * @param t A tree passed to hashTree.
+ * @param i The node defining the split.
+ * @return void
+ *
+ */
+
+void storeBits(SPLIT * s, TREEBUF * t, int i)
+{
+    int j, w = bitWords(ntaxa);
+    uint64_t *b;
+
+    if (poollen + w > poolsize) {
+	poolsize = poolsize ? 2 * poolsize : (size_t) INIT_SPLITS * w;
+	if ((pool = (uint64_t *) realloc(pool,
+				sizeof(uint64_t) * poolsize)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    s->bits = poollen;
+    b = pool + poollen;
+    poollen += w;
+
+    memset(b, 0, sizeof(uint64_t) * w);
+    for (j = i; j <= t->node[i].end; j++)
+	if (t->node[j].taxon >= 0)
+	    setBit(b, t->node[j].taxon);
+
+    if (testBit(b, 0)) {
+	for (j = 0; j < w; j++)
+	    b[j] = ~b[j];
+	if (ntaxa % 64)
+	    b[w - 1] &= ((uint64_t) 1 << (ntaxa % 64)) - 1;
+    }
+}
+
+
+
+/* Tests if two splits can be in the same tree */
+static bool compatible(uint64_t * a, uint64_t * b, int w)
+{
+    bool disjoint = true, asub = true, bsub = true;
+    int k;
+
+    for (k = 0; k < w; k++) {
+	if (a[k] & b[k])
+	    disjoint = false;
+	if (a[k] & ~b[k])
+	    asub = false;
+	if (b[k] & ~a[k])
+	    bsub = false;
+	if (!disjoint && !asub && !bsub)
+	    return false;
+    }
+    return true;
+}
+
+
+
+/* Writes the subtree of node v of the consensus tree */
+static void writeNode(int v, int root, int *child, int *sibling,
+		      SPLIT ** acc, int *col)
+{
+    int c;
+
+    if (v < ntaxa) {
+	*col += printf("%s:%.1f", taxname[v], 100.0);
+	return;
+    }
+
+    putchar('(');
+    (*col)++;
+    for (c = child[v]; c >= 0; c = sibling[c]) {
+	writeNode(c, root, child, sibling, acc, col);
+	if (sibling[c] >= 0) {
+	    putchar(',');
+	    if (++(*col) > MAX_COL_NEWICK) {
+		putchar('\n');
+		*col = 0;
+	    }
+	}
+    }
+    putchar(')');
+    (*col)++;
+    if (v != root)
+	*col += printf(":%.1f", support(acc[v - ntaxa]));
+}
+
+
+
+/**
+ *
+ * Builds and prints the consensus tree.
+ *
+ * The splits in more than the threshold percent of the trees are
+ * always compatible.  With extended consensus the splits found in
+ * at least two trees are then added in order of support when they
+ * are compatible with those already taken, until the tree is fully
+ * resolved.  The branch lengths are the percent of the trees with
+ * the split below them.
+ *
+ * @return void
+ *
+ */
+
+void consensus(void)
+{
+    SPLIT **cand, **acc, *s;
+    int i, j, k, m = 0, na = 0, nc = 0, w = bitWords(ntaxa);
+    int n, root, col = 0;
+    int *owner, *up, *child, *sibling, *last;
+    uint64_t *keys, word;
+
+    cand = (SPLIT **) chkmalloc(sizeof(SPLIT *), nsplits + 1);
+    for (i = 0; i < (int) splitsize; i++) {
+	s = &splits[i];
+	if (s->seq && s->bits != NOBITS &&
+	    (support(s) > threshold || (extended && s->count > 1)))
+	    cand[nc++] = s;
+    }
+    qsort(cand, nc, sizeof(SPLIT *), cmpSupport);
+
+    acc = (SPLIT **) chkmalloc(sizeof(SPLIT *), nc + 1);
+    for (i = 0; i < nc && na < ntaxa - 3; i++) {
+	s = cand[i];
+	if (support(s) <= threshold) {
+	    for (j = 0; j < na; j++)
+		if (!compatible(pool + s->bits, pool + acc[j]->bits, w))
+		    break;
+	    if (j < na)
+		continue;
+	}
+	acc[na++] = s;
+    }
+    free(cand);
+
+    /*
+     * Nodes are the taxa, then the splits in acc, then the root.  The
+     * parent of a taxon or split is the smallest split containing it.
+     */
+    qsort(acc, na, sizeof(SPLIT *), cmpTips);
+    n = ntaxa + na;
+    root = n;
+    owner = (int *) chkmalloc(sizeof(int), ntaxa);
+    up = (int *) chkmalloc(sizeof(int), n);
+    for (i = 0; i < ntaxa; i++)
+	owner[i] = -1;
+    for (i = 0; i < n; i++)
+	up[i] = root;
+
+    keys = (uint64_t *) chkmalloc(sizeof(uint64_t), n);
+    for (i = 0; i < ntaxa; i++)
+	keys[i] = (uint64_t) i << 32 | i;
+    for (m = 0; m < na; m++) {
+	keys[ntaxa + m] = 0;
+	for (k = 0; k < w; k++)
+	    for (word = pool[acc[m]->bits + k], j = 0; word; word >>= 1, j++)
+		if (word & 1) {
+		    i = 64 * k + j;
+		    if (!keys[ntaxa + m])
+			keys[ntaxa + m] = (uint64_t) i << 32 | (ntaxa + m);
+		    if (owner[i] < 0)
+			up[i] = ntaxa + m;
+		    else if (up[owner[i]] == root)
+			up[owner[i]] = ntaxa + m;
+		    owner[i] = ntaxa + m;
+		}
+    }
+
+    /* Children are listed in order of their first taxon */
+    qsort(keys, n, sizeof(uint64_t), cmpKeys);
+    child = (int *) chkmalloc(sizeof(int), n + 1);
+    sibling = (int *) chkmalloc(sizeof(int), n + 1);
+    last = (int *) chkmalloc(sizeof(int), n + 1);
+    for (i = 0; i <= n; i++)
+	child[i] = sibling[i] = last[i] = -1;
+    for (i = 0; i < n; i++) {
+	j = keys[i] & 0xffffffff;
+	if (last[up[j]] >= 0)
+	    sibling[last[up[j]]] = j;
+	else
+	    child[up[j]] = j;
+	last[up[j]] = j;
+    }
+
+    writeNode(root, root, child, sibling, acc, &col);
+    printf(";\n");
+
+    free(acc);
+    free(owner);
+    free(up);
+    free(keys);
+    free(child);
+    free(sibling);
+    free(last);
+}
+
+
+
+/* Writes the subtree of node i of the reference tree */
+static void writeRef(TREEBUF * t, int i, int *col)
+{
+    int c;
+    uint64_t f1, f2;
+    SPLIT *s;
+    TNODE *p = &t->node[i];
+
+    if (p->child >= 0) {
+	putchar('(');
+	(*col)++;
+	for (c = p->child; c >= 0; c = t->node[c].sibling) {
+	    writeRef(t, c, col);
+	    if (t->node[c].sibling >= 0) {
+		putchar(',');
+		if (++(*col) > MAX_COL_NEWICK) {
+		    putchar('\n');
+		    *col = 0;
+		}
+	    }
+	}
+	putchar(')');
+	(*col)++;
+    }
+
+    if (p->child < 0 || !i) {
+	if (p->name != NOTEXT)
+	    *col += printf("%s", t->text + p->name);
+    } else if (!nodeSplit(t, i, &f1, &f2))
+	*col += printf("%.1f", 100.0);
+    else
+	*col += printf("%.1f", (s = findSplit(f1, f2)) ? support(s) : 0.0);
+
+    if (p->length != NOTEXT)
+	*col += printf(":%s", t->text + p->length);
+}
+
+
+
+/**
+ *
+ * Prints the reference tree with the support of its splits.
+ *
+ * The percent of the trees containing the split below each internal
+ * node replaces its label.  Names and branch lengths are written as
+ * they were read.
+ *
+ * @param t The reference tree.
+ * @return void
+ *
+ */
+
+void annotate(TREEBUF * t)
+{
+    int col = 0;
+
+    writeRef(t, 0, &col);
+    printf(";\n");
+}
+
+
+
+/* Orders splits by decreasing support, then as first seen */
+int cmpSupport(const void *a, const void *b)
+{
+    const SPLIT *x = *(SPLIT * const *) a;
+    const SPLIT *y = *(SPLIT * const *) b;
+
+    if (x->count != y->count)
+	return x->count < y->count ? 1 : -1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+
+
+/* Orders splits by increasing number of taxa */
+int cmpTips(const void *a, const void *b)
+{
+    const SPLIT *x = *(SPLIT * const *) a;
+    const SPLIT *y = *(SPLIT * const *) b;
+
+    if (x->tips != y->tips)
+	return x->tips < y->tips ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+
+
+/* Orders 64 bit keys */
+int cmpKeys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return x < y ? -1 : x > y;
+}
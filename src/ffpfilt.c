@@ -34,7 +34,7 @@ char PROG_NAME[FILENAME_MAX];
 #define MAX_WORD_LENGTH 40 /**< Maximum feature length */
 #define DEFAULT_PRECISION 2
 
-void hashCol(FILE * fp);
+void hashCol(HASHTABLE * h, FILE * fp);
 int isKeyBased(FILE * fp);
 int getKeyLength(FILE * fp);
 
@@ -59,7 +59,6 @@ Copyright (c) %s\n\
 Contact %s\n";
 
 
-char *weightVector;
 
 int Length = MAX_WORD_LENGTH;
 			    /**< Feature length */
@@ -84,6 +83,7 @@ float lower = INT_MIN;
 int main(int argc, char **argv)
 {
     FILE *fp = NULL;
+    HASHTABLE *h;
     int opt;
     int mode = nucleotide;
     int option_index = 0;
@@ -174,7 +174,7 @@ int main(int argc, char **argv)
 	mode = text;
 
 
-    initHash(0, mode, !dflag);
+    h = hashCreate(mode, !dflag, NULL);
     struct stat input;
 
 
@@ -196,20 +196,20 @@ int main(int argc, char **argv)
 	    printErrorUsageStr();
 
 	if (!isRegularFile(fp)) 
-	    fp = convertPipeToFile(fp);
+	    fp = rewindablePipe(fp);
 
 	if (!isKeyBased(fp))
 	    fatal_msg("%s: Not a key valued FFP.", *argv);
 
 	Length = getKeyLength(fp);
-	hashCol(fp);
+	hashCol(h, fp);
 
 	if (fp != stdin)
 	    fclose(fp);
 
     } while (*argv);
 
-
+    hashDestroy(h);
     return EXIT_SUCCESS;
 }
 
@@ -219,20 +219,23 @@ int main(int argc, char **argv)
  *
  * FFP in fp must be columnar FFP.
  *
+ * @param h The hash of the features
  * @param fp A file pointer to a (key,value) FFP
  * @return none
  */
 
 
 
-void hashCol(FILE * fp)
+void hashCol(HASHTABLE * h, FILE * fp)
 {
+    READER *r = readerOpen(fp);
+    WRITER *out = writerOpen(stdout);
+    SPAN line, key;
+    unsigned long v;
     unsigned val;
-    char s[Length];
+    char s[Length + 1];
     char **keys;
     unsigned i;
-    char c[2];
-    int d;
     double x1 = 0;
     double x2 = 0;
     double sigma;
@@ -245,17 +248,19 @@ void hashCol(FILE * fp)
 
     // Find all keys in the file.
 
-    while (!feof(fp)) {
-	d = fscanf(fp, "%s %u%*[\t]%[\n]", s, &val, c);
-	s[Length] = '\0';
-	//calc stats here.
-	x1 += val;
-	x2 += val * val;
-	hashMax(s, val);	// Add to hash if greater than existing val
-	ctr++;
-	if (d == 3) {
-	    row++;
-	}
+    while (readLine(r, &line)) {
+	if (!nextPair(&line, &key, &v))
+	    continue;
+	do {
+	    spanToString(&key, s, sizeof(s));
+	    val = v;
+	    //calc stats here.
+	    x1 += val;
+	    x2 += val * val;
+	    hashMax(h, s, val);	// Add to hash if greater than existing val
+	    ctr++;
+	} while (nextPair(&line, &key, &v));
+	row++;
     }
 
     if (zflag)
@@ -275,12 +280,12 @@ void hashCol(FILE * fp)
 		pvalue, alpha, pvalue, beta);
 
 
-    hashKeys(&keys);
+    hashKeys(h, &keys);
 
-    num = numKeys();
+    num = numKeys(h);
     // delete any keys outside the range 
     for (i = 0; i < num; i++) {
-	val = hashval(keys[i]);
+	val = hashval(h, keys[i]);
 	deleteKey = false;
 	zscore = ((float) val - x1) / sigma;
 
@@ -302,45 +307,41 @@ void hashCol(FILE * fp)
 	}
 
 	if (!deleteKey)
-	    hashAssign(keys[i], 1);
+	    hashAssign(h, keys[i], 1);
 	else
-	    hashDel(keys[i]);
-
+	    hashDel(h, keys[i]);
+	free(keys[i]);
     }
+    free(keys);
 
     // grab updated set of keys
-    hashKeys(&keys);
-    rewind(fp);
-    d = 0;
-    while (d != EOF) {
-	while ((d = fscanf(fp, "%s %u%[\r\n]", s, &val, c)) != EOF) {
-	    s[Length] = '\0';
-	    if (hashval(s)) {
-		hashAssign(s, val);
-	    }
-
-	    if (d == 3)
-		break;
-	}
-	if (d == 3) {
-	    if (kflag) { 
-	    	for (i = 0; i < numKeys()-1; i++) {
-			printf("%s\t%u\t",keys[i], hashval(keys[i]));
-			hashAssign(keys[i], 1);
-	    	}
-		printf("%s\t%u\n",keys[i], hashval(keys[i]));
-		hashAssign(keys[i], 1);
-
-	    } else {	    
-	    	for (i = 0; i < numKeys()-1; i++) {
-			printf("%u\t", hashval(keys[i]));
-			hashAssign(keys[i], 1);
-	    	}
-	    printf("%u\n", hashval(keys[i]));
-	    hashAssign(keys[i], 1);
+    hashKeys(h, &keys);
+    readerRewind(r);
+    while (readLine(r, &line)) {
+	if (!nextPair(&line, &key, &v))
+	    continue;
+	do {
+	    spanToString(&key, s, sizeof(s));
+	    if (hashval(h, s))
+		hashAssign(h, s, v);
+	} while (nextPair(&line, &key, &v));
+
+	for (i = 0; i < numKeys(h); i++) {
+	    if (kflag) {
+		writeString(out, keys[i]);
+		writeChar(out, '\t');
 	    }
+	    writeUlong(out, hashval(h, keys[i]));
+	    writeChar(out, i + 1 < numKeys(h) ? '\t' : '\n');
+	    hashAssign(h, keys[i], 1);
 	}
     }
+    readerClose(r);
+    writerClose(out);
+
+    for (i = 0; i < numKeys(h); i++)
+	free(keys[i]);
+    free(keys);
 }
 
 
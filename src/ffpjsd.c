@@ -21,7 +21,11 @@
 #include <errno.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "utils.h"
+#include "profile.h"
+#include "dmatrix.h"
 #include "vstring.h"
 #include "sighandle.h"
 #include "../config.h"
@@ -32,9 +36,18 @@ char PROG_NAME[FILENAME_MAX];/**< Program name */
 #define DEFAULT_PRECISION 2 /**< Default precision for floating point output */
 #define DEFAULT_NORM 2 /**< Default Norm for the Euclidean Distance Function */
 #define STR_BUFF 255
+#define DB_BLOCK 256 /**< Database rows scanned by a thread at a time in query mode */
+#define LOG2_TABLE_SIZE 65536 /**< Counts below this value use the log2 lookup table */
+#define lg(c) ((c) < LOG2_TABLE_SIZE ? log2Table[(int) (c)] : log2(c)) /**< log2 of a count */
 
 int jsd(FILE * fp, double **D);
 int jsdr(FILE * fp, double **D);
+int jsdQuery(FILE * fp, PROFILES * db, double **D);
+void makeDatabase(FILE * fp, char *fname);
+int jsdc(FILE * fp, double **D);
+int jsdcr(FILE * fp, double **D);
+double jsdCounts(PROFILES * p, uint32_t i, uint32_t j, double *total,
+		 double *lgtotal);
 int euclidean_dist(FILE * fp, double **D);
 int cosine_dist(FILE * fp, double **D);
 int manhattan_dist(FILE * fp, double **D);
@@ -59,9 +72,16 @@ int gower_dist(FILE * fp, double **D);
 int kulczynski_dist(FILE * fp, double **D);
 float pearsons(double *x, double *y, int length);
 int pearson_matrix(FILE * fp, double **D);
-void printMatrix(double *D, int n);
-void printInfile(double *D, int n);
-void printLine(double *D, int n);
+void printMatrix(FILE * out, double *D, size_t first, int n);
+void printInfile(FILE * out, double *D, size_t first, int n);
+void printLine(double *D, size_t first, int n);
+void writeBinary(FILE * out, double *D, size_t first, int n);
+void parseMetrics(char *list);
+int metricMatrices(FILE * fp, double **D);
+int pairMatrices(PROFILES * p, double **D);
+void bootstrapMatrices(FILE * fp, int n, unsigned seed, char *pvalue);
+void printDistances(double *D, int rows, char *pvalue, char xflag, int set);
+void printMetrics(double *D, int n, char pflag, int set);
 
 char usage_str[] = "Usage: %s [OPTION] vector ... \n\
 Calculates a distance/divergence matrix from a columnar FFP.\n\n\
@@ -70,7 +90,17 @@ generate a symmetric distance matrix.  The default distance used\n\
 is the Jensen Shannon Divergence (JSD)\n\
 \t-p FILE, --phylip=FILE\tPrint phylip output\n\
 \t-d INT, --precision=INT\tSpecify decimal precision of matrix\n\
+\t-x, --binary\t\tWrite a binary matrix for ffptree, names from -p\n\
 \t-r INT, --row=INT\tCalculate the INTth row of a JSD matrix\n\
+\t-F FILE, --make-db=FILE\tWrite the FFP as a binary database\n\
+\t-f FILE, --db=FILE\tCalculate JSD rows of each FFP row against a database\n\
+\t-T INT, --threads=INT\tNumber of threads used with -f\n\
+\t-i, --counts\t\tJSD of raw counts, ffprwn is not needed\n\
+\t-X LIST, --metrics=LIST\tCalculate the comma separated metrics in one pass\n\
+\t-O NAME, --prefix=NAME\tPrefix of the -X matrix files, NAME.metric\n\
+\t-z, --float32\t\tStore profiles and matrices in single precision\n\
+\t-W N, --bootstrap=N\tMatrices of N bootstrap replicates of the FFP\n\
+\t-Q INT, --seed=INT\tRandom seed of -W\n\
 \t-e, --euclid\t\tEuclidean Distance\n\
 \t-E, --euclid2\t\tSquared Euclidean distance\n\
 \t-n, --normval\t\tNorm val for -e, Default is 2\n\
@@ -107,7 +137,8 @@ Contact %s\n";
 enum dist_modes { jensen_shannon, euclidean, cosine, manhattan, pearson_r,
     chebyshev, jaccard, tanimoto, dice, hamming, yule,
     russel, matching, hamann, antidice, sneath, ochiai,
-    euclidean2, canberra, anderberg, phi, gower, kulczynski,evolution
+    euclidean2, canberra, anderberg, phi, gower, kulczynski,evolution,
+    several
 };
 enum matrix_modes { similarity, distance };
 
@@ -122,11 +153,55 @@ char rflag = 0;
 	      /**< -l Option for calculating specific line in JSD */
 int rflagN = 0;
 char qFlag = 0;
+int threads = 1; /**< Worker threads used to scan a database */
+double log2Table[LOG2_TABLE_SIZE]; /**< log2 of small integers, see jsdCounts */
+char float32 = 0; /**< -z Single precision profiles and matrices */
+char binary = 0; /**< -x Write binary distance matrices */
+unsigned *weight = NULL; /**< -W Column multiplicities of a bootstrap replicate */
+double *rowSum = NULL; /**< -W Weighted row sums of a bootstrap replicate */
+
+/*
+ * Matrices built from profiles hold floats when float32 is
+ * set.  They are still passed around as double pointers, so
+ * they must only be allocated with newD and accessed with
+ * putD and getD.  Sums are always accumulated in double.
+ */
+#define newD(n) chkmalloc(float32 ? sizeof(float) : sizeof(double), (n)) /**< Allocates a matrix of n entries */
+#define putD(D,k,v) (float32 ? (((float *) (D))[k] = (v)) : ((D)[k] = (v))) /**< Stores v in entry k */
+#define getD(D,k) (float32 ? ((float *) (D))[k] : (D)[k]) /**< Entry k as a double */
+
+/**
+ * Names of the metrics accepted by -X, the long option names
+ */
+static const struct {
+    char *name;		/**< Metric name */
+    char mode;		/**< Corresponding dist_modes value */
+    char similar;	/**< Diagonal is 1 in a similarity matrix */
+} metricNames[] = {
+    {"jsd", jensen_shannon, 0}, {"euclid", euclidean, 0},
+    {"euclid2", euclidean2, 0}, {"canberra", canberra, 0},
+    {"cosine", cosine, 1}, {"manhattan", manhattan, 0},
+    {"pearson", pearson_r, 1}, {"chebyshev", chebyshev, 0},
+    {"jaccard", jaccard, 1}, {"tanimoto", tanimoto, 1},
+    {"dice", dice, 1}, {"hamming", hamming, 0},
+    {"evol", evolution, 0}, {"yule", yule, 1},
+    {"russel", russel, 1}, {"matching", matching, 1},
+    {"hamman", hamann, 1}, {"antidice", antidice, 1},
+    {"sneath", sneath, 1}, {"ochiai", ochiai, 1},
+    {"anderberg", anderberg, 1}, {"phi", phi, 1},
+    {"gower", gower, 1}, {"kulczynski", kulczynski, 1}
+};
+#define NUM_METRICS (sizeof(metricNames) / sizeof(metricNames[0]))
+
+int metrics[NUM_METRICS]; /**< Indices into metricNames of the -X metrics */
+int numMetrics = 0;	/**< Number of -X metrics */
+char *metricPrefix = "ffpjsd"; /**< Prefix of the -X matrix file names */
 
 int main(int argc, char **argv)
 {
     FILE *fp;
-    FILE *pp;
+    FILE *in;
+    bool more;
     int opt;
     unsigned rows = 0;
     char dist_mode = jensen_shannon;
@@ -134,10 +209,19 @@ int main(int argc, char **argv)
     char dflag = 0;
     int dvalue = 0;
     char *pvalue = NULL;
-    int i;
+    char *fvalue = NULL;
+    char *Fvalue = NULL;
+    char iflag = 0;
+    char xflag = 0;
+    int Wvalue = 0;
+    char Qflag = 0;
+    unsigned seed = 0;
+    PROFILES *db = NULL;
+    int i, c;
+    int format;
+    int set;
     double *D = NULL;
     int option_index = 0;
-    char buffer[STR_BUFF];
 
     static struct option long_options[] = {
 	{"phylip", required_argument, 0, 'p'},
@@ -171,6 +255,16 @@ int main(int argc, char **argv)
 	{"similarity", no_argument, 0, 's'},
 	{"help", no_argument, 0, 'h'},
 	{"quiet", no_argument, 0, 'q'},
+	{"db", required_argument, 0, 'f'},
+	{"make-db", required_argument, 0, 'F'},
+	{"threads", required_argument, 0, 'T'},
+	{"counts", no_argument, 0, 'i'},
+	{"metrics", required_argument, 0, 'X'},
+	{"prefix", required_argument, 0, 'O'},
+	{"float32", no_argument, 0, 'z'},
+	{"binary", no_argument, 0, 'x'},
+	{"bootstrap", required_argument, 0, 'W'},
+	{"seed", required_argument, 0, 'Q'},
 	{0, 0, 0, 0}
     };
 
@@ -178,7 +272,7 @@ int main(int argc, char **argv)
 
     strcpy(PROG_NAME,basename( argv[0] ));
 
-    while ((opt = getopt_long(argc, argv, "abp:d:ghkevr:cmBERCDHMNSPsn:ojtyuqL",
+    while ((opt = getopt_long(argc, argv, "abp:d:ghkevr:cmBERCDHMNSPsn:ojtyuqLf:F:T:iX:O:zxW:Q:",
 			      long_options, &option_index)) != -1)
 	switch (opt) {
 	case 'p':
@@ -281,6 +375,42 @@ int main(int argc, char **argv)
 	case 's':
 	    matrix_mode = similarity;
 	    break;
+	case 'f':
+	    fvalue = optarg;
+	    break;
+	case 'F':
+	    Fvalue = optarg;
+	    break;
+	case 'T':
+	    threads = atoi(optarg);
+	    if (threads < 1)
+		fatal_msg("Number of threads must be at least 1\n");
+	    break;
+	case 'i':
+	    iflag = 1;
+	    break;
+	case 'X':
+	    xflag = 1;
+	    parseMetrics(optarg);
+	    break;
+	case 'O':
+	    metricPrefix = optarg;
+	    break;
+	case 'z':
+	    float32 = 1;
+	    break;
+	case 'x':
+	    binary = 1;
+	    break;
+	case 'W':
+	    Wvalue = atoi(optarg);
+	    if (Wvalue < 1)
+		fatal_msg("Number of replicates must be at least 1\n");
+	    break;
+	case 'Q':
+	    Qflag = 1;
+	    seed = atoi(optarg);
+	    break;
 	default:
 	    printErrorUsageStr();
 	    break;
@@ -290,6 +420,57 @@ int main(int argc, char **argv)
     if (dflag)
 	precision = dvalue;
 
+    if ((fvalue || Fvalue) && dist_mode != jensen_shannon)
+	fatal_msg("Options -f and -F only work with the JSD metric\n");
+
+    if (fvalue && Fvalue)
+	fatal_msg("Specify -f or -F, not both\n");
+
+    if ((fvalue || Fvalue) && (rflag || pflag))
+	fatal_msg("Options -f and -F cannot be used with -r or -p\n");
+
+    if (binary && (rflag || fvalue || Fvalue))
+	fatal_msg("Option -x cannot be used with -r, -f or -F\n");
+
+    if (Fvalue && (argc - optind) > 1)
+	fatal_msg("Specify only one File argument with -F\n");
+
+    if (xflag) {
+	if (rflag || iflag || fvalue || Fvalue)
+	    fatal_msg("Option -X cannot be used with -r, -i, -f or -F\n");
+	if ((argc - optind) > 1)
+	    fatal_msg("Specify only one File argument with -X\n");
+	dist_mode = several;
+    }
+
+    if (iflag && dist_mode != jensen_shannon)
+	fatal_msg("Option -i only works with the JSD metric\n");
+
+    if (iflag && (fvalue || Fvalue))
+	fatal_msg("Option -i cannot be used with -f or -F\n");
+
+    if (Wvalue) {
+	if (rflag || xflag || fvalue || Fvalue)
+	    fatal_msg("Option -W cannot be used with -r, -X, -f or -F\n");
+	if (dist_mode == pearson_r)
+	    fatal_msg("Option -W does not work with the Pearson metric\n");
+	if (!Qflag)
+	    seed = (unsigned) time(NULL) * getpid();
+	// replicates are normalized by their weighted row sums
+	iflag = 0;
+    }
+
+    // single precision and bootstrap matrices are only built from profiles
+    if ((float32 || Wvalue) && !xflag && !rflag && !iflag && !fvalue
+	&& !Fvalue) {
+	for (i = 0; metricNames[i].mode != dist_mode; i++);
+	metrics[numMetrics++] = i;
+	dist_mode = several;
+    }
+
+    if (fvalue)
+	db = mapProfiles(fvalue);
+
 // process file arguments 
     argv += optind;
 
@@ -308,123 +489,161 @@ int main(int argc, char **argv)
 	} else if (isatty(STDIN_FILENO))
 	    printErrorUsageStr();
 
-	// must confirm seekabilitiy
+	if (Fvalue) {
+	    makeDatabase(fp, Fvalue);
+	    if (fp != stdin)
+		fclose(fp);
+	    continue;
+	}
 
-	if (!isRegularFile(fp)) {
-	    fp = convertPipeToFile(fp);
+	if (db) {
+	    rows = jsdQuery(fp, db, &D);
+	    for (i = 0; i < rows; i++)
+		printLine(D, (size_t) i * db->rows, db->rows);
+	    free(D);
+	    if (fp != stdin)
+		fclose(fp);
+	    continue;
 	}
 
+	// must confirm seekabilitiy
 
-	switch (dist_mode) {
-	case euclidean:
-	    rows = euclidean_dist(fp, &D);
-	    break;
-	case euclidean2:
-	    rows = euclidean2_dist(fp, &D);
-	    break;
-	case cosine:
-	    rows = cosine_dist(fp, &D);
-	    break;
-	case manhattan:
-	    rows = manhattan_dist(fp, &D);
-	    break;
-	case pearson_r:
-	    rows = pearson_matrix(fp, &D);
-	    break;
-	case chebyshev:
-	    rows = chebyshev_dist(fp, &D);
-	    break;
-	case jaccard:
-	    rows = jaccard_dist(fp, &D);
-	    break;
-	case tanimoto:
-	    rows = tanimoto_dist(fp, &D);
-	    break;
-	case dice:
-	    rows = dice_dist(fp, &D);
-	    break;
-	case hamming:
-	    rows = hamming_dist(fp, &D);
-	    break;
-	case evolution:
-	    rows = evolution_dist(fp, &D);
-	    break;
-	case yule:
-	    rows = yule_dist(fp, &D);
-	    break;
-	case russel:
-	    rows = russel_dist(fp, &D);
-	    break;
-	case hamann:
-	    rows = hamann_dist(fp, &D);
-	    break;
-	case antidice:
-	    rows = antidice_dist(fp, &D);
-	    break;
-	case sneath:
-	    rows = sneath_dist(fp, &D);
-	    break;
-	case ochiai:
-	    rows = ochiai_dist(fp, &D);
-	    break;
-	case canberra:
-	    rows = canberra_dist(fp, &D);
-	    break;
-	case anderberg:
-	    rows = anderberg_dist(fp, &D);
-	    break;
-	case phi:
-	    rows = phi_dist(fp, &D);
-	    break;
-	case gower:
-	    rows = gower_dist(fp, &D);
-	    break;
-	case kulczynski:
-	    rows = kulczynski_dist(fp, &D);
-	    break;
-	case matching:
-	    rows = matching_dist(fp, &D);
-	    break;
-	case jensen_shannon:
-	    if (rflag)
-		rows = jsdr(fp, &D);
-	    else
-		rows = jsd(fp, &D);
-	    break;
+	if (!isRegularFile(fp)) {
+	    fp = rewindablePipe(fp);
 	}
 
+	/* sparse and binary FFPs are only read as profiles */
+	format = profileFormat(fp);
+	if (format != PROFILE_DENSE && dist_mode != several &&
+	    (dist_mode != jensen_shannon || !(iflag || rflag))) {
+	    for (i = 0; metricNames[i].mode != dist_mode; i++);
+	    metrics[numMetrics++] = i;
+	    dist_mode = several;
+	}
 
-	if (pflag)		// if phylip format requested
-	{
-	    if ((pp = fopen(pvalue, "r")) == NULL) {
-		fprintf(stderr, "Error opening file %s", pvalue);
-		exit(1);
+	/*
+	 * Each set of rows, e.g. from ffpboot -n, gives its own matrix.
+	 * Binary sets follow one another and are read in place.
+	 */
+	in = fp;
+	set = 0;
+	do {
+	    set++;
+	    if (format == PROFILE_BINARY) {
+		if ((c = getc(in)) != EOF)
+		    ungetc(c, in);
+		if (c == EOF)
+		    break;
+	    } else
+		fp = nextSet(in, &more);
+
+	    if (Wvalue) {
+		bootstrapMatrices(fp, Wvalue, seed, pvalue);
+		if (fp != in)
+		    fclose(fp);
+		continue;
 	    }
 
-	    taxaNames = (char **) malloc(sizeof(char *) * rows);
-	    for (i = 0; i < rows; i++) {
-		taxaNames[i] =
-		    (char *) malloc(sizeof(char) * (TAXANAMELEN + 1));
-		if (!fscanf(pp, "%s", buffer)) 
-			fatal_msg("%: Read zero items.",pvalue);
-		if (strlen(buffer) > TAXANAMELEN) {
-		    if (!qFlag) 	
-		    warn_msg("Taxaname: %s greater than %d. Truncating.\n",
-			    buffer, TAXANAMELEN);
-		    buffer[10] = '\0';
-		}
-		strcpy(taxaNames[i], buffer);
+	    switch (dist_mode) {
+	    case euclidean:
+		rows = euclidean_dist(fp, &D);
+		break;
+	    case euclidean2:
+		rows = euclidean2_dist(fp, &D);
+		break;
+	    case cosine:
+		rows = cosine_dist(fp, &D);
+		break;
+	    case manhattan:
+		rows = manhattan_dist(fp, &D);
+		break;
+	    case pearson_r:
+		rows = pearson_matrix(fp, &D);
+		break;
+	    case chebyshev:
+		rows = chebyshev_dist(fp, &D);
+		break;
+	    case jaccard:
+		rows = jaccard_dist(fp, &D);
+		break;
+	    case tanimoto:
+		rows = tanimoto_dist(fp, &D);
+		break;
+	    case dice:
+		rows = dice_dist(fp, &D);
+		break;
+	    case hamming:
+		rows = hamming_dist(fp, &D);
+		break;
+	    case evolution:
+		rows = evolution_dist(fp, &D);
+		break;
+	    case yule:
+		rows = yule_dist(fp, &D);
+		break;
+	    case russel:
+		rows = russel_dist(fp, &D);
+		break;
+	    case hamann:
+		rows = hamann_dist(fp, &D);
+		break;
+	    case antidice:
+		rows = antidice_dist(fp, &D);
+		break;
+	    case sneath:
+		rows = sneath_dist(fp, &D);
+		break;
+	    case ochiai:
+		rows = ochiai_dist(fp, &D);
+		break;
+	    case canberra:
+		rows = canberra_dist(fp, &D);
+		break;
+	    case anderberg:
+		rows = anderberg_dist(fp, &D);
+		break;
+	    case phi:
+		rows = phi_dist(fp, &D);
+		break;
+	    case gower:
+		rows = gower_dist(fp, &D);
+		break;
+	    case kulczynski:
+		rows = kulczynski_dist(fp, &D);
+		break;
+	    case matching:
+		rows = matching_dist(fp, &D);
+		break;
+	    case jensen_shannon:
+		if (iflag && rflag)
+		    rows = jsdcr(fp, &D);
+		else if (iflag)
+		    rows = jsdc(fp, &D);
+		else if (rflag)
+		    rows = jsdr(fp, &D);
+		else
+		    rows = jsd(fp, &D);
+		break;
+	    case several:
+		rows = metricMatrices(fp, &D);
+		break;
 	    }
-	}
 
-	if (rflag)
-	    printLine(D, rows);
-	else if (pflag)
-	    printInfile(D, rows);
-	else
-	    printMatrix(D, rows);
 
-	free(D);
+	    // with more than one set, each set has its own -X files
+	    if (format == PROFILE_BINARY) {
+		if ((c = getc(in)) != EOF)
+		    ungetc(c, in);
+		more = c != EOF;
+	    }
+	    printDistances(D, rows, pvalue, xflag,
+			   set > 1 || more ? set : 0);
+	    free(D);
+
+	    if (fp != in)
+		fclose(fp);
+	} while (format == PROFILE_BINARY || more);
+	fp = in;
 
 
 	if (fp != stdin)
@@ -432,6 +651,9 @@ int main(int argc, char **argv)
 
     } while (*argv);
 
+    if (db)
+	freeProfiles(db);
+
     return EXIT_SUCCESS;
 }
 
@@ -441,8 +663,10 @@ int main(int argc, char **argv)
  * using a single line.
  *
  * The FFP is read from fp, and the JSD calculation is
- * perfomed for all pairs of FFP.  The form of the FFP 
- * must be columnar row normalized data.
+ * perfomed for the row given with -r against all rows
+ * of the FFP.  The form of the FFP must be columnar row
+ * normalized data.  Rows are located by counting lines,
+ * so they need not be of equal length in the file.
  *
  * @param fp A file pointer to a row normalized columnar FFP
  * @param D Points to a dynamically allocated array of double precision floats.
@@ -454,96 +678,834 @@ int main(int argc, char **argv)
 
 int jsdr(FILE * fp, double **D)
 {
-    double *a;
-    double val;
-    double m;
-    char ch[2];
-    int tst = 0;
-    long pos;
-    int i;
-    double ha;
-    double hb;
-    unsigned cols = 0;
+    PROFILES *p;
     int row;
-    unsigned colsize = 10000;
-    int rowsize = 10;
 
-    a = (double *) malloc(sizeof(double) * colsize);
-    *D = (double *) malloc(sizeof(double) * rowsize);
+    p = readProfiles(fp, float32);
 
+    if (rflagN < 0 || rflagN >= p->rows)
+	fatal_msg("Row %d is outside of the %u row FFP.\n", rflagN + 1,
+		  p->rows);
 
+    *D = newD(p->rows);
+    for (row = 0; row < p->rows; row++)
+	putD(*D, row, jsdProfile(p, rflagN, p, row));
 
-    // Read length of first line
+    row = p->rows;
+    freeProfiles(p);
+    return (row);
+}
 
-    while (tst != 2) {
-	if (cols >= colsize)	// if vector is too large reallocate
-	{
-	    colsize += 10000;
-	    if ((a = (double *) realloc(a, sizeof(double) * colsize)) == NULL) {
-		fprintf(stderr, "Out of memory!\n");
-		exit(ENOMEM);
-	    }
-	}
-	tst = fscanf(fp, "%lf%[\n\r]", &a[cols++], ch);
+
+
+/**
+ * Work shared between the threads of a database scan
+ */
+
+typedef struct {
+    PROFILES *query;	/**< Query rows */
+    PROFILES *db;	/**< Database rows */
+    double *D;		/**< query->rows by db->rows result matrix */
+    uint32_t next;	/**< First database row of the next unscanned block */
+    pthread_mutex_t lock;	/**< Protects next */
+} SCAN;
+
+
+
+/**
+ * Scans blocks of database rows until none are left
+ *
+ * Each block of DB_BLOCK database rows is compared with
+ * every query row before moving on, so the block stays in
+ * cache while the queries are evaluated.
+ *
+ * @param arg A pointer to the shared SCAN
+ * @return NULL
+ */
+
+static void *scanBlocks(void *arg)
+{
+    SCAN *scan = (SCAN *) arg;
+    uint32_t start, end;
+    uint32_t i, j;
+
+    for (;;) {
+	pthread_mutex_lock(&scan->lock);
+	start = scan->next;
+	if (start < scan->db->rows)
+	    scan->next += DB_BLOCK;
+	pthread_mutex_unlock(&scan->lock);
+
+	if (start >= scan->db->rows)
+	    break;
+
+	end = start + DB_BLOCK;
+	if (end > scan->db->rows)
+	    end = scan->db->rows;
+
+	for (i = 0; i < scan->query->rows; i++)
+	    for (j = start; j < end; j++)
+		putD(scan->D, (size_t) i * scan->db->rows + j,
+		     jsdProfile(scan->query, i, scan->db, j));
     }
+    return NULL;
+}
+
+
+
+/**
+ * Calculates JSD rows of query FFPs against a profile database
+ *
+ * Every row of the FFP in fp is compared with every row of
+ * the database, which generalizes the -r option to many rows
+ * and to rows that are not part of the reference set.  The
+ * database is scanned by the number of threads given with -T.
+ *
+ * @param fp A file pointer to a row normalized columnar FFP
+ * @param db Database profiles, see mapProfiles
+ * @param D Set to a dynamically allocated array of query rows by database rows
+ * @return Returns the number of query rows read.
+ */
+
+int jsdQuery(FILE * fp, PROFILES * db, double **D)
+{
+    PROFILES *query;
+    SCAN scan;
+    pthread_t *tid;
+    int rows;
+    int t;
+
+    query = readProfiles(fp, float32);
+    if (query->rows && query->cols != db->cols)
+	fatal_msg("FFP has %u columns, the database has %u.\n",
+		  query->cols, db->cols);
+
+    *D = newD((size_t) query->rows * db->rows + 1);
+
+    scan.query = query;
+    scan.db = db;
+    scan.D = *D;
+    scan.next = 0;
+    pthread_mutex_init(&scan.lock, NULL);
+
+    tid = (pthread_t *) chkmalloc(sizeof(pthread_t), threads);
+    for (t = 1; t < threads; t++)
+	if (pthread_create(&tid[t], NULL, scanBlocks, &scan))
+	    fatal_msg("Error creating thread: %s\n", strerror(errno));
+    scanBlocks(&scan);
+    for (t = 1; t < threads; t++)
+	pthread_join(tid[t], NULL);
+
+    pthread_mutex_destroy(&scan.lock);
+    free(tid);
+
+    rows = query->rows;
+    freeProfiles(query);
+    return (rows);
+}
+
+
+
+/**
+ * Writes an FFP as a binary profile database
+ *
+ * The database can be given to -f to compare query
+ * FFPs against the rows in this FFP.
+ *
+ * @param fp A file pointer to a row normalized columnar FFP
+ * @param fname Name of the database file to create
+ * @return None
+ */
+
+void makeDatabase(FILE * fp, char *fname)
+{
+    PROFILES *p;
+    FILE *out;
+
+    p = readProfiles(fp, float32);
+
+    if ((out = fopen(fname, "w")) == NULL)
+	fatal_msg("%s: %s.\n", fname, strerror(errno));
+    writeProfiles(p, out);
+    if (fclose(out))
+	fatal_msg("%s: %s.\n", fname, strerror(errno));
+
+    freeProfiles(p);
+}
+
+
+
+
+
+/**
+ * Sums the rows of a raw count FFP
+ *
+ * Fills total with the row sums and lgtotal with their
+ * log2, and initializes log2Table on first use.  Every
+ * value of the FFP must be a non-negative integer.
+ *
+ * @param p Profiles of a raw count FFP
+ * @param total Set to a dynamically allocated array of row sums
+ * @param lgtotal Set to a dynamically allocated array of log2 row sums
+ * @return None
+ */
 
-    pos = ftell(fp);
+static void countTotals(PROFILES * p, double **total, double **lgtotal)
+{
+    uint32_t r;
+    uint64_t e;
+    double v;
+    int i;
 
-    // If line = 0 then good to go.  else jump forward to the right line and re-read
-    if (rflagN > 0) {
-	fseek(fp, pos * rflagN, SEEK_SET);
-	//Now read that line;
-	//check for EOF in case an invalid line was specified   
-	for (i = 0; i < cols; i++)
-	    tst = fscanf(fp, "%lf\n", &a[i]);
-	// Possibly check for fscanf errors.    
+    if (!log2Table[2])
+	for (i = 1; i < LOG2_TABLE_SIZE; i++)
+	    log2Table[i] = log2(i);
+
+    *total = (double *) chkcalloc(sizeof(double), p->rows + 1);
+    *lgtotal = (double *) chkcalloc(sizeof(double), p->rows + 1);
+    for (r = 0; r < p->rows; r++) {
+	for (e = p->index[r]; e < p->index[r + 1]; e++) {
+	    v = profileValue(p, e);
+	    if (v < 0 || v != floor(v))
+		fatal_msg("Row %u is not a raw count FFP, use -i only with"
+			  " ffpcol output.\n", r + 1);
+	    (*total)[r] += v;
+	}
+	(*lgtotal)[r] = log2((*total)[r]);
     }
+}
 
-    clearerr(fp);
-    fseek(fp, 0, SEEK_SET);
-    row = 0;
 
-    while (!feof(fp)) {
 
-/*
-	if (row == rflagN) {
-		// last line
-		(*D)[row++] = 0;
-		fseek(fp,pos,SEEK_CUR);
-		continue;
-	}*/
+/**
+ * Calculates the Jensen Shannon Divergence of two raw count rows
+ *
+ * The rows are normalized analytically rather than by ffprwn.
+ * With counts c and d and row totals N and M the log ratios
+ * of the divergence are
+ *
+ *   log2(m/p) = log2((1 + dN/cM) / 2)
+ *   log2(m/q) = log2(m/p) - (log2(d) - log2(c) + log2(N) - log2(M))
+ *
+ * so each shared column needs a single log2 call, the count
+ * logarithms come from log2Table and columns present in only
+ * one row need none.  The terms are accumulated as in jsd.
+ *
+ * @param p Profiles of a raw count FFP
+ * @param i First row
+ * @param j Second row
+ * @param total Row sums, see countTotals
+ * @param lgtotal log2 of the row sums
+ * @return The divergence of the normalized rows i and j
+ */
 
-	while (row + 1 > rowsize) {
-	    rowsize *= 2;
-	    if ((*D = (double *) realloc(*D, sizeof(double) * rowsize)) == NULL) {
-		fprintf(stderr, "Out of memory!\n");
-		exit(ENOMEM);
-	    }
+double jsdCounts(PROFILES * p, uint32_t i, uint32_t j, double *total,
+		 double *lgtotal)
+{
+    uint64_t a = p->index[i], ae = p->index[i + 1];
+    uint64_t b = p->index[j], be = p->index[j + 1];
+    double N = total[i], M = total[j];
+    double lgNM = lgtotal[i] - lgtotal[j];
+    double ha = 0;
+    double hb = 0;
+    double c, d, t;
+
+    while (a < ae && b < be) {
+	if (p->col[a] < p->col[b])
+	    hb -= profileValue(p, a++) / N;
+	else if (p->col[b] < p->col[a])
+	    hb -= profileValue(p, b++) / M;
+	else {
+	    c = profileValue(p, a++);
+	    d = profileValue(p, b++);
+	    t = log2(0.5 * (1 + (d * N) / (c * M)));
+	    ha += -(c / N) * t;
+	    hb += -(d / M) * (t - ((lg(d) - lg(c)) + lgNM));
 	}
+    }
+    while (a < ae)
+	hb -= profileValue(p, a++) / N;
+    while (b < be)
+	hb -= profileValue(p, b++) / M;
+
+    return fabs(0.5 * ha + 0.5 * hb);
+}
 
 
-	ha = hb = 0;
-	for (i = 0; i < cols; i++) {
-	    if (!fscanf(fp, "%lf\n", &val))
-		fatal_msg("Read zero items.");
-	    m = (val + a[i]) / 2.0;
-	    if (!a[i] && !val) {
+
+/**
+ * Calculates a Jensen Shannon Divergence matrix of a raw count FFP
+ *
+ * Equivalent to jsd on the output of ffprwn, without
+ * the loss of precision of the normalized text.
+ *
+ * @param fp A file pointer to a columnar FFP of raw counts
+ * @param D Points to a dynamically allocated array of double precision floats.
+ * @return Returns the number of rows read.
+ */
+
+int jsdc(FILE * fp, double **D)
+{
+    PROFILES *p;
+    double *total, *lgtotal;
+    uint32_t i, j;
+    size_t k = 0;
+    int rows;
+
+    p = readProfiles(fp, float32);
+    countTotals(p, &total, &lgtotal);
+
+    *D = newD((size_t) p->rows * (p->rows + 1) / 2 + 1);
+    for (i = 0; i < p->rows; i++) {
+	putD(*D, k++, 0);
+	for (j = i + 1; j < p->rows; j++)
+	    putD(*D, k++, jsdCounts(p, i, j, total, lgtotal));
+    }
+
+    rows = p->rows;
+    free(total);
+    free(lgtotal);
+    freeProfiles(p);
+    return (rows);
+}
+
+
+
+/**
+ * Calculates a single row of the JSD matrix of a raw count FFP
+ *
+ * The counts equivalent of jsdr, the row is given with -r.
+ *
+ * @param fp A file pointer to a columnar FFP of raw counts
+ * @param D Points to a dynamically allocated array of double precision floats.
+ * @return Returns the number of rows read.
+ */
+
+int jsdcr(FILE * fp, double **D)
+{
+    PROFILES *p;
+    double *total, *lgtotal;
+    int row;
+
+    p = readProfiles(fp, float32);
+
+    if (rflagN < 0 || rflagN >= p->rows)
+	fatal_msg("Row %d is outside of the %u row FFP.\n", rflagN + 1,
+		  p->rows);
+
+    countTotals(p, &total, &lgtotal);
+
+    *D = newD(p->rows);
+    for (row = 0; row < p->rows; row++)
+	putD(*D, row, jsdCounts(p, rflagN, row, total, lgtotal));
+
+    row = p->rows;
+    free(total);
+    free(lgtotal);
+    freeProfiles(p);
+    return (row);
+}
+
+
+
+
+
+/**
+ * Adds the metrics in a comma separated list to those for -X
+ *
+ * @param list Comma separated metric names, see metricNames
+ * @return None
+ */
+
+void parseMetrics(char *list)
+{
+    char *name;
+    int i, j;
+
+    for (name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+	for (i = 0; i < NUM_METRICS; i++)
+	    if (!strcmp(name, metricNames[i].name))
+		break;
+	if (i == NUM_METRICS)
+	    fatal_msg("Unknown metric: %s\n", name);
+	for (j = 0; j < numMetrics; j++)
+	    if (metrics[j] == i)
+		break;
+	if (j == numMetrics)
+	    metrics[numMetrics++] = i;
+    }
+}
+
+
+
+/**
+ * Quantities of a pair of FFP rows shared by the metrics
+ *
+ * a is the earlier row of the pair and b the later one.
+ * The sums are accumulated in column order, as in the
+ * functions made by DISTANCE_TEMPLATE.
+ */
+
+typedef struct {
+    double ha, hb;	/**< Jensen Shannon partial sums */
+    double both;	/**< Features present in a and b */
+    double aonly;	/**< Features present in a, absent in b */
+    double bonly;	/**< Features absent in a, present in b */
+    double none;	/**< Features absent in both */
+    double cols;	/**< Number of features */
+    double asq, bsq;	/**< Sums of squares of a and b */
+    double dot;		/**< Sum of a*b */
+    double manhattan;	/**< Sum of |b-a| */
+    double chebyshev;	/**< Maximum of |b-a| */
+    double euclid;	/**< Sum of (b-a)^norm */
+    double euclid2;	/**< Sum of (b-a)^2 */
+    double differ;	/**< Features where a and b differ */
+    double r;		/**< Pearson correlation coefficient */
+} PAIR;
+
+
+
+/**
+ * Accumulates the quantities of a pair of sparse FFP rows
+ *
+ * With -W the rows are those of a bootstrap replicate.
+ * Each column counts as often as it was drawn, and the
+ * values are normalized by the weighted row sums, so the
+ * quantities equal those of the resampled FFP after ffprwn.
+ *
+ * @param p Profiles holding both rows
+ * @param i First row
+ * @param j Second row
+ * @param s Pair quantities to fill
+ * @param needJsd Accumulate the Jensen Shannon sums
+ * @param needEuclid Accumulate the norm sums of -e
+ * @return None
+ */
+
+static void pairSums(PROFILES * p, uint32_t i, uint32_t j, PAIR * s,
+		     char needJsd, char needEuclid)
+{
+    uint64_t a = p->index[i], ae = p->index[i + 1];
+    uint64_t b = p->index[j], be = p->index[j + 1];
+    double x, y, m;
+    double w = 1, na = 1, nb = 1;
+
+    memset(s, 0, sizeof(PAIR));
+    s->cols = p->cols;
+
+    if (weight) {
+	if (rowSum[i])
+	    na = rowSum[i];
+	if (rowSum[j])
+	    nb = rowSum[j];
+    }
+
+    while (a < ae || b < be) {
+	if (b >= be || (a < ae && p->col[a] < p->col[b])) {
+	    if (weight && !(w = weight[p->col[a]])) {
+		a++;
 		continue;
-	    } else if (!a[i]) {
-		hb -= val;
+	    }
+	    x = profileValue(p, a++) / na;
+	    y = 0;
+	    s->aonly += w;
+	    if (needJsd)
+		s->hb -= w * x;
+	} else if (a >= ae || p->col[b] < p->col[a]) {
+	    if (weight && !(w = weight[p->col[b]])) {
+		b++;
 		continue;
-	    } else if (!val) {
-		hb -= a[i];
+	    }
+	    x = 0;
+	    y = profileValue(p, b++) / nb;
+	    s->bonly += w;
+	    if (needJsd)
+		s->hb -= w * y;
+	} else {
+	    if (weight && !(w = weight[p->col[a]])) {
+		a++, b++;
 		continue;
-	    } else {
-		ha += -a[i] * log2(m / a[i]);
-		hb += -val * log2(m / val);
 	    }
+	    x = profileValue(p, a++) / na;
+	    y = profileValue(p, b++) / nb;
+	    s->both += w;
+	    s->dot += w * y * x;
+	    if (needJsd) {
+		m = (y + x) / 2.0;
+		s->ha += -w * x * log2(m / x);
+		s->hb += -w * y * log2(m / y);
+	    }
+	}
+	s->asq += w * x * x;
+	s->bsq += w * y * y;
+	s->manhattan += w * fabs(y - x);
+	if (fabs(y - x) > s->chebyshev)
+	    s->chebyshev = fabs(y - x);
+	if (needEuclid)
+	    s->euclid += w * pow((y - x), euclidean_norm);
+	s->euclid2 += w * (y - x) * (y - x);
+	s->differ += w * !(y == x);
+    }
+    s->none = s->cols - s->both - s->aonly - s->bonly;
+}
+
+
+
+/**
+ * Calculates one metric from the quantities of a pair of rows
+ *
+ * The expressions are those of the corresponding functions
+ * made by DISTANCE_TEMPLATE, so the values are identical.
+ *
+ * @param mode A dist_modes value
+ * @param s Quantities of the pair, see pairSums
+ * @return The distance, or similarity with -s
+ */
+
+static double metricValue(char mode, PAIR * s)
+{
+    char sim = (matrix_mode == similarity);
+    double A = s->both, x;
+
+    switch (mode) {
+    case jensen_shannon:
+	return fabs(0.5 * s->ha + 0.5 * s->hb);
+    case euclidean:
+	return pow(s->euclid, 1 / euclidean_norm);
+    case euclidean2:
+	return s->euclid2;
+    case canberra:
+	return s->manhattan / sqrt(s->bsq) / sqrt(s->asq);
+    case cosine:
+	x = s->dot / sqrt(s->bsq) / sqrt(s->asq);
+	return sim ? x : 1 - x;
+    case manhattan:
+	return s->manhattan;
+    case pearson_r:
+	return sim ? s->r : 1 - pow(s->r, 2);
+    case chebyshev:
+	return s->chebyshev;
+    case jaccard:
+	return sim ? A / s->cols : 1 - A / s->cols;
+    case tanimoto:
+	x = (A + s->bonly) + (A + s->aonly) - A;
+	return sim ? A / x : 1 - A / x;
+    case dice:
+	x = (A + s->bonly) + (A + s->aonly);
+	return sim ? 2 * A / x : 1 - 2 * A / x;
+    case hamming:
+	return s->cols - A;
+    case evolution:
+	return s->differ;
+    case yule:
+	x = (A * s->none - s->aonly * s->bonly) /
+	    (A * s->none + s->aonly * s->bonly);
+	return sim ? x : 1 - pow(x, 2);
+    case russel:
+	return sim ? A / (s->cols) : 1 - A / (s->cols);
+    case matching:
+	return sim ? (A + s->none) / s->cols :
+	    1 - pow((A + s->none) / s->cols, 2);
+    case hamann:
+	x = ((A + s->none) - (s->aonly + s->bonly)) /
+	    (A + s->none + s->aonly + s->bonly);
+	return sim ? x : 1 - pow(x, 2);
+    case antidice:
+	x = A / (A + 2 * (s->aonly + s->bonly));
+	return sim ? x : 1 - x;
+    case sneath:
+	return sim ?
+	    2 * (A + s->none) / (2 * (A + s->none) + (s->aonly + s->bonly)) :
+	    1 - 2 * (A + s->none) / (2 * (A + s->none) + (s->aonly + s->bonly));
+    case ochiai:
+	x = A / sqrt((A + s->aonly) * (A + s->bonly));
+	return sim ? x : 1 - x;
+    case anderberg:
+	x = (A / (A + s->aonly) + A / (A + s->bonly) +
+	     s->none / (s->bonly + s->none) + s->none / (s->aonly + s->none)) / 4;
+	return sim ? x : 1 - x;
+    case phi:
+	x = (A * s->none - s->aonly * s->bonly) /
+	    sqrt((A + s->aonly) * (A + s->bonly) * (s->none + s->aonly) *
+		 (s->none + s->bonly));
+	return sim ? x : 1 - pow(x, 2);
+    case gower:
+	x = A * s->none / sqrt((A + s->aonly) * (A + s->bonly) *
+			       (s->none + s->aonly) * (s->none + s->bonly));
+	return sim ? x : 1 - x;
+    case kulczynski:
+	x = (A / (A + s->aonly) + A / (A + s->bonly)) / 2;
+	return sim ? x : 1 - x;
+    }
+    return 0;
+}
+
+
+
+/**
+ * Calculates the matrices of all -X metrics in one pass
+ *
+ * Each pair of rows is visited once.  The quantities needed
+ * by the metrics, such as norms, sums and contingency counts,
+ * are accumulated once per pair and shared by all metrics.
+ * The matrices are stored one after the other in D, each in
+ * the layout used by printMatrix.
+ *
+ * @param fp A file pointer to a columnar FFP
+ * @param D Points to a dynamically allocated array of double precision floats.
+ * @return Returns the number of rows read.
+ */
+
+int metricMatrices(FILE * fp, double **D)
+{
+    PROFILES *p;
+    int rows;
+
+    p = readProfiles(fp, float32);
+    rows = pairMatrices(p, D);
+    freeProfiles(p);
+    return (rows);
+}
+
+
+
+/**
+ * Calculates the matrices of all -X metrics of profiles in memory
+ *
+ * See metricMatrices.  With -W the rows are weighted by
+ * the current bootstrap replicate, see pairSums.
+ *
+ * @param p Profiles of a columnar FFP
+ * @param D Points to a dynamically allocated array of double precision floats.
+ * @return Returns the number of rows.
+ */
+
+int pairMatrices(PROFILES * p, double **D)
+{
+    PAIR s;
+    double *a = NULL, *b = NULL;
+    char needJsd = 0, needEuclid = 0, needDense = 0;
+    uint32_t i, j;
+    uint64_t e;
+    size_t k = 0, size;
+    int m;
+
+    for (m = 0; m < numMetrics; m++) {
+	needJsd |= metricNames[metrics[m]].mode == jensen_shannon;
+	needEuclid |= metricNames[metrics[m]].mode == euclidean;
+	needDense |= metricNames[metrics[m]].mode == pearson_r;
+    }
+
+    if (needDense) {
+	a = (double *) chkcalloc(sizeof(double), p->cols + 1);
+	b = (double *) chkcalloc(sizeof(double), p->cols + 1);
+    }
+
+    size = (size_t) p->rows * (p->rows + 1) / 2;
+    *D = newD(size * numMetrics + 1);
+
+    for (i = 0; i < p->rows; i++) {
+	for (m = 0; m < numMetrics; m++)
+	    putD(*D, m * size + k, metricNames[metrics[m]].similar ?
+		 (matrix_mode == similarity) : 0);
+	k++;
+
+	if (needDense)
+	    for (e = p->index[i]; e < p->index[i + 1]; e++)
+		a[p->col[e]] = profileValue(p, e);
+
+	for (j = i + 1; j < p->rows; j++, k++) {
+	    pairSums(p, i, j, &s, needJsd, needEuclid);
+	    if (needDense) {
+		for (e = p->index[j]; e < p->index[j + 1]; e++)
+		    b[p->col[e]] = profileValue(p, e);
+		s.r = pearsons(a, b, p->cols);
+		for (e = p->index[j]; e < p->index[j + 1]; e++)
+		    b[p->col[e]] = 0;
+	    }
+	    for (m = 0; m < numMetrics; m++)
+		putD(*D, m * size + k,
+		     metricValue(metricNames[metrics[m]].mode, &s));
 	}
-	(*D)[row++] = fabs(0.5 * ha + 0.5 * hb);
+
+	if (needDense)
+	    for (e = p->index[i]; e < p->index[i + 1]; e++)
+		a[p->col[e]] = 0;
     }
+
     free(a);
-    return (row);
+    free(b);
+    return (p->rows);
+}
+
+
+
+/**
+ * Calculates and prints the matrices of bootstrap replicates
+ *
+ * A bootstrap replicate draws cols columns of the FFP with
+ * replacement, so it is given by how often each column was
+ * drawn.  The FFP is read once and every matrix is calculated
+ * from it with these column weights, without writing and
+ * reading the resampled FFPs.  Replicate k, counted from 0
+ * over all inputs, draws the same columns as ffpboot with
+ * seed + k, and its rows are normalized as by ffprwn.
+ *
+ * @param fp A file pointer to a columnar FFP
+ * @param n Number of replicates
+ * @param seed Random seed of the first replicate
+ * @param pvalue Taxa name file of -p, or NULL
+ * @return None
+ */
+
+void bootstrapMatrices(FILE * fp, int n, unsigned seed, char *pvalue)
+{
+    static unsigned long replicate = 0;
+    RNG rng;
+    PROFILES *p;
+    double *D;
+    uint32_t i;
+    uint64_t e;
+    int k, rows;
+
+    p = readProfiles(fp, float32);
+
+    weight = (unsigned *) chkmalloc(sizeof(unsigned), p->cols + 1);
+    rowSum = (double *) chkmalloc(sizeof(double), p->rows + 1);
+
+    for (k = 0; k < n; k++, replicate++) {
+	memset(weight, 0, sizeof(unsigned) * (p->cols + 1));
+	rngInit(&rng, seed + replicate);
+	for (i = 0; i < p->cols; i++)
+	    weight[rngBelow(&rng, p->cols)]++;
+
+	for (i = 0; i < p->rows; i++) {
+	    rowSum[i] = 0;
+	    for (e = p->index[i]; e < p->index[i + 1]; e++)
+		rowSum[i] += weight[p->col[e]] * profileValue(p, e);
+	}
+
+	rows = pairMatrices(p, &D);
+	printDistances(D, rows, pvalue, 0, 0);
+	free(D);
+    }
+
+    free(weight);
+    free(rowSum);
+    weight = NULL;
+    rowSum = NULL;
+    freeProfiles(p);
+}
+
+
+
+/**
+ * Prints the matrices of the -X metrics to their own files
+ *
+ * The matrix of each metric is written to PREFIX.NAME, where
+ * PREFIX is given by -O and NAME is the metric name, or to
+ * PREFIX.NAME.SET when the input holds several sets of rows.
+ * With -x the files hold binary matrices.
+ *
+ * @param D Matrices calculated by metricMatrices
+ * @param n Dimensions of each distance matrix
+ * @param pflag Print phylip format infiles
+ * @param set Number of the set from 1, or 0 for a single set
+ * @return None
+ */
+
+void printMetrics(double *D, int n, char pflag, int set)
+{
+    char fname[FILENAME_MAX];
+    size_t size = (size_t) n * (n + 1) / 2;
+    FILE *out;
+    int m;
+
+    for (m = 0; m < numMetrics; m++) {
+	if (set)
+	    snprintf(fname, sizeof(fname), "%s.%s.%d", metricPrefix,
+		     metricNames[metrics[m]].name, set);
+	else
+	    snprintf(fname, sizeof(fname), "%s.%s", metricPrefix,
+		     metricNames[metrics[m]].name);
+	if ((out = fopen(fname, "w")) == NULL)
+	    fatal_msg("%s: %s.\n", fname, strerror(errno));
+	if (binary)
+	    writeBinary(out, D, m * size, n);
+	else if (pflag)
+	    printInfile(out, D, m * size, n);
+	else
+	    printMatrix(out, D, m * size, n);
+	if (fclose(out))
+	    fatal_msg("%s: %s.\n", fname, strerror(errno));
+    }
+}
+
+
+
+/**
+ * Prints the matrix or matrices of an input set
+ *
+ * The output format is chosen by the options, and taxa
+ * names are read for each set when -p is given and freed
+ * once the set is printed.
+ *
+ * @param D Matrices calculated for the set
+ * @param rows Dimensions of each distance matrix
+ * @param pvalue Taxa name file of -p, or NULL
+ * @param xflag Print the -X matrices to their own files
+ * @param set Number of the set from 1, or 0 for a single set
+ * @return None
+ */
+
+void printDistances(double *D, int rows, char *pvalue, char xflag, int set)
+{
+    FILE *pp;
+    char buffer[STR_BUFF];
+    int i;
+
+    if (pvalue)		// if phylip format requested
+    {
+	if ((pp = fopen(pvalue, "r")) == NULL) {
+	    fprintf(stderr, "Error opening file %s", pvalue);
+	    exit(1);
+	}
+
+	taxaNames = (char **) malloc(sizeof(char *) * rows);
+	for (i = 0; i < rows; i++) {
+	    taxaNames[i] =
+		(char *) malloc(sizeof(char) * (TAXANAMELEN + 1));
+	    if (fscanf(pp, "%s", buffer) != 1)
+		fatal_msg("%s: Fewer taxa names than the %d rows.\n",
+			  pvalue, rows);
+	    if (strlen(buffer) > TAXANAMELEN) {
+		if (!qFlag) 	
+		warn_msg("Taxaname: %s greater than %d. Truncating.\n",
+			buffer, TAXANAMELEN);
+		buffer[10] = '\0';
+	    }
+	    strcpy(taxaNames[i], buffer);
+	}
+	fclose(pp);
+    }
+
+    if (rflag)
+	printLine(D, 0, rows);
+    else if (xflag)
+	printMetrics(D, rows, pvalue != NULL, set);
+    else if (binary)
+	writeBinary(stdout, D, 0, rows);
+    else if (pvalue)
+	printInfile(stdout, D, 0, rows);
+    else
+	printMatrix(stdout, D, 0, rows);
+
+    if (pvalue) {
+	for (i = 0; i < rows; i++)
+	    free(taxaNames[i]);
+	free(taxaNames);
+	taxaNames = NULL;
+    }
 }
 
 
@@ -556,25 +1518,31 @@ int jsdr(FILE * fp, double **D)
  * Prints out the distance matrix
  * stored in D with the precision specified
  *
- * @param n Dimensions of the distance matrix
+ * @param out Stream the matrix is printed to
  * @param D Points to a dynamically allocated array of double precision floats.
+ * @param first Index of the first matrix entry in D
+ * @param n Dimensions of the distance matrix
  * @return None
  * @see precision
  */
 
 
-void printMatrix(double *D, int n)
+void printMatrix(FILE * out, double *D, size_t first, int n)
 {
+    WRITER *w = writerOpen(out);
     int i, j, k = 0, l = 0;
 
     for (i = 0; i < n; i++) {
 	k += i;
-	for (j = 0, l = 0; j < n; j++, l += j)
-	    printf("%.*e ", precision,
-		   (i > j ? D[j * n + i - l] : D[i * n + j - k]));
-	printf("\n");
+	for (j = 0, l = 0; j < n; j++, l += j) {
+	    writeExp(w, (i > j ? getD(D, first + j * n + i - l) :
+			 getD(D, first + i * n + j - k)), precision);
+	    writeChar(w, ' ');
+	}
+	writeChar(w, '\n');
 
     }
+    writerClose(w);
 }
 
 
@@ -585,20 +1553,58 @@ void printMatrix(double *D, int n)
  * Prints out the distance matrix
  * stored in D with the precision specified
  *
- * @param n Dimensions of the distance matrix
  * @param D Points to a dynamically allocated array of double precision floats.
+ * @param first Index of the first entry of the line in D
+ * @param n Dimensions of the distance matrix
  * @return None
  * @see precision
  */
 
 
-void printLine(double *D, int n)
+void printLine(double *D, size_t first, int n)
+{
+    WRITER *w = writerOpen(stdout);
+    int i;
+    for (i = 0; i < n; i++) {
+	writeExp(w, getD(D, first + i), precision);
+	writeChar(w, ' ');
+    }
+    writeChar(w, '\n');
+    writerClose(w);
+}
+
+
+
+/**
+ * Write a binary distance matrix
+ *
+ * Writes the entries above the diagonal of the distance
+ * matrix stored in D in the format read by ffptree, see
+ * dmatrix.h.  The taxa names are those given with -p, or
+ * the row numbers.  Entries are written at full precision,
+ * in single precision with -z.
+ *
+ * @param out Stream the matrix is written to
+ * @param D Points to a dynamically allocated array of double precision floats.
+ * @param first Index of the first matrix entry in D
+ * @param n Dimensions of the distance matrix
+ * @return None
+ * @see taxaNames
+ */
+
+void writeBinary(FILE * out, double *D, size_t first, int n)
 {
+    uint32_t valsize = float32 ? sizeof(float) : sizeof(double);
+    size_t k = first;
     int i;
-    for (i = 0; i < n; i++)
-	printf("%.*e ", precision, D[i]);
-    printf("\n");
 
+    writeMatrixHeader(out, n, valsize, taxaNames);
+    for (i = 0; i < n; k += n - i, i++)
+	if (float32)
+	    fwrite((float *) D + k + 1, sizeof(float), n - i - 1, out);
+	else
+	    fwrite(D + k + 1, sizeof(double), n - i - 1, out);
+    writeMatrixEnd(out, n, valsize);
 }
 
 
@@ -612,8 +1618,10 @@ void printLine(double *D, int n)
  * taxaNames.  The precision used will
  * be as specified in the precision variable.
  *
- * @param n Dimensions of the distance matrix
+ * @param out Stream the matrix is printed to
  * @param D Points to a dynamically allocated array of double precision floats.
+ * @param first Index of the first matrix entry in D
+ * @param n Dimensions of the distance matrix
  * @return None
  * @see taxaNames
  * @see precision
@@ -622,22 +1630,28 @@ void printLine(double *D, int n)
 
 
 
-void printInfile(double *D, int n)
+void printInfile(FILE * out, double *D, size_t first, int n)
 {
+    WRITER *w = writerOpen(out);
     int i, j, k, l;
-    printf("%d\n", n);
+    size_t len;
+
+    writeUlong(w, n);
+    writeChar(w, '\n');
 
     for (i = 0, k = 0; i < n; i++, k += i) {
-	printf("%-*s", TAXANAMELEN, taxaNames[i]);
-	for (j = 0, l = 0; j < n; j++, l += j)
-	    printf("%.*e ", precision,
-		   (i > j ? D[j * n + i - l] : D[i * n + j - k]));
-	printf("\n");
+	writeString(w, taxaNames[i]);
+	for (len = strlen(taxaNames[i]); len < TAXANAMELEN; len++)
+	    writeChar(w, ' ');
+	for (j = 0, l = 0; j < n; j++, l += j) {
+	    writeExp(w, (i > j ? getD(D, first + j * n + i - l) :
+			 getD(D, first + i * n + j - k)), precision);
+	    writeChar(w, ' ');
+	}
+	writeChar(w, '\n');
 
     }
-
-
-
+    writerClose(w);
 }
 
 
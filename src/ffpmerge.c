@@ -32,7 +32,7 @@ char PROG_NAME[FILENAME_MAX];
 #define MAX_WORD_LENGTH 40 /**< Maximum feature length */
 
 unsigned merge(FILE * fp, unsigned **vals, unsigned size);
-void mergeHash(FILE * fp);
+void mergeHash(HASHTABLE * h, FILE * fp);
 int isKeyBased(FILE * fp);
 int getKeyLength(FILE * fp);
 
@@ -52,7 +52,6 @@ Copyright (c) %s\n\
 Contact %s\n";
 
 
-char *weightVector;
 int Length = MAX_WORD_LENGTH;
 			    /**< Feature Length */
 
@@ -64,6 +63,8 @@ int main(int argc, char **argv)
     unsigned i;
     unsigned *vals;
     char **keys;
+    HASHTABLE *h;
+    WRITER *out;
     bool isKey = false;
     bool dflag = false;
     bool aflag = false;
@@ -119,11 +120,11 @@ int main(int argc, char **argv)
 
 
     if (aflag)
-	initHash(0, amino, !dflag);
+	h = hashCreate(amino, !dflag, NULL);
     else if (tflag)
-	initHash(0, text, !dflag);
+	h = hashCreate(text, !dflag, NULL);
     else
-	initHash(0, nucleotide, !dflag);
+	h = hashCreate(nucleotide, !dflag, NULL);
 
 // init to zero
     vals = (unsigned *) calloc(sizeof(unsigned), COL_SIZE);
@@ -154,13 +155,16 @@ int main(int argc, char **argv)
 	} else if (isatty(STDIN_FILENO))
 	    printErrorUsageStr();
 
+	if (!isRegularFile(fp))	// getKeyLength rewinds the input
+	    fp = rewindablePipe(fp);
+
 	isKey = isKeyBased(fp);
 
 	if (!isKey)
 	    cols = merge(fp, &vals, cols);
 	else {
 	    Length = getKeyLength(fp);
-	    mergeHash(fp);
+	    mergeHash(h, fp);
 	}
 
 	if (fp != stdin)
@@ -168,25 +172,30 @@ int main(int argc, char **argv)
 
     } while (*argv);
 
+    out = writerOpen(stdout);
     if (!isKey) {
-	for (i = 0; i < cols-1; i++)
-	    printf("%u\t", vals[i]);
-	printf("%u\n", vals[i]);
+	for (i = 0; i < cols; i++) {
+	    writeUlong(out, vals[i]);
+	    writeChar(out, i + 1 < cols ? '\t' : '\n');
+	}
     } else {
-	hashKeys(&keys);
-	if (kflag) {
-	    for (i = 0; i < numKeys()-1; i++)
-		printf("%s %u\t", keys[i], hashval(keys[i]));
-	    printf("%s %u\n", keys[i], hashval(keys[i]));
-	} else {
-	    for (i = 0; i < numKeys()-1; i++)
-		printf("%u\t", hashval(keys[i]));
-	    printf("%u\n", hashval(keys[i]));
+	hashKeys(h, &keys);
+	for (i = 0; i < numKeys(h); i++) {
+	    if (kflag) {
+		writeString(out, keys[i]);
+		writeChar(out, ' ');
+	    }
+	    writeUlong(out, hashval(h, keys[i]));
+	    writeChar(out, i + 1 < numKeys(h) ? '\t' : '\n');
 	}
-	printf("\n");
-	freeHash();
-	//@todo Free keys?
+	writeChar(out, '\n');
+	for (i = 0; i < numKeys(h); i++)
+	    free(keys[i]);
+	free(keys);
     }
+    writerClose(out);
+
+    hashDestroy(h);
 
     free(vals);
     return EXIT_SUCCESS;
@@ -210,30 +219,30 @@ int main(int argc, char **argv)
 
 unsigned merge(FILE * fp, unsigned **vals, unsigned size)
 {
-    long unsigned i;
-    int rows;
-    unsigned val;
+    READER *r = readerOpen(fp);
+    SPAN line;
+    const char *s, *next, *end;
+    long unsigned i, v;
     unsigned cols = 0;
-    char ch[2];
-    int d;
-
-
-    i = 0;
-    rows = 0;
-    while (!feof(fp)) {
-	if (i < size) {
-	    d = fscanf(fp, "%u%[\n\r]", &val, ch);
-	    (*vals)[i++] += val;
-	    if (d == 2) {
-		cols = i;
-		rows++;
-		i = 0;
+
+
+    while (readLine(r, &line)) {
+	end = line.s + line.len;
+	for (s = line.s, i = 0; (next = parseUlong(s, end, &v)) != s;
+	     s = next) {
+	    if (i == size) {
+		size += COL_SIZE;
+		if ((*vals = (unsigned *) realloc(*vals,
+				sizeof(unsigned) * size)) == NULL)
+		    fatal_msg("%s\n", strerror(ENOMEM));
+		memset(*vals + i, 0, sizeof(unsigned) * COL_SIZE);
 	    }
-	} else {
-	    size += COL_SIZE;
-	    *vals = (unsigned *) realloc(*vals, sizeof(unsigned) * size);
+	    (*vals)[i++] += v;
 	}
+	if (i > cols)
+	    cols = i;
     }
+    readerClose(r);
     return cols;
 
 }
@@ -246,21 +255,22 @@ unsigned merge(FILE * fp, unsigned **vals, unsigned size)
  * in a new hash.  The FFP in the file fp
  * must be a (Key,value) FFP.
  *
+ * @param h The hash of the merged row
  * @param fp A file pointer to an FFP
  * @return None
  */
 
 
-void mergeHash(FILE * fp)
+void mergeHash(HASHTABLE * h, FILE * fp)
 {
-    unsigned val;
-    char ch[2];
-    char s[Length];
+    READER *r = readerOpen(fp);
+    SPAN line, key;
+    unsigned long val;
+    char s[Length + 1];
 
 
-    while (!feof(fp)) {
-	fscanf(fp, "%s%[\t]%u%[\n\r]", s, ch, &val, ch);
-	s[Length] = '\0';	/**<This line may be unnecessary**/
-	hashAdd(s, val);	// increments hash by value;
-    }
+    while (readLine(r, &line))
+	while (nextPair(&line, &key, &val))	// increments hash by value
+	    hashAdd(h, spanToString(&key, s, sizeof(s)), val);
+    readerClose(r);
 }
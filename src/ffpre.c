@@ -62,7 +62,6 @@ Copyright (c) %s\n\
 Contact %s\n";
 
 
-char *weightVector;
 int Length = DEFAULT_WORD_LENGTH;
 int maxWordSize = MAX_WORD_SIZE;
 int Buffsize = CHAR_BUFFER_SIZE;
@@ -74,8 +73,6 @@ char aflag = 0;
 char dflag = 0;
 char tflag = 0;
 char rflag = 1;
-char fflag = 0;			// not used but needed to link with hashroll.c fix
-char mflag = 0;			// not used currently, same as fflag
 
 int main(int argc, char **argv)
 {
@@ -157,9 +154,9 @@ int main(int argc, char **argv)
     if (Length < 3)
 	fatal_msg("Feature Length must be 3 or greater\n");
 
-    init(&h, 0, mode, !dflag, rflag, Length);
-    init(&h1, 0, mode, !dflag, rflag, Length - 1);
-    init(&h2, 0, mode, !dflag, rflag, Length - 2);
+    init(&h, NULL, mode, !dflag, rflag, Length);
+    init(&h1, NULL, mode, !dflag, rflag, Length - 1);
+    init(&h2, NULL, mode, !dflag, rflag, Length - 2);
 // Must now process file arguments
 
     argv += optind;
@@ -193,7 +190,7 @@ int main(int argc, char **argv)
     l1count = sumValues(&h1);
     l2count = sumValues(&h2);
 
-    hashKeys(&h, &keys);
+    hashKeyList(&h, &keys);
 
     N = (double) l2count / l1count / l1count;
 
@@ -0,0 +1,500 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "hashroll.h"
+#include "utils.h"
+#include "vstring.h"
+#include "sighandle.h"
+#include "tree.h"
+#include "ffp.h"
+#include "../config.h"
+
+
+#define DEFAULT_WORD_LENGTH 10  /**< Feature length of ffpry without -l */
+#define DEFAULT_PRECISION 2 /**< Decimals of ffprwn and ffpjsd without -d */
+#define TAXANAMELEN 50 /**< Maximum length of a phylip taxa name, as in ffpjsd */
+#define STR_BUFF 255 /**< Longest taxa name read from the -p file */
+
+
+/* Function prototypes */
+
+static void ryOptions(char *opts);
+static void colOptions(char *opts);
+static void rwnOptions(char *opts);
+static void jsdOptions(char *opts);
+static void countFile(FFP_COUNTER * c, FILE * fp);
+static char **taxaNames(char **files, uint32_t rows);
+
+
+/* Global variables */
+
+char PROG_NAME[FILENAME_MAX];
+bool mflag = false;	/**< ffpry -m, multiple sequences in one file */
+
+int Length = DEFAULT_WORD_LENGTH;	/**< ffpry -l, feature length */
+bool ryDisable = false;	/**< ffpry -d, disable RY coding */
+bool ryReverse = true;	/**< ffpry -r toggles, count reverse complements */
+bool colDisable = false;	/**< ffpcol -d, disable classing of keys */
+bool rwnLargest = false;	/**< ffprwn -n, normalize by the largest row sum */
+int rwnPrecision = DEFAULT_PRECISION;	/**< ffprwn -d, decimals of the normalized rows */
+int jsdPrecision = DEFAULT_PRECISION;	/**< ffpjsd -d, decimals of the distances */
+char *jsdNames = NULL;	/**< ffpjsd -p, file of taxa names */
+bool jsdQuiet = false;	/**< ffpjsd -q, no warnings */
+
+
+char usage_str[] = "Usage: %s [OPTIONS]... [FILE]...\n\
+This program builds a tree of FASTA files in one process, with\n\
+the same result as the pipeline\n\
+ffpry FILE... | ffpcol | ffprwn | ffpjsd -p NAMES | ffptree\n\n\
+The options of each stage are passed as one quoted argument.\n\
+\t--ry=OPTS\tffpry options, -l LEN -d -r -m\n\
+\t--col=OPTS\tffpcol options, -d\n\
+\t--rwn=OPTS\tffprwn options, -n -d INT\n\
+\t--jsd=OPTS\tffpjsd options, -p FILE -d INT -q\n\
+\t--tree=OPTS\tffptree options, all of them\n\
+Without -p in --jsd, the taxa are named after the files.\n\
+\t-h, --help\tThis message\n\
+\t-v, --version\tPrint version\n\n\
+Copyright (c) %s\n\
+%s\n\
+Contact %s\n";
+
+
+
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    FFP_COUNTER *c;
+    FFP_SET *set;
+    char **files = NULL;
+    char *name;
+    char **keys;
+    unsigned *vals;
+    unsigned n;
+    uint32_t rows = 0, rsize = 0, r;
+    bool features = false;
+    char *stage[5] = { NULL, NULL, NULL, NULL, NULL };
+    char **targv, **names;
+    char *topts = NULL;
+    double *D;
+    int targc;
+    int opt;
+    int maxWordSize = MAX_WORD_SIZE;
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"ry", required_argument, 0, 'y'},
+	{"col", required_argument, 0, 'c'},
+	{"rwn", required_argument, 0, 'n'},
+	{"jsd", required_argument, 0, 'j'},
+	{"tree", required_argument, 0, 't'},
+	{"help", no_argument, 0, 'h'},
+	{"version", no_argument, 0, 'v'},
+	{0, 0, 0, 0}
+    };
+
+    initSignalHandlers();
+
+    strcpy(PROG_NAME, basename(argv[0]));
+
+    while ((opt = getopt_long(argc, argv, "hv",
+			      long_options, &option_index)) != -1)
+	switch (opt) {
+	case 'y':
+	    stage[0] = optarg;
+	    break;
+	case 'c':
+	    stage[1] = optarg;
+	    break;
+	case 'n':
+	    stage[2] = optarg;
+	    break;
+	case 'j':
+	    stage[3] = optarg;
+	    break;
+	case 't':
+	    stage[4] = optarg;
+	    break;
+	case 'v':
+	    printVersion();
+	    exit(EXIT_SUCCESS);
+	    break;
+	case 'h':
+	    printUsageStr();
+	    exit(EXIT_SUCCESS);
+	    break;
+	default:
+	    printErrorUsageStr();
+	    break;
+	}
+
+    argv += optind;
+
+    // each stage parses its own options from the start
+    ryOptions(stage[0]);
+    colOptions(stage[1]);
+    rwnOptions(stage[2]);
+    jsdOptions(stage[3]);
+
+    // the rows of one file would all be named after it
+    if (mflag && !jsdNames)
+	fatal_msg("Option -m of --ry needs taxa names, see -p of --jsd\n");
+
+    // ffpTree parses the tree options again, check them before counting
+    if (stage[4]) {
+	topts = (char *) chkmalloc(sizeof(char), strlen(stage[4]) + 1);
+	strcpy(topts, stage[4]);
+    }
+    targv = splitArgs("ffptree", topts, &targc);
+    optind = 0;
+    treeOptions(targc, targv);
+    if (optind < targc)
+	fatal_msg("%s: Not an option of --tree\n", targv[optind]);
+    treeClose();
+    free(targv);
+    free(topts);
+
+    if (getenv("MAX_WORD_SIZE"))
+	maxWordSize = atoi(getenv("MAX_WORD_SIZE"));
+
+    if (Length > maxWordSize)
+	fatal_msg("%d: Max Word size is: %d", Length, maxWordSize);
+
+    /* count, as ffpry does, keeping the profile of each file */
+    if ((c = ffpCounterNew(Length, !ryDisable, ryReverse, mflag)) == NULL ||
+	(set = ffpSetNew(!colDisable)) == NULL)
+	fatal_msg("%s\n", ffpError());
+
+    do {
+	fp = stdin;
+	name = "stdin";
+	if (*argv) {
+	    name = *argv;
+	    if (!strcmp(*argv, "-"))
+		fp = stdin;
+	    else if ((fp = fopen(*argv, "r")) == NULL)
+		fatal_msg("%s: %s\n", *argv, strerror(errno));
+
+	    if (isDirectory(*argv))
+		fatal_msg("%s: %s\n", *argv, strerror(EISDIR));
+
+	    argv++;
+	} else if (isatty(STDIN_FILENO))
+	    printErrorUsageStr();
+
+	countFile(c, fp);
+
+	// a file without features gives an empty row, as in the pipeline
+	while (ffpProfile(c, &keys, &vals, &n)) {
+	    if (rows == rsize) {
+		rsize = rsize ? 2 * rsize : 64;
+		if ((files = (char **) realloc(files,
+				sizeof(char *) * rsize)) == NULL)
+		    fatal_msg("%s\n", strerror(ENOMEM));
+	    }
+	    files[rows] = name;
+	    features = features || n > 0;
+	    if ((rows = ffpSetAdd(set, keys, vals, n)) == 0)
+		fatal_msg("%s\n", ffpError());
+	}
+
+	if (fp != stdin)
+	    fclose(fp);
+
+    } while (*argv);
+    ffpCounterFree(c);
+
+    if (!features)
+	fatal_msg("No features of length %d found in the input.\n", Length);
+
+    /* columnize as ffpcol, normalize as ffprwn, compare as ffpjsd */
+    if (ffpNormalize(set, rwnLargest, rwnPrecision) ||
+	(D = ffpDistances(set)) == NULL)
+	fatal_msg("%s\n", ffpError());
+    ffpSetFree(set);
+
+    names = taxaNames(files, rows);
+    if (ffpTree(D, names, rows, jsdPrecision, stage[4], stdout, stderr))
+	fatal_msg("%s\n", ffpError());
+    for (r = 0; r < rows; r++)
+	free(names[r]);
+    free(names);
+    free(files);
+    free(D);
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/**
+ * Parses the options of the counting stage, --ry
+ *
+ * @param opts The options
+ * @return None
+ */
+
+static void ryOptions(char *opts)
+{
+    int argc, opt;
+    char **argv = splitArgs("ffpry", opts, &argc);
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"length", required_argument, 0, 'l'},
+	{"disable", no_argument, 0, 'd'},
+	{"multiple", no_argument, 0, 'm'},
+	{"disable-rev", no_argument, 0, 'r'},
+	{0, 0, 0, 0}
+    };
+
+    optind = 0;
+    while ((opt = getopt_long(argc, argv, "l:dmr",
+			      long_options, &option_index)) != -1)
+	switch (opt) {
+	case 'l':
+	    Length = atoi(optarg);
+	    break;
+	case 'd':
+	    ryDisable = !ryDisable;
+	    break;
+	case 'm':
+	    mflag = !mflag;
+	    break;
+	case 'r':
+	    ryReverse = !ryReverse;
+	    break;
+	default:
+	    printErrorUsageStr();
+	    break;
+	}
+    if (optind < argc)
+	fatal_msg("%s: Not an option of --ry\n", argv[optind]);
+    free(argv);
+}
+
+
+
+/**
+ * Parses the options of the column stage, --col
+ *
+ * @param opts The options
+ * @return None
+ */
+
+static void colOptions(char *opts)
+{
+    int argc, opt;
+    char **argv = splitArgs("ffpcol", opts, &argc);
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"disable", no_argument, 0, 'd'},
+	{0, 0, 0, 0}
+    };
+
+    optind = 0;
+    while ((opt = getopt_long(argc, argv, "d",
+			      long_options, &option_index)) != -1)
+	switch (opt) {
+	case 'd':
+	    colDisable = !colDisable;
+	    break;
+	default:
+	    printErrorUsageStr();
+	    break;
+	}
+    if (optind < argc)
+	fatal_msg("%s: Not an option of --col\n", argv[optind]);
+    free(argv);
+}
+
+
+
+/**
+ * Parses the options of the normalization stage, --rwn
+ *
+ * @param opts The options
+ * @return None
+ */
+
+static void rwnOptions(char *opts)
+{
+    int argc, opt;
+    char **argv = splitArgs("ffprwn", opts, &argc);
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"largest-row", no_argument, 0, 'n'},
+	{"precision", required_argument, 0, 'd'},
+	{0, 0, 0, 0}
+    };
+
+    optind = 0;
+    while ((opt = getopt_long(argc, argv, "nd:",
+			      long_options, &option_index)) != -1)
+	switch (opt) {
+	case 'n':
+	    rwnLargest = true;
+	    break;
+	case 'd':
+	    rwnPrecision = atoi(optarg);
+	    break;
+	default:
+	    printErrorUsageStr();
+	    break;
+	}
+    if (optind < argc)
+	fatal_msg("%s: Not an option of --rwn\n", argv[optind]);
+    free(argv);
+}
+
+
+
+/**
+ * Parses the options of the distance stage, --jsd
+ *
+ * @param opts The options
+ * @return None
+ */
+
+static void jsdOptions(char *opts)
+{
+    int argc, opt;
+    char **argv = splitArgs("ffpjsd", opts, &argc);
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"phylip", required_argument, 0, 'p'},
+	{"precision", required_argument, 0, 'd'},
+	{"quiet", no_argument, 0, 'q'},
+	{0, 0, 0, 0}
+    };
+
+    optind = 0;
+    while ((opt = getopt_long(argc, argv, "p:d:q",
+			      long_options, &option_index)) != -1)
+	switch (opt) {
+	case 'p':
+	    jsdNames = optarg;
+	    break;
+	case 'd':
+	    jsdPrecision = atoi(optarg);
+	    break;
+	case 'q':
+	    jsdQuiet = true;
+	    break;
+	default:
+	    printErrorUsageStr();
+	    break;
+	}
+    if (optind < argc)
+	fatal_msg("%s: Not an option of --jsd\n", argv[optind]);
+    free(argv);
+}
+
+
+
+/**
+ * Counts the features of a nucleotide FASTA file
+ *
+ * The file is read in blocks as by ffpry, and its profiles
+ * are left in the counter.
+ *
+ * @param c The counter
+ * @param fp A file pointer to the FASTA file
+ * @return None
+ */
+
+static void countFile(FFP_COUNTER * c, FILE * fp)
+{
+    struct stat fattr;
+    size_t optimal_size;
+    ssize_t nr;
+    char *buf;
+
+    //Determine optimal buffer size for file
+    if (fstat(fileno(fp), &fattr))
+	fatal_msg("fd %d : File stat error.\n", fileno(fp));
+
+    //Find optimal size for Disk IO
+    optimal_size = (fattr.st_blksize >= BUFSIZ) ? fattr.st_blksize : BUFSIZ;
+
+    buf = (char *) chkmalloc(sizeof(char), optimal_size);
+
+    while ((nr = fread(buf, sizeof(char), optimal_size, fp)) != -1 && nr != 0)
+	if (ffpCount(c, buf, nr))
+	    fatal_msg("%s\n", ffpError());
+    if (ffpCountEnd(c))
+	fatal_msg("%s\n", ffpError());
+    free(buf);
+}
+
+
+
+/**
+ * Names the taxa
+ *
+ * Reads a name for each row from the ffpjsd -p file, or
+ * names the rows after their files.  Names longer than
+ * TAXANAMELEN are cut as by ffpjsd.
+ *
+ * @param files The file of each row
+ * @param rows Number of rows
+ * @return The names of the rows
+ */
+
+static char **taxaNames(char **files, uint32_t rows)
+{
+    FILE *pp = NULL;
+    char buffer[STR_BUFF + 1] = "";
+    char **names = (char **) chkmalloc(sizeof(char *), rows);
+    uint32_t i;
+
+    if (jsdNames && (pp = fopen(jsdNames, "r")) == NULL)
+	fatal_msg("%s: %s\n", jsdNames, strerror(errno));
+
+    for (i = 0; i < rows; i++) {
+	names[i] = (char *) chkmalloc(sizeof(char), TAXANAMELEN + 1);
+	if (pp) {
+	    if (fscanf(pp, "%255s", buffer) != 1)
+		fatal_msg("%s: Fewer taxa names than the %u rows.\n",
+			  jsdNames, rows);
+	} else {
+	    strncpy(buffer, basename(files[i]), STR_BUFF);
+	    buffer[STR_BUFF] = '\0';
+	}
+	if (strlen(buffer) > TAXANAMELEN) {
+	    if (!jsdQuiet)
+		warn_msg("Taxaname: %s greater than %d. Truncating.\n",
+			 buffer, TAXANAMELEN);
+	    buffer[10] = '\0';
+	}
+	strcpy(names[i], buffer);
+    }
+
+    if (pp)
+	fclose(pp);
+    return names;
+}
@@ -21,7 +21,9 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include "utils.h"
+#include "profile.h"
 #include "vstring.h"
 #include "sighandle.h"
 #include "../config.h"
@@ -30,9 +32,62 @@ char PROG_NAME[FILENAME_MAX];
 #define COL_SIZE 1000  /**< Initial guess for number of columns in FFP */
 #define ROW_SIZE 10    /**< Initial guess for number of rows in FFP */
 #define DEFAULT_PRECISION 2 /**< Default precision for formated printing of normalized FFP */
+#define isSpace(c) ((c) == '\t' || (c) == ' ' || (c) == '\r' || (c) == '\n') /**< Separates the values of a row */
 
-void rownorm(FILE * fp);
-void rownorml(FILE * fp);
+/**
+ * A row of the FFP, with buffers reused from row to row
+ */
+typedef struct {
+    char *line;		/**< Text of the row */
+    size_t size;	/**< Allocated size of line */
+    long unsigned *val;	/**< Values of the row */
+    long unsigned *col;	/**< Column numbers of the values of a sparse row */
+    size_t cols;	/**< Number of values */
+    size_t valsize;	/**< Allocated size of val */
+    long unsigned sum;	/**< Row sum */
+    char bad;		/**< The row holds something other than counts */
+    char sparse;	/**< The row is in sparse format, see profile_formats */
+    char *out;		/**< Normalized row as printed */
+    size_t outlen;	/**< Length of out */
+    size_t outsize;	/**< Allocated size of out */
+} ROW;
+
+/**
+ * Rows handled by one thread
+ */
+typedef struct {
+    ROW *row;		/**< First row of the batch */
+    int n;		/**< Rows in the batch */
+    int t;		/**< Thread number, the thread takes rows t, t + threads, ... */
+    char parse;		/**< Parse the rows */
+    char format;	/**< Format the rows */
+    long unsigned div;	/**< Divisor of every row, or 0 to use the row sums */
+} JOB;
+
+/**
+ * Threads kept for the whole run, see processRows
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t start;	/**< A batch is ready, or the pool stops */
+    pthread_cond_t done;	/**< The last thread finished its rows */
+    pthread_t *tid;		/**< Threads 1 to threads - 1 */
+    JOB *job;		/**< Job of each thread, job[0] is the caller's */
+    unsigned batch;	/**< Number of the current batch */
+    int busy;		/**< Threads still working on the batch */
+    char stop;		/**< The threads return */
+} POOL;
+
+void normalize(FILE * fp, char largest);
+void processRows(ROW * row, int n, char parse, char format,
+		 long unsigned div);
+void *workRows(void *arg);
+void startPool(void);
+void stopPool(void);
+void *poolWorker(void *arg);
+void parseRow(ROW * r);
+void formatRow(ROW * r, long unsigned div);
+void normalizeBinary(READER * r, char largest, long unsigned *rowNum);
 
 char usage_str[] = "usage: %s [OPTION] ... [FILE] ...\n\
 This program performs row normalization of an FFP vector file\n\n\
@@ -40,6 +95,7 @@ Given no options, the defeault behavior of the program is to\n\
 generate row normalized relative frequency vectors\n\
 \t-n, --largest-row\tNormalized by largest row sum\n\
 \t-d=INT, --precision=INT\tSpecify n digits of decimal precision\n\
+\t-T INT, --threads=INT\tNumber of threads parsing and formatting rows\n\
 \t-v, --version\n\
 \t-h, --help\n\n\
 Copyright (c) %s\n\
@@ -49,6 +105,8 @@ Contact %s\n";
 
 int precision = DEFAULT_PRECISION;
 				 /**< Precision in Decimal places for normalized FFP */
+int threads = 1; /**< -T Rows parsed and formatted at the same time */
+POOL pool;	 /**< The threads of -T */
 
 
 
@@ -65,6 +123,7 @@ int main(int argc, char **argv)
 	{"help", no_argument, 0, 'h'},
 	{"largest-row", no_argument, 0, 'n'},
 	{"precision", no_argument, 0, 'd'},
+	{"threads", required_argument, 0, 'T'},
 	{"version", no_argument, 0, 'v'},
 	{0, 0, 0, 0}
     };
@@ -73,7 +132,7 @@ int main(int argc, char **argv)
 
     strcpy(PROG_NAME,basename( argv[0] ));
 
-    while ((opt = getopt_long(argc, argv, "nd:hv",
+    while ((opt = getopt_long(argc, argv, "nd:T:hv",
 			      long_options, &option_index)) != -1)
 	switch (opt) {
 	case 'n':
@@ -83,6 +142,11 @@ int main(int argc, char **argv)
 	    dflag = 1;
 	    dvalue = atoi(optarg);
 	    break;
+	case 'T':
+	    threads = atoi(optarg);
+	    if (threads < 1)
+		fatal_msg("Number of threads must be at least 1\n");
+	    break;
 	case 'v':
 	    printVersion();
 	    exit(EXIT_SUCCESS);
@@ -102,6 +166,7 @@ int main(int argc, char **argv)
 
 
     argv += optind;
+    startPool();
 
     do {
 	fp = stdin;
@@ -118,24 +183,17 @@ int main(int argc, char **argv)
 	} else if (isatty(STDIN_FILENO))
 	    printErrorUsageStr();
 
-    // check if not a seekable pipe
-        if (!isRegularFile(fp)) 
-	   fp = convertPipeToFile(fp);
-
 	if (isKeyBased(fp))
 	   fatal_msg("%s: Not a columnar FFP - see ffpcol.\n", *argv);
 
-
-	if (nflag)
-	    rownorml(fp);
-	else
-	    rownorm(fp);
+	normalize(fp, nflag);
 
 	if (fp != stdin)
 	    fclose(fp);
 
     } while (*argv);
 
+    stopPool();
     return EXIT_SUCCESS;
 }
 
@@ -143,118 +201,482 @@ int main(int argc, char **argv)
 
 /**
  *
- * Performs standard row normalization
+ * Performs row normalization
  *
- * Each row is converted into a relative
- * frequency vector.
+ * Each row is converted into a relative frequency
+ * vector.  The input is read once with a READER, so
+ * pipes need not be copied to a file.  By default every row is
+ * printed as soon as it is read, divided by its own
+ * sum.  Up to threads rows are parsed and formatted
+ * at the same time and printed in input order.
+ *
+ * With largest, each set of rows separated by a blank
+ * line is held in memory until its largest row sum is
+ * known, then every row of the set is divided by it.
+ * A set takes about its text plus 16 bytes per value,
+ * as each row keeps its text and its values and columns.
+ * Only the batch being printed is formatted at a time.
+ *
+ * Blank lines separating the sets of
+ * ffpboot -n are kept.  Sparse and binary FFPs are
+ * normalized in their own format, see profile_formats.
  *
  * @param fp A file pointer 
+ * @param largest Normalize by the largest row sum of each set, -n
  * @return void
  *
  */
 
+void normalize(FILE * fp, char largest)
+{
+    READER *r = readerOpen(fp);
+    WRITER *out = writerOpen(stdout);
+    SPAN line;
+    ROW *row = NULL;
+    int size = 0;	/* rows allocated */
+    int n = 0;		/* rows held */
+    int first = 0;	/* first row not yet parsed */
+    long unsigned rowNum = 0;
+    long unsigned maxsum;
+    char data = 0;	/* a row was printed since the last blank line */
+    char blank, eof, header;
+    char sparse = 0;	/* the rows of this set are sparse */
+    ROW *h;
+    char *c;
+    int i, j, k;
 
+    do {
+	if (n == size) {
+	    if ((row = (ROW *) realloc(row, sizeof(ROW) *
+				       (size + ROW_SIZE))) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
+	    memset(row + size, 0, sizeof(ROW) * ROW_SIZE);
+	    size += ROW_SIZE;
+	}
 
-/* Reconsider the design of this function -- It may be faster to do a double scan
- * of the file as in rownorml */
+	eof = !readLine(r, &line);
+	blank = header = 0;
+	h = row + n;
+	if (!eof) {
+	    spanCopy(&line, &row[n].line, &row[n].size);
+	    for (c = row[n].line; isSpace(*c); c++);
+	    blank = (*c == '\0');
+	    header = (*c == '#');
+	    row[n].sparse = sparse;
+	    if (!blank && !header && ++n - first < threads)
+		continue;
+	}
 
-void rownorm(FILE * fp)
-{
-    long unsigned *sum;
-    long unsigned val;
-    int rowsize = ROW_SIZE;	/* initial guess */
-    char s[3];
-    int d=0;
-    int row=0;
-
-    sum = (long unsigned *) calloc(rowsize, sizeof(long unsigned));
- 
-    sum[row]=0;
-    while ( (d = fscanf(fp, "%lu%[\n\r]", &val, s)) != EOF  ) {
-	sum[row] += val;
-        if (d == 2) { 
-		row++;
-		if (row == rowsize) {
-		    rowsize += ROW_SIZE;
-		    sum = (long unsigned *) realloc(sum, 
-						  sizeof(long unsigned) *
-						  rowsize);
+	/* rows first to n are read, parse them and print them */
+	processRows(row + first, n - first, 1, !largest, 0);
+	for (i = first; i < n; i++)
+	    if (row[i].bad)
+		fatal_msg("Row %lu: Not a columnar FFP of counts.\n",
+			  rowNum + i + 1);
+
+	if (!largest) {
+	    for (i = 0; i < n; i++) {
+		if (row[i].sum == 0)
+		    warn_msg("Row %ld has row sum of 0.0\n", rowNum + 1);
+		writeBytes(out, row[i].out, row[i].outlen);
+		rowNum++;
+	    }
+	    data |= (n > 0);
+	    n = 0;
+	}
+	first = n;
+
+	/* a set ends, print the rows held for -n */
+	if ((blank || eof || header) && largest && n) {
+	    maxsum = 0;
+	    for (i = 0; i < n; i++)
+		if (row[i].sum > maxsum)
+		    maxsum = row[i].sum;
+	    for (i = 0; i < n; i = j) {
+		j = (n - i < threads) ? n : i + threads;
+		processRows(row + i, j - i, 0, 1, maxsum);
+		for (k = i; k < j; k++) {
+		    writeBytes(out, row[k].out, row[k].outlen);
+		    free(row[k].out);
+		    row[k].out = NULL;
+		    row[k].outsize = 0;
 		}
-		sum[row]=0;
+	    }
+	    rowNum += n;
+	    n = first = 0;
+	    data = 1;
 	}
+
+	if (blank && data) {
+	    writeChar(out, '\n');
+	    data = 0;
+	}
+	if (blank)
+	    sparse = 0;
+
+	if (header) {
+	    if (!strncmp(h->line, BINARY_HEADER, strlen(BINARY_HEADER))) {
+		writerFlush(out);
+		normalizeBinary(r, largest, &rowNum);
+		data = 0;
+	    } else if (!strncmp(h->line, SPARSE_HEADER,
+				strlen(SPARSE_HEADER))) {
+		writeString(out, h->line);
+		writeChar(out, '\n');
+		sparse = 1;
+	    } else
+		fatal_msg("Unknown FFP header: %s\n", h->line);
+	}
+    } while (!eof);
+
+    for (i = 0; i < size; i++) {
+	free(row[i].line);
+	free(row[i].val);
+	free(row[i].col);
+	free(row[i].out);
     }
+    free(row);
+    readerClose(r);
+    writerClose(out);
+}
 
 
-    row=0;
-    rewind(fp);
-    while ( (d = fscanf(fp, "%lu%[\n\r]", &val, s)) != EOF  ) {
-	if (sum[row] == 0) {
-		if (d==2) {
-			printf("%.*e\n", precision, 0.0);
-			warn_msg("Row %ld has row sum of 0.0\n", row + 1);
-			row++;
-		} else {
-			printf("%.*e\t", precision, 0.0);
-		}
-	} else {
-        	if (d == 2) { 
-			printf("%.*e\n", precision, (float) val / sum[row]);
-			row++;
-		} else {
-			printf("%.*e\t", precision, (float) val / sum[row]);
-		}	
-	
-    	}
+
+/**
+ *
+ * Parses and formats a batch of rows
+ *
+ * Row i of the batch is handled by thread i % threads,
+ * the calling thread being thread 0.  The other threads
+ * of the pool are woken for the batch, and the call
+ * returns once all of them are done.
+ *
+ * @param row The first row of the batch
+ * @param n The number of rows in the batch
+ * @param parse Parse the text of the rows
+ * @param format Format the normalized rows
+ * @param div Divisor of every row, or 0 to divide by the row sums
+ * @return void
+ *
+ */
+
+void processRows(ROW * row, int n, char parse, char format,
+		 long unsigned div)
+{
+    int t;
+
+    if (n == 0)
+	return;
+
+    pthread_mutex_lock(&pool.lock);
+    for (t = 0; t < threads; t++) {
+	pool.job[t].row = row;
+	pool.job[t].n = n;
+	pool.job[t].parse = parse;
+	pool.job[t].format = format;
+	pool.job[t].div = div;
     }
+    pool.busy = threads - 1;
+    pool.batch++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
 
-    free(sum);
+    workRows(&pool.job[0]);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy)
+	pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+
+
+/**
+ *
+ * Starts the threads of -T, which wait for batches
+ * of rows until stopPool
+ *
+ * @return void
+ *
+ */
+
+void startPool(void)
+{
+    int t;
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.done, NULL);
+    pool.job = (JOB *) chkcalloc(sizeof(JOB), threads);
+    pool.tid = (pthread_t *) chkmalloc(sizeof(pthread_t), threads);
+    pool.batch = 0;
+    pool.busy = 0;
+    pool.stop = 0;
+
+    for (t = 0; t < threads; t++)
+	pool.job[t].t = t;
+    for (t = 1; t < threads; t++)
+	if (pthread_create(&pool.tid[t], NULL, poolWorker, &pool.job[t]))
+	    fatal_msg("Error creating thread: %s\n", strerror(errno));
+}
+
+
+
+/**
+ *
+ * Stops and joins the threads of -T
+ *
+ * @return void
+ *
+ */
+
+void stopPool(void)
+{
+    int t;
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    for (t = 1; t < threads; t++)
+	pthread_join(pool.tid[t], NULL);
+
+    pthread_cond_destroy(&pool.done);
+    pthread_cond_destroy(&pool.start);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.job);
+    free(pool.tid);
+}
+
+
+
+/**
+ *
+ * Runs the job of a pool thread for each batch
+ *
+ * @param arg A pointer to the JOB of the thread
+ * @return NULL
+ *
+ */
+
+void *poolWorker(void *arg)
+{
+    JOB *job = (JOB *) arg;
+    unsigned batch = 0;
+
+    for (;;) {
+	pthread_mutex_lock(&pool.lock);
+	while (pool.batch == batch && !pool.stop)
+	    pthread_cond_wait(&pool.start, &pool.lock);
+	if (pool.stop) {
+	    pthread_mutex_unlock(&pool.lock);
+	    return NULL;
+	}
+	batch = pool.batch;
+	pthread_mutex_unlock(&pool.lock);
+
+	workRows(job);
+
+	pthread_mutex_lock(&pool.lock);
+	if (--pool.busy == 0)
+	    pthread_cond_signal(&pool.done);
+	pthread_mutex_unlock(&pool.lock);
+    }
 }
 
 
 
+/**
+ *
+ * Parses and formats the rows of a job
+ *
+ * @param arg A pointer to a JOB
+ * @return NULL
+ *
+ */
+
+void *workRows(void *arg)
+{
+    JOB *job = (JOB *) arg;
+    int i;
+
+    for (i = job->t; i < job->n; i += threads) {
+	if (job->parse)
+	    parseRow(&job->row[i]);
+	if (job->format && !job->row[i].bad)
+	    formatRow(&job->row[i], job->div);
+    }
+    return NULL;
+}
+
+
 
 /**
  *
- * Performs row normalization by largest row
+ * Parses the counts of a row and sums them
  *
- * Each row is converted into a relative
- * frequency vector.
+ * Sets bad if the row holds anything but
+ * whitespace separated non-negative integers.
+ * A sparse row starts with the number of its
+ * values, each given as COL:VAL.
  *
- * @param fp A file pointer
+ * @param r A row holding the text of a line
  * @return void
  *
  */
 
+void parseRow(ROW * r)
+{
+    char *c = r->line;
+    long unsigned v, k = 0, nnz = 0;
+    char counted = 0;
+
+    r->cols = 0;
+    r->sum = 0;
+    r->bad = 0;
+    for (;;) {
+	while (isSpace(*c))
+	    c++;
+	if (*c == '\0')
+	    break;
+	if (*c < '0' || *c > '9') {
+	    r->bad = 1;
+	    return;
+	}
+	for (v = 0; *c >= '0' && *c <= '9'; c++)
+	    v = v * 10 + (*c - '0');
+
+	if (r->sparse) {
+	    if (!counted) {	// number of values
+		nnz = v;
+		counted = 1;
+		continue;
+	    }
+	    if (*c++ != ':' || *c < '0' || *c > '9') {
+		r->bad = 1;
+		return;
+	    }
+	    k = v;
+	    for (v = 0; *c >= '0' && *c <= '9'; c++)
+		v = v * 10 + (*c - '0');
+	}
 
+	if (r->cols == r->valsize) {
+	    r->valsize = r->valsize ? 2 * r->valsize : COL_SIZE;
+	    if ((r->val = (long unsigned *) realloc(r->val,
+			    sizeof(long unsigned) * r->valsize)) == NULL ||
+		(r->col = (long unsigned *) realloc(r->col,
+			    sizeof(long unsigned) * r->valsize)) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
+	}
+	if (r->sparse)
+	    r->col[r->cols] = k;
+	r->val[r->cols++] = v;
+	r->sum += v;
+    }
+    if (r->sparse && (!counted || r->cols != nnz))
+	r->bad = 1;
+}
 
-void rownorml(FILE * fp)
+
+
+/**
+ *
+ * Formats a normalized row
+ *
+ * The values are printed as the earlier two pass
+ * version did, in single precision with the
+ * requested number of decimals, separated by tabs.
+ * formatExp gives the same text as printf's %.*e.
+ * A row with a zero sum is printed as zeros.
+ * A sparse row is printed as it was read, with
+ * its values normalized.
+ *
+ * @param r A parsed row
+ * @param div Divisor of every value, or 0 to divide by the row sum
+ * @return void
+ *
+ */
+
+void formatRow(ROW * r, long unsigned div)
 {
-    long unsigned sum;
-    long unsigned val;
-    char s[3];
-    int d;
-    long unsigned maxsum = 0;
-
-   sum = 0;
-   while ( (d=fscanf(fp, "%lu%[\r\n]", &val,s)) != EOF ) {
-	    sum += val;
-	if ( d == 2 ) {
-		if (sum > maxsum) {
-		    maxsum = sum;
-		}
-		sum=0;
+    size_t need = r->cols * (precision + 54) + 32;
+    size_t i;
+
+    if (need > r->outsize) {
+	r->outsize = need;
+	if ((r->out = (char *) realloc(r->out, r->outsize)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+
+    r->outlen = 0;
+    if (r->sparse) {
+	r->outlen = formatUlong(r->out, r->cols);
+	for (i = 0; i < r->cols; i++) {
+	    r->out[r->outlen++] = '\t';
+	    r->outlen += formatUlong(r->out + r->outlen, r->col[i]);
+	    r->out[r->outlen++] = ':';
+	    r->outlen += formatExp(r->out + r->outlen,
+				   (float) r->val[i] / (div ? div : r->sum),
+				   precision);
 	}
+	r->out[r->outlen++] = '\n';
+	return;
+    }
+    for (i = 0; i < r->cols; i++) {
+	if (div)
+	    r->outlen += formatExp(r->out + r->outlen,
+				   (float) r->val[i] / div, precision);
+	else if (r->sum == 0)
+	    r->outlen += formatExp(r->out + r->outlen, 0.0, precision);
+	else
+	    r->outlen += formatExp(r->out + r->outlen,
+				   (float) r->val[i] / r->sum, precision);
+	r->out[r->outlen++] = (i + 1 < r->cols) ? '\t' : '\n';
     }
+}
+
 
-    rewind(fp);
 
-   while ( (d=fscanf(fp, "%lu%[\r\n]", &val,s)) != EOF ) {
-	    sum += val;
-	    if ( d == 1) 
-	    	printf("%.*e\t", precision, (float) val / maxsum);
-	    else 
-	    	printf("%.*e\n", precision, (float) val / maxsum);
-	
-	    
+/**
+ *
+ * Normalizes a binary FFP
+ *
+ * Reads the profile database after a BINARY_HEADER
+ * line and prints it normalized as a binary FFP, with
+ * the values kept in double precision.
+ *
+ * @param r A reader after a BINARY_HEADER line
+ * @param largest Normalize by the largest row sum, -n
+ * @param rowNum Rows read so far, updated
+ * @return void
+ *
+ */
+
+void normalizeBinary(READER * r, char largest, long unsigned *rowNum)
+{
+    PROFILES *p = readBinaryProfiles(r, false);
+    double *sum, maxsum = 0;
+    uint64_t e;
+    uint32_t i;
+
+    sum = (double *) chkcalloc(sizeof(double), p->rows + 1);
+    for (i = 0; i < p->rows; i++) {
+	for (e = p->index[i]; e < p->index[i + 1]; e++)
+	    sum[i] += p->val[e];
+	if (sum[i] > maxsum)
+	    maxsum = sum[i];
     }
+
+    for (i = 0; i < p->rows; i++) {
+	if (sum[i] == 0)
+	    warn_msg("Row %ld has row sum of 0.0\n", *rowNum + i + 1);
+	for (e = p->index[i]; e < p->index[i + 1]; e++)
+	    p->val[e] /= largest ? maxsum : sum[i];
+    }
+    *rowNum += p->rows;
+
+    printProfiles(p, stdout, PROFILE_BINARY);
+    free(sum);
+    freeProfiles(p);
 }
@@ -47,6 +47,7 @@
 
 /* Function prototypes */
 
+static void initHash(HASH *);
 static void parseFile(HASH *, FILE *);
 static void loopFeatureList(HASH * h, FILE * fp);
 static void loopRaw(HASH * h, FILE * fp);
@@ -59,6 +60,7 @@ char *weightVector;               /**< A mask to allow mismatches in features */
 int Length = DEFAULT_WORD_LENGTH; /**< Feature length to use if not specified by opt -l */
 int maxWordSize = MAX_WORD_SIZE;  /**< Maximum allowed length for opt -l */
 long Buffsize = CHAR_BUFFER_SIZE; /**< File input buffer, increase value for larger genomes. opt -b can be used to change this value */
+int threads = 1;                  /**< -T Files counted at the same time */
 
 
 /* Option flags and option arguments */
@@ -89,7 +91,8 @@ generate a Feature Frequency Profile (FFP) using features of length\n\
 \t-q, --quiet\n\
 \t-d, --disable\n\
 \t-r, --disable-rev\n\
-\t-m, --multiple\n\n\
+\t-m, --multiple\n\
+\t-T INT, --threads=INT\n\n\
 Copyright (c) %s\n\
 %s\n\
 Contact %s\n";
@@ -100,6 +103,7 @@ int main(int argc, char **argv)
 {
     int opt;
     FILE *fp;
+    RNG rng;
     HASH h;
     int option_index = 0;
 
@@ -114,6 +118,7 @@ int main(int argc, char **argv)
 	{"feature-list", required_argument, 0, 'f'},
 	{"multiple", no_argument, 0, 'm'},
 	{"disable-rev", no_argument, 0, 'r'},
+	{"threads", required_argument, 0, 'T'},
 	{"version", no_argument, 0, 'v'},
 	{0, 0, 0, 0}
     };
@@ -123,7 +128,7 @@ int main(int argc, char **argv)
 
   strcpy(PROG_NAME,basename( argv[0] ));
 
-    while ((opt = getopt_long(argc, argv, "l:dw:z:s:qf:hmvr",
+    while ((opt = getopt_long(argc, argv, "l:dw:z:s:qf:hmvrT:",
 			      long_options, &option_index)) != -1)
 	switch (opt) {
 	case 'l':
@@ -159,6 +164,11 @@ int main(int argc, char **argv)
 	case 'r':
 	    rflag = !rflag;
 	    break;
+	case 'T':
+	    threads = atoi(optarg);
+	    if (threads < 1)
+		fatal_msg("Number of threads must be at least 1\n");
+	    break;
 	case 'v':
 	    printVersion();
 	    exit(EXIT_SUCCESS);
@@ -180,9 +190,9 @@ int main(int argc, char **argv)
 	    fatal_msg("%d: Max Word size is: %d",Length,maxWordSize);
 
     if (sflag)
-	srand((unsigned) sflagN);
+	rngInit(&rng, (unsigned) sflagN);
     else
-	srand((unsigned) time(NULL) * getpid());
+	rngInit(&rng, (unsigned) time(NULL) * getpid());
 
 
     if (wflag) {
@@ -199,18 +209,13 @@ int main(int argc, char **argv)
 	    zflagN--;
 	if ((weightVector = (char *) malloc(sizeof(char) * (Length + 1))) == NULL) 
 		fatal_at_line("%s\n",strerror(errno));
-	randweight(weightVector, Length, zflagN);
+	randweight(weightVector, Length, zflagN, &rng);
 	if (!qflag)
 	    warn_msg("Using feature mask: %s\n", weightVector);
 
     }
 
-    //Initialize a hash
-    init(&h, (zflag || wflag), nucleotide, !dflag, rflag, Length);
-
-    //Fill with keys if restricting to a feature list
-    if (fflag)
-        parseFeatureList(&h,fvalue,Length,nucleotide);
+    initHash(&h);
 
     // Must now process file arguments
 
@@ -218,6 +223,11 @@ int main(int argc, char **argv)
 
     argv += optind;
 
+    if (threads > 1 && argc - optind > 1) {
+	countFiles(&h, argv, argc - optind, threads, initHash, parseFile);
+	return EXIT_SUCCESS;
+    }
+
     do {
 	fp = stdin;
 	if (*argv) {
@@ -247,6 +257,29 @@ int main(int argc, char **argv)
 }
 
 
+/**
+ *
+ *  Initializes a hash with the options
+ *
+ *  The hash is filled with the keys of the feature list of -f.
+ *
+ *  @param h The hash table to initialize.
+ *  @return none
+ *
+ */
+
+static void initHash(HASH * h)
+{
+    init(h, weightVector, nucleotide, !dflag, rflag, Length);
+    h->multiple = mflag;
+    h->list = fflag;
+
+    //Fill with keys if restricting to a feature list
+    if (fflag)
+        parseFeatureList(h,fvalue,Length,nucleotide);
+}
+
+
 /**
  *
  *  Parses FASTA format FNA file
@@ -319,7 +352,6 @@ static void loopFeatureList(HASH * h, FILE * fp)
     }
     printFeatures(h);
     free(buf);
-    freeHash(h);
 }
 
 
@@ -374,5 +406,3 @@ static void loopRaw(HASH * h, FILE * fp)
     free(buf);
     freeHash(h);
 }
-
-
@@ -59,13 +59,11 @@ Contact %s\n";
 int Length = DEFAULT_WORD_LENGTH;
 				/**< Feature length to use if not specified by opt -l */
 int maxWordSize = MAX_WORD_SIZE;
-char *weightVector;
 
 
 
 char *fvalue = NULL;  /**< -f File name to load features from */
 char fflag = 0;	      /**< -f Option to only count features listed in a file */
-char mflag = 0;       /**< unused but needed to link with hashroll.c */
 bool zflag = false;
 bool wflag = false;
 
@@ -120,7 +118,8 @@ int main(int argc, char **argv)
 	    fatal_msg("%d: Max Word size is : %d",Length,maxWordSize);
 
 
-    init(&h, 0, text, 0, 0, Length);
+    init(&h, NULL, text, 0, 0, Length);
+    h.list = fflag;
 
 
     // If provided a feature list read it and store in hash
@@ -112,10 +112,6 @@ int main(int argc, char **argv)
 	} else if (isatty(STDIN_FILENO))
 	    printErrorUsageStr();
     
-	// check if not a seekable pipe
-        if (!isRegularFile(fp)) 
-	   fp = convertPipeToFile(fp);
-
 	if (!isKeyBased(fp))
 	   fatal_msg("%s: Not a key valued FFP.\n", *argv);
 
@@ -148,42 +144,22 @@ int main(int argc, char **argv)
 
 float vocab(FILE * fp, int threshold)
 {
+    READER *r = readerOpen(fp);
+    SPAN line, key;
     int rows = 0;
-    rows = 0;
-    char ch[2];
     unsigned numFeature = 0;
-    unsigned val;
-    unsigned lineno=0;
-    unsigned line_offset=0;
-    int items;
-
-    errno=0;
-    while ( (items=fscanf(fp, "%*s %u%[\r\n]", &val,ch)) != EOF ) { 
-	//fprintf(stderr,"%s %d\n",strerror(errno),items);
-	if (errno) 
-		fatal_msg("Parse error at line %u char %ld: %s.\n",
-			lineno,ftell(fp)-line_offset, strerror(errno) );
-
-	if (val >= threshold)
+    unsigned long val;
+
+    while (readLine(r, &line)) {
+	if (!nextPair(&line, &key, &val))
+	    continue;
+	do
+	    if (val >= (unsigned long) threshold)
 		numFeature++;
-	
-	switch (items) {
-	        case 2:
-			line_offset=ftell(fp);
-			lineno++;
-	      		rows++;		
-		case 1:
-		break;	
-		default:
-			fatal_msg("Parse error at line %u char %ld.\n",
-			lineno,ftell(fp)-line_offset);
-		break;
-	}
+	while (nextPair(&line, &key, &val));
+	rows++;
     }
-
-
-    if (ferror(fp)) 
-    	fatal_msg("Read Error: %s",strerror(errno));
+    readerClose(r);
 
     return ((float) numFeature / rows);
 }
@@ -17,197 +17,135 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <math.h>
+#include <errno.h>
 #include "hash.h"
+#include "utils.h"
 #include "../config.h"
 
 
 
-extern char *weightVector;
-extern int Length;
-
-
-/** @todo Mysteries to solve, why is abs() necessary in the hash functions? 
- *  Using unsigned int types should remove the need for this.
-*/
-
-/* Functions private to this file and therefore not part of hash.h */
-/* This prevents anyone from accessing the hash improperly */
-
-
-static int hashrywi(register const char *s);
-static int hashryi(register const char *s);
-static int hashatgcwi(register const char *s);
-static int hashatgci(register const char *s);
-static int new_strcmp(register const char *s, register const char *t);
-static int new_strcmpw(register const char *s, register const char *t);
-static int hashaawi(register const char *s);
-static int hashaai(register const char *s);
-static int hashaacwi(register const char *s);
-static int hashaaci(register const char *s);
-static int hashtxti(register const char *s);
-
-
-/**
- *
- * Initializing feature that creates an empty hash table.
- *
- * This function initializes the hash table array by setting all
- * pointers in the the table array to NULL, setting the number of keys
- * keyN to zero and setting up the function pointer to the 
- * appropriate hash and string comparison functions.  The
- * function pointer is necessary to provide polymorphic
- * behavior depending on whether we are using a feature mask, RY
- * coded, ATGC coded or amino acid sequence
- *
- * Note however it does not free any memory, so freeHash should
- * be called before reinitializing the hash.
- *
- *
- * @param isMasked true if a mask is used
- * @param isNt true if using nucleic acid features
- * @param isClass true if using amino acid classes
- * @return None
- * @todo Since, everytime as hash is used it is first intialized, there may not be a need for a BUCKET variable instead the size of the hash can be dynamically allocated.
- */
-
-
-
-
-void initHash(int isMasked, int mode, int isClass)
-{
-
-    // assign function pointers depending
-    // on whether we are using feature
-    // character masks or not
-    if (mode == nucleotide) {
-	if (isMasked)		// is a NA hash
-	{
-	    if (isClass)
-		hashf = &hashrywi;
-	    else
-		hashf = &hashatgcwi;
-	    strcmpf = &new_strcmpw;
-
-	} else {
-	    if (isClass)
-		hashf = &hashryi;
-	    else
-		hashf = &hashatgci;
-	    strcmpf = &new_strcmp;
-
-	}
-    }
-
-    else if (mode == amino) {
-	if (isMasked) {
-	    if (isClass)
-		hashf = &hashaacwi;
-	    else
-		hashf = &hashaawi;
-	    strcmpf = &new_strcmpw;
-	} else {
-	    if (isClass)
-		hashf = &hashaaci;
-	    else
-		hashf = &hashaai;
-
-	    strcmpf = &new_strcmp;
-	}
-    } else			// is for text
-    {
-	hashf = &hashtxti;
-	strcmpf = &new_strcmp;
-    }
-
-    int i;
-    for (i = 0; i < BUCKETS; i++)
-	table[i] = NULL;
-    keyN = 0;
-}
-
-
-
-
-
-
-
-/**
- *
- * Returns an unmasked hash value for an RY coded feature
- * 
- * This is the hashing function used to store
- * features in the hash table.  The hashing function
- * has a direct affect on the collision rate of
- * hash stores.  The more hash collisions the less
- * effective the hash lookups are. 
- *
- *
- * @param s An RY-coded character string.
- * @retval >= 0 A valid hash index
- * @retval -1 s contains an invalid character
- */
+/* Character values of the hash functions, private to this file */
 
+static const int base_ry_hash_values[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 1, 0, 0, 0, 0, 0,
+    0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0
+}; /**< Character values for the RY hash function */
 
 
-inline static int hashryi(register const char *s)
-{
-    long unsigned hash = 0;
-    register int index;
 
-    while ( *s != '\0') {
-	hash *= 3;
-	index = base_ry_hash_values[(unsigned char) (*s)];
-	s++;
-	if (!index)
-	    return -1;
-	hash += index;
-	hash %= BUCKETS;
-    }
-    return (int) hash;
-}
+static const int aac_values[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 1, 0, 2, 3, 3,
+    4, 5, 6, 7, 0, 8, 7, 7, 9, 0,
+    10, 8, 8, 11, 11, 0, 7, 4, 0, 4,
+    0, 0, 0, 0, 0, 0, 0, 1, 0, 2,
+    3, 3, 4, 5, 6, 7, 0, 8, 7, 7,
+    9, 0, 10, 8, 8, 11, 11, 0, 7, 4,
+    0, 4, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0
+}; /**< Character values for classed amino acids */
 
 
 
-/**
- *
- * Returns a masked hash value for an RY coded feature
- * 
- * This is the hashing function used to store
- * features in the hash table.  The hashing function
- * has a direct affect on the collision rate of
- * hash stores.  The more hash collisions the less
- * effective the hash lookups are. Uses a feature
- * mask, ignoring masked out features
- *
- *
- * @param s An RY-coded character string
- * @retval >= 0 A valid hash index
- * @retval -1 s contains an invalid character
- */
-
+static const int aa_hash_values[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 1, 0, 2, 3, 4,
+    5, 6, 7, 8, 0, 9, 10, 11, 12, 0,
+    13, 14, 15, 16, 17, 0, 18, 19, 0, 20,
+    0, 0, 0, 0, 0, 0, 0, 1, 0, 2,
+    3, 4, 5, 6, 7, 8, 0, 9, 10, 11,
+    12, 0, 13, 14, 15, 16, 17, 0, 18, 19,
+    0, 20, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0
+}; /**< Character values for amino acids */
 
 
-static int hashrywi(register const char *s)
-{
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
-
-    while (s[i] != '\0') {
-	if (weightVector[i] == '1') {
-	    hash *= 3;
-	    index = base_ry_hash_values[(unsigned char) s[i]];
-	    if (!index)
-		return -1;
-	    hash += index;
-	    hash %= BUCKETS;
-	}
-	i++;
-    }
-    return (int) hash;
-}
+static const int txt_hash_values[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 1, 2, 3, 4, 5,
+    6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25,
+    26, 0, 0, 0, 0, 0, 0, 1, 2, 3,
+    4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+    14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+    24, 25, 26, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0
+};
 
 
 static const int base_hash_values[] = {
@@ -239,672 +177,498 @@ static const int base_hash_values[] = {
     0, 0, 0, 0, 0, 0
 };
 
-static int hashatgci(register const char *s)
-{
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
 
-    while (s[i] != '\0') {
-	hash *= 5;
-	index = base_hash_values[(unsigned char) s[i]];
-	if (!index)
-	    return -1;
-	hash += index;
-	hash %= BUCKETS;
-	i++;
-    }
-    return (int) hash;
-}
 
 
-static int hashatgcwi(register const char *s)
+/**
+ *
+ * Creates an empty hash table
+ *
+ * The hash function depends on whether the keys are RY
+ * coded or ATGC coded nucleotides, classed or unclassed
+ * amino acids, or text, and on the feature mask.  The
+ * bucket of a key is the same as in the earlier single
+ * table version while the table has its initial size.
+ *
+ * @param mode A hash_modes value
+ * @param isClass true if nucleotides are RY coded or
+ * amino acids are classed
+ * @param mask A feature mask, or NULL.  It is not copied.
+ * @return A newly allocated hash table
+ *
+ */
+
+HASHTABLE *hashCreate(int mode, bool isClass, const char *mask)
 {
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
-
-    while (s[i] != '\0') {
-	if (weightVector[i] == '1') {
-	    hash *= 5;
-	    index = base_hash_values[(unsigned char) s[i]];
-	    if (!index)
-		return -1;
-	    hash += index;
-	    hash %= BUCKETS;
-	}
-	i++;
+    HASHTABLE *h = (HASHTABLE *) chkcalloc(sizeof(HASHTABLE), 1);
+
+    h->buckets = BUCKETS;
+    h->table = (NODE **) chkcalloc(sizeof(NODE *), h->buckets);
+    h->mask = mask;
+
+    if (mode == nucleotide) {
+	h->values = isClass ? base_ry_hash_values : base_hash_values;
+	h->radix = isClass ? 3 : 5;
+	h->stepwise = true;
+    } else if (mode == amino) {
+	h->values = isClass ? aac_values : aa_hash_values;
+	h->radix = isClass ? 12 : 21;
+    } else {
+	h->values = txt_hash_values;
+	h->radix = 27;
     }
-    return (int) hash;
+    return h;
 }
 
 
+
 /**
  *
- * Masked String comparison method used internally by the hash table functions.
- *
- * This function differs slightly from the library version of strcmp
- * It short circuits when it finds the first difference in strings
- * It is also declared inline so that the compiler has the option of
- * substituting this code in directly.  It is declared static so that
- * it can only be used by the hash functions.
- * Uses a feature mask, ignoring masked out features
+ * Frees a hash table and all its keys
  *
- * @param s a null terminated string
- * @param t a null terminated string
- * @retval 1 if s and t are equal
- * @retval 0 if s and t are different
+ * @param h A hash table
+ * @return None
  *
  */
 
-
-static int new_strcmpw(register const char *s, register const char *t)
+void hashDestroy(HASHTABLE * h)
 {
-    int i = 0;
-    while (s[i] != '\0') {
-	if (weightVector[i] == '1')
-	    if (s[i] != t[i])
-		return 1;
-	i++;
-    }
-    return 0;
+    hashClear(h);
+    free(h->table);
+    free(h);
 }
 
 
+
 /**
  *
- * String comparison method used internally by the hash table functions.
+ * Removes all keys from a hash table
  *
- * This function differs slightly from the library version of strcmp
- * It short circuits when it finds the first difference in strings
- * It is also declared inline so that the compiler has the option of
- * substituting this code in directly.  It is declared static so that
- * it can only be used by the hash functions.
+ * The buckets are kept, so the table can be reused.
  *
- * @param s a null terminated string
- * @param t a null terminated string
- * @retval 1 if s and t are equal 
- * @ret val 0 if s and t are different
+ * @param h A hash table
+ * @return None
  *
  */
 
-
-
-inline static int new_strcmp(const char *s, const char *t)
+void hashClear(HASHTABLE * h)
 {
-    while (*s != '\0') {
-	if (*(s++) != *(t++))
-	    return 1;
+    NODE *ptr, *last;
+    unsigned i;
+
+    for (i = 0; i < h->buckets; i++) {
+	ptr = h->table[i];
+	while (ptr != NULL) {
+	    last = ptr;
+	    ptr = ptr->next;
+	    free(last->key);
+	    free(last);
+	}
+	h->table[i] = NULL;
     }
-    return 0;
+    h->keyN = 0;
 }
 
+
+
 /**
  *
- * Adds a key-value pairs to the hash table
- *
+ * Returns the bucket of a key
  *
- * Checks to see if s exists in the hash table, if it
- * doesn't add s to the hash table and store a value
- * of val.  If feature s exists in the hash table then
- * increment the frequency. The function has the 
- * following return values:
- * 0 or -1 if the feature isn't in the table
- * 1 if the feature is in the table
- * -1 more precisely indicates a hash collision has
- *  occurred.  i.e. two features hashed to the same
- *  key value, but are not the same.
- *
- *  Note that this function uses function pointers
- *  to a hashing function and a string comparison
- *  function.  This is to create polymorphic behavior
- *  depending upon whether we are hashing nucleotides
- *  or hashing proteins or using feature masking. 
- *
- * @param s a pointer to a string
- * @param val the integer value to add to the current value 
- * @retval 0 For feature not in hash 
- * @retval -1 For feature not in hash but hash collision,
- * @retval 1 For feature in hash
- * @see hashInc
- * @see strcmpf
- * @see hashf
+ * Positions which are masked out are not used.
  *
+ * @param h A hash table
+ * @param s A key
+ * @param buckets The number of buckets
+ * @retval >= 0 A valid hash index
+ * @retval -1 s contains an invalid character
  *
  */
 
-
-/*
-int hashAdd(char *s, unsigned val)
+static long hashIndex(const HASHTABLE * h, const char *s, unsigned buckets)
 {
-    NODE *ptr;
-    NODE *r;
-    int index;
+    long unsigned hash = 0;
+    int i, index;
 
-    if ((index = (*hashf) (s)) < 0)	
-	return 0;
+    for (i = 0; s[i] != '\0'; i++) {
+	if (h->mask && h->mask[i] != '1')
+	    continue;
+	if (!(index = h->values[(unsigned char) s[i]]))
+	    return -1;
+	hash = hash * h->radix + index;
+	if (h->stepwise)
+	    hash %= buckets;
+    }
+    return h->stepwise ? (long) hash : abs((int) hash) % buckets;
+}
 
 
-    ptr = table[index];
 
-    while (ptr != NULL) {
-	if ((*strcmpf) (ptr->key, s) == 0) {
-	    ptr->value += val;
-	    return 1;
-	}
+/**
+ *
+ * Compares two keys, ignoring masked out positions
+ *
+ * @param h A hash table
+ * @param s A key
+ * @param t A key
+ * @retval 1 if s and t are equal
+ * @retval 0 if s and t are different
+ *
+ */
 
-	ptr = ptr->next;
-    }
+static int keyEqual(const HASHTABLE * h, const char *s, const char *t)
+{
+    int i;
 
-    r = (NODE *) malloc(sizeof(NODE));
-    r->key = (char *) malloc(sizeof(char) * (Length + 1));
-    strcpy(r->key, s);
-    r->value = val;
-    r->next = table[index];
-    table[index] = r;
-    keyN++;
-    return -1;
+    if (!h->mask)
+	return !strcmp(s, t);
 
+    for (i = 0; s[i] != '\0' && t[i] != '\0'; i++)
+	if (h->mask[i] == '1' && s[i] != t[i])
+	    return 0;
+    return s[i] == t[i];
 }
-*/
-
-
 
 
 
 /**
  *
- * The hash value associated with key s
+ * Doubles the number of buckets of a hash table
  *
- * Returns the frequency stored in the hash which is associated with
- * feature s.
+ * @param h A hash table
+ * @return None
  *
- * @param s A pointer to a Key value s which is a string
- * @return an integer value associated the frequency of s
- * @retval >=0 if s is in hash
- * @retval 0 if s is not in hash
  */
 
-int hashval(register char *s)
+static void hashGrow(HASHTABLE * h)
 {
-    NODE *ptr;
-
-    ptr = table[(*hashf) (s)];
-
-
-    while (ptr != NULL) {
-	if ((*strcmpf) (ptr->key, s) == 0)
-	    return ptr->value;
-	ptr = ptr->next;
-    }
+    unsigned buckets = 2 * h->buckets + 1;
+    NODE **table = (NODE **) chkcalloc(sizeof(NODE *), buckets);
+    NODE *ptr, *next;
+    unsigned i;
+    long index;
+
+    for (i = 0; i < h->buckets; i++)
+	for (ptr = h->table[i]; ptr != NULL; ptr = next) {
+	    next = ptr->next;
+	    index = hashIndex(h, ptr->key, buckets);
+	    ptr->next = table[index];
+	    table[index] = ptr;
+	}
 
-    return 0;
+    free(h->table);
+    h->table = table;
+    h->buckets = buckets;
 }
 
 
 
-
 /**
  *
- * Assign a new value to the key value s
+ * Finds the node of a key, adding the key if needed
  *
- * Returns the frequency stored in the hash which is associated with
- * feature s.
- *
- * Note: need to add checking for whether has key is stored at all!
- *
- * @param s A pointer to a Key value s which is a string
- * @param n An integer which is the new value
- * @return true or false
- * @retval 1 if found
- * @retval 0 if not found
+ * @param h A hash table
+ * @param s A key
+ * @param found Set to whether s was in the table
+ * @return The node of s
+ * @retval NULL s contains an invalid character
  *
  */
 
-/* Moved to Macro definition */
-
-/*
-void hashAssign(char *s, int n)
+static NODE *hashNode(HASHTABLE * h, const char *s, bool * found)
 {
     NODE *ptr;
+    long index;
 
-    ptr = table[(*hashf) (s)];
+    if ((index = hashIndex(h, s, h->buckets)) < 0)	/* If an invalid hash */
+	return NULL;
 
-    while (ptr != NULL) {
-	if ((*strcmpf) (ptr->key, s) == 0) {
-		ptr->value = n;
-	    return;
+    for (ptr = h->table[index]; ptr != NULL; ptr = ptr->next)
+	if (keyEqual(h, ptr->key, s)) {
+	    *found = true;
+	    return ptr;
 	}
-	ptr = ptr->next;
+
+    if ((unsigned) h->keyN >= HASH_LOAD * h->buckets) {
+	hashGrow(h);
+	index = hashIndex(h, s, h->buckets);
     }
 
-    return;
+    ptr = (NODE *) chkmalloc(sizeof(NODE), 1);
+    ptr->key = (char *) chkmalloc(sizeof(char), strlen(s) + 1);
+    strcpy(ptr->key, s);
+    ptr->value = 0;
+    ptr->next = h->table[index];
+    h->table[index] = ptr;
+    h->keyN++;
+    *found = false;
+    return ptr;
 }
-*/
+
 
 
 /**
  *
- * returns a list of keys stored in the hash table
+ * Adds a key-value pair to the hash table
  *
- * This is function is used to return the values of the
- * keys hashed into the table.  No error checking is
- * provided to make sure that enough memory has been
- * allocated to store all the keys into the array of
- * strings.
+ * If s is in the table, val is added to its value,
+ * otherwise s is added with a value of val.
  *
- * @param s a pointer to an array of character arrays.
- * @return None
+ * @param h A hash table
+ * @param s a pointer to a string
+ * @param val the integer value to add to the current value 
+ * @retval 0 s contains an invalid character
+ * @retval -1 For feature not in hash
+ * @retval 1 For feature in hash
+ * @see hashInc
  *
  */
 
-
-void hashKeys(char ***s)
+int hashAdd(HASHTABLE * h, const char *s, unsigned val)
 {
-    int i, j;
     NODE *ptr;
-    char ** sp;
-    sp = (char **) malloc(sizeof(char *) * keyN);
-    for (i = 0; i < keyN; i++)
-	sp[i] = (char *) malloc(sizeof(char) * (Length + 1));
-    i = 0;
-    for (j = 0; j < BUCKETS; j++)
-	if (table[j] != NULL) {
-	    ptr = table[j];
-	    while (ptr != NULL) {
-		strcpy(sp[i++], ptr->key);
-		ptr = ptr->next;
-	    }
-	}
-   *s=sp;
+    bool found;
+
+    if ((ptr = hashNode(h, s, &found)) == NULL)
+	return 0;
+    ptr->value += val;
+    return found ? 1 : -1;
 }
 
 
+
 /**
  *
- * Returns the stored hash values
+ * Adds a key-value pair to the hash table if greater than
+ * the current value
  *
- * This function is used to return the values
- * stored in the hash table. The ordering is
- * not orderd by key in any way, but is retrieved
- * by increasing hash index.  This function can
- * be used to save the time involved in retrieving
- * all the keys and then looking up the value associated
- * with a key - one at a time.  This is especially useful
- * if the keys remain in the hash throughout and
- * ordering isn't essential.
- *
- * @param values
- * @return none
+ * @param h A hash table
+ * @param s a pointer to a string
+ * @param val the new value if greater than the current value
+ * @retval 0 s contains an invalid character
+ * @retval -1 For feature not in hash
+ * @retval 1 For feature in hash
  *
  */
 
-
-
-
-void hashValues(unsigned **values)
+int hashMax(HASHTABLE * h, const char *s, unsigned val)
 {
-    int i, j;
     NODE *ptr;
-    *values = (unsigned *) malloc(sizeof(unsigned *) * keyN);
-    i = 0;
-    for (j = 0; j < BUCKETS; j++)
-	if (table[j] != NULL) {
-	    ptr = table[j];
-	    while (ptr != NULL) {
-		*values[i++] = ptr->value;
-		ptr = ptr->next;
-	    }
-	}
+    bool found;
 
+    if ((ptr = hashNode(h, s, &found)) == NULL)
+	return 0;
+    if (val > ptr->value)
+	ptr->value = val;
+    return found ? 1 : -1;
 }
 
 
 
-
 /**
  *
- * Frees the memory allocated to store the hash
- *
- * All memory allocated with malloc is freed from the
- * hash.  All values are deleted. returns 0 on success.
- * The number of hash keys is also returned to zero.
- *
- * @param None
- * @retval 1 on success
+ * Assigns a new value to a key in the hash table
  *
+ * @param h A hash table
+ * @param s A pointer to a key
+ * @param val The new value
+ * @retval 1 if found
+ * @retval 0 if not found
  *
  */
 
-
-int freeHash(void)
+int hashAssign(HASHTABLE * h, const char *s, unsigned val)
 {
-    int i;
-    NODE *ptr;
-    NODE *last;
-    for (i = 0; i < BUCKETS; i++) {
-	ptr = table[i];
-	while (ptr != NULL) {
-	    last = ptr;
-	    ptr = ptr->next;
-	    free(last->key);
-	    free(last);
-	}
-	table[i] = NULL;
-    }
-    keyN = 0;
+    unsigned *v;
+
+    if ((v = hashFind(h, s)) == NULL)
+	return 0;
+    *v = val;
     return 1;
 }
 
+
+
 /**
  *
- *  Hash function for masked classed amino acid sequences
- *
- *  Returns a hash index, for char string s
- *  Positions which are masked out in w are
- *  not used to calculate index.
- *  String s must contain a valid character,
- *  one of the Amino acid classes specified in
- *  _class(), otherwise a hash of -1 is returned.
- *  
- *  Depends on global variable string weightVector
+ * The hash value associated with key s
  *
- *  @param s hash key
- *  @return  returns the hash index
- *  @retval -1 invalid class character
- *  @retval >0 a valid hash index
- *  @see _class()
- *  @todo Consider the possibility that classing be built into the hash functions, so that conversion to classes is unnecessary.  This eliminates a step.
+ * @param h A hash table
+ * @param s A pointer to a key
+ * @return The value of s, or 0 if s is not in the hash
  *
- ************************************************/
-
-
+ */
 
-static int hashaacwi(register const char *s)
+unsigned hashval(HASHTABLE * h, const char *s)
 {
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
-
-    while (s[i] != '\0') {
-	if (weightVector[i] == '1') {
-	    hash *= 12;
-	    index = aac_values[(unsigned char) s[i]];
-	    if (!index) {
-		return -1;
-	    }
-	    hash += index;
-	}
-	i++;
-    }
-    return (int) abs(hash) % BUCKETS;
+    unsigned *v = hashFind(h, s);
+    return v ? *v : 0;
 }
 
 
 
 /**
  *
- *  Hash function for amino acid sequences
+ * Finds the value stored for a key
  *
- *  Returns a hash index, for char string s
- *  Positions which are masked out in weightVector are
- *  not used to calculate index.
- *  String s must contain a valid character,
- *  one of the Amino acids.
- *  
+ * @param h A hash table
+ * @param s A pointer to a key
+ * @return A pointer to the value of s
+ * @retval NULL s is not in the hash
  *
- *  @param s hash key
- *  @return  returns the hash index
- *  @retval -1 Invalid Amino acid class character
- *  @retval >0 A valid hash index
- *
- ************************************************/
-
-
-
+ */
 
-static int hashaaci(register const char *s)
+unsigned *hashFind(HASHTABLE * h, const char *s)
 {
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
+    NODE *ptr;
+    long index;
 
-    while (s[i] != '\0') {
-	hash *= 12;
-	index = aac_values[(unsigned char) s[i]];
-	if (!index) {
-	    return -1;
-	}
-	hash += index;
-	i++;
-    }
-    return (int) abs(hash) % BUCKETS;
+    if ((index = hashIndex(h, s, h->buckets)) < 0)
+	return NULL;
+
+    for (ptr = h->table[index]; ptr != NULL; ptr = ptr->next)
+	if (keyEqual(h, ptr->key, s))
+	    return &ptr->value;
+    return NULL;
 }
 
 
+
 /**
  *
- *  Hash function for amino acid sequences
+ * Finds the value stored for a key, adding the key if needed
  *
- *  Returns a hash index, for char string s
- *  Positions which are masked out in weightVector are
- *  not used to calculate index.
- *  String s must contain a valid character,
- *  one of the Amino acids.
- *  
+ * A new key is stored with a value of 0.  A single
+ * lookup serves both to find and to insert a key.
  *
- *  @param s hash key
- *  @return  returns the hash index
- *  @retval -1 Invalid Amino acid class character
- *  @retval >0 A valid hash index
+ * @param h A hash table
+ * @param s A pointer to a key
+ * @return A pointer to the value of s
+ * @retval NULL s contains an invalid character
  *
- ************************************************/
-
-
-
+ */
 
-static int hashaawi(register const char *s)
+unsigned *hashRef(HASHTABLE * h, const char *s)
 {
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
-
-    while (s[i] != '\0') {
-	if (weightVector[i] == '1') {
-	    hash *= 21;
-	    index = aa_hash_values[(unsigned char) s[i]];
-	    if (!index) {
-		return -1;
-	    }
-	    hash += index;
-	}
-	i++;
-    }
-    return (int) abs(hash) % BUCKETS;
+    NODE *ptr;
+    bool found;
+
+    if ((ptr = hashNode(h, s, &found)) == NULL)
+	return NULL;
+    return &ptr->value;
 }
 
 
 
 /**
  *
- *  Hash function for amino acid sequences
+ * Removes a key from the hash table
  *
- *  Returns a hash index, for char string s
- *  String s must contain a valid amino acid character,
- *  otherwise a hash of -1 is returned.
- *  
- *  @param s hash key
- *  @retval -1 invalid amino acid character
- *  @retval >0 a valid hash index
- *  @return  returns the hash index
+ * @param h A hash table
+ * @param s A pointer to a key
+ * @retval 1 if found
+ * @retval 0 if not found
  *
- **************************************************/
-
-
-
+ */
 
-static int hashaai(register const char *s)
+int hashDel(HASHTABLE * h, const char *s)
 {
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
+    NODE **link, *ptr;
+    long index;
 
-    while (s[i] != '\0') {
-	hash *= 21;
-	index = aa_hash_values[(unsigned char) s[i]];
-	if (!index) {
-	    return -1;
+    if ((index = hashIndex(h, s, h->buckets)) < 0)	/* If an invalid hash */
+	return 0;
+
+    for (link = &h->table[index]; (ptr = *link) != NULL; link = &ptr->next)
+	if (keyEqual(h, ptr->key, s)) {
+	    *link = ptr->next;
+	    free(ptr->key);
+	    free(ptr);
+	    h->keyN--;
+	    return 1;
 	}
-	hash += index;
-	i++;
-    }
-    return (int) abs(hash) % BUCKETS;
+    return 0;
 }
 
 
 
-
-
-
-
-
-
-
-
 /**
  *
- *  Hash function for text sequences
+ * Iterates over the keys of a hash table
  *
- *  String s must contain a valid text character,
- *  
- *  @param s hash key
- *  @retval -1 invalid text character
- *  @retval >0 a valid hash index
- *  @return  returns the hash index
+ * The keys are returned by increasing bucket.  The
+ * table must not change during the iteration, except
+ * for the values.
  *
- **************************************************/
-
-
+ * @param h A hash table
+ * @param it The position, { 0, NULL } for the first key
+ * @return The next node
+ * @retval NULL after the last key
+ *
+ */
 
-static int hashtxti(register const char *s)
+NODE *hashNext(HASHTABLE * h, HASHITER * it)
 {
-    long unsigned hash = 0;
-    int i = 0;
-    register int index;
-
-    while (s[i] != '\0') {
-	hash *= 27;
-	index = txt_hash_values[(unsigned char) s[i]];
-	if (!index) {
-	    return -1;
-	}
-	hash += index;
-	i++;
-    }
-    return (int) abs(hash) % BUCKETS;
+    if (it->node && it->node->next)
+	return it->node = it->node->next;
+    if (it->node)
+	it->bucket++;
+    for (; it->bucket < h->buckets; it->bucket++)
+	if (h->table[it->bucket] != NULL)
+	    return it->node = h->table[it->bucket];
+    return it->node = NULL;
 }
 
 
+
 /**
  *
- * Adds a key-value pair to the hash table if greate than
- * current value
- *
- *
- * Checks to see if s exists in the hash table, if it
- * doesn't add s to the hash table and store a value
- * of val.  If feature s exists in the hash table then
- * increment the frequency. The function has the 
- * following return values:
- * 0 or -1 if the feature isn't in the table
- * 1 if the feature is in the table
- * -1 more precisely indicates a hash collision has
- *  occurred.  i.e. two features hashed to the same
- *  key value, but are not the same.
+ * Returns a list of keys stored in the hash table
  *
- *  Note that this function uses function pointers
- *  to a hashing function and a string comparison
- *  function.  This is to create polymorphic behavior
- *  depending upon whether we are hashing nucleotides
- *  or hashing proteins or using feature masking. 
- *
- * @param s a pointer to a string
- * @param val the integer value to add to the current value 
- * @retval 0 For feature not in hash 
- * @retval -1 For feature not in hash but hash collision,
- * @retval 1 For feature in hash
- * @see hashInc
- * @see strcmpf
- * @see hashf
+ * The keys are copied in the order of hashNext.  The
+ * caller frees each key and the list.
  *
+ * @param h A hash table
+ * @param s Returns the list of keys
+ * @return None
  *
  */
 
-
-int hashMax(char *s, unsigned val)
+void hashKeys(HASHTABLE * h, char ***s)
 {
+    HASHITER it = { 0, NULL };
     NODE *ptr;
-    NODE *r;
-    int index;
-
-    if ((index = (*hashf) (s)) < 0)	/* If an invalid hash */
-	return 0;
-
-
-    ptr = table[index];
-
-    while (ptr != NULL) {
-	if ((*strcmpf) (ptr->key, s) == 0) {
-	    ptr->value = ((val > ptr->value) ? val : ptr->value);
-	    return 1;
-	}
+    int i = 0;
 
-	ptr = ptr->next;
+    *s = (char **) chkmalloc(sizeof(char *), h->keyN + 1);
+    while ((ptr = hashNext(h, &it)) != NULL) {
+	(*s)[i] = (char *) chkmalloc(sizeof(char), strlen(ptr->key) + 1);
+	strcpy((*s)[i++], ptr->key);
     }
-
-
-    r = (NODE *) malloc(sizeof(NODE));
-    r->key = (char *) malloc(sizeof(char) * (Length + 1));
-    strcpy(r->key, s);
-    r->value = val;
-    r->next = table[index];
-    table[index] = r;
-    keyN++;
-    return -1;
-
 }
 
 
 
+/**
+ *
+ * Returns the stored hash values
+ *
+ * The values are returned in the order of hashNext,
+ * which is the order of hashKeys.
+ *
+ * @param h A hash table
+ * @param values Returns the list of values
+ * @return none
+ *
+ */
 
-int hashDel(char *s)
+void hashValues(HASHTABLE * h, unsigned **values)
 {
+    HASHITER it = { 0, NULL };
     NODE *ptr;
-    NODE *r;
-    int index;
-
-    if ((index = (*hashf) (s)) < 0)	/* If an invalid hash */
-	return 0;
-
-
-    ptr = table[index];
-    r = table[index];
-
-    while (ptr != NULL) {
-	if ((*strcmpf) (ptr->key, s) == 0) {
-	    if (r == table[index]) {
-		table[index] = ptr->next;
-	    } else
-		r->next = ptr->next;
-	    free(ptr);
-	    keyN--;
-
-	    break;
-	}
-	r = ptr;
-	ptr = ptr->next;
-    }
-
+    int i = 0;
 
-    return 0;
+    *values = (unsigned *) chkmalloc(sizeof(unsigned), h->keyN + 1);
+    while ((ptr = hashNext(h, &it)) != NULL)
+	(*values)[i++] = ptr->value;
 }
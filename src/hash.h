@@ -18,9 +18,12 @@
 #ifndef _HASH_H_
 #define _HASH_H_
 
-#define BUCKETS 20013 /**< The Total number of buckets in feature hash table */
-#define hashInc(X) hashAdd((X),(1)) /**< Macro for incrementing a key-value sotred in the hash */
-#define numKeys(void)  keyN /**< Macro for number of keys in hash */
+#include <stdbool.h>
+
+#define BUCKETS 20013 /**< The initial number of buckets in a feature hash table */
+#define HASH_LOAD 2 /**< Keys per bucket at which a feature hash table grows */
+#define hashInc(H,X) hashAdd((H),(X),(1)) /**< Macro for incrementing a key-value stored in the hash */
+#define numKeys(H) ((H)->keyN) /**< Macro for number of keys in hash */
 
 
 /** Linked list for storing values in the hash */
@@ -32,205 +35,52 @@ typedef struct node {
 } NODE;
 
 
-NODE *table[BUCKETS];  /**< The hash table consisting of an Array of NODES */
-
+/**
+ * A feature hash table
+ *
+ * Every table holds its own buckets and hash function, so
+ * any number of tables can be used at the same time, each
+ * by one thread.  The table grows when it holds more than
+ * HASH_LOAD keys per bucket.
+ */
 
-int keyN; /**< The number of elements in the hash table */
+typedef struct hashtable {
+    NODE **table;	/**< The buckets, an array of linked lists */
+    unsigned buckets;	/**< Number of buckets */
+    int keyN;		/**< The number of elements in the hash table */
+    const int *values;	/**< Character values of the hash function, 0 for invalid characters */
+    unsigned radix;	/**< Multiplier of the hash function */
+    bool stepwise;	/**< Reduce the hash at every character, as for nucleotides */
+    const char *mask;	/**< Feature mask, positions marked '1' are used, or NULL */
+} HASHTABLE;
 
 
-/* function pointers */
+/** Position of hashNext in a table, start with { 0, NULL } */
 
-int (*hashf) (register const char *);/**< A function ptr to a hashing function, set by initHash() */
-int (*strcmpf) (register const char *, register const char *);/**< A ptr to a comparison function, set by initHash() */
+typedef struct {
+    unsigned bucket;	/**< Bucket of node */
+    NODE *node;		/**< Last node returned */
+} HASHITER;
 
 
 /* prototypes */
 
-void initHash(int bool, int bool2, int bool3);
-int hashval(register char *s);
-void hashKeys(char ***s);
-int numKeys(void);
-int freeHash(void);
-//void hashAssign(char *s, int n);
-//int hashAdd(char *s, unsigned val);
-void hashValues(unsigned **values);
-int hashDel(char *s);
-int hashMax(char *s, unsigned val);
+HASHTABLE *hashCreate(int mode, bool isClass, const char *mask);
+void hashDestroy(HASHTABLE * h);
+void hashClear(HASHTABLE * h);
+int hashAdd(HASHTABLE * h, const char *s, unsigned val);
+int hashMax(HASHTABLE * h, const char *s, unsigned val);
+int hashAssign(HASHTABLE * h, const char *s, unsigned val);
+unsigned hashval(HASHTABLE * h, const char *s);
+unsigned *hashFind(HASHTABLE * h, const char *s);
+unsigned *hashRef(HASHTABLE * h, const char *s);
+int hashDel(HASHTABLE * h, const char *s);
+NODE *hashNext(HASHTABLE * h, HASHITER * it);
+void hashKeys(HASHTABLE * h, char ***s);
+void hashValues(HASHTABLE * h, unsigned **values);
 
 
 enum hash_modes { nucleotide, amino, text }; /**< Type of hash to initialize */
 
 
-
-
-static const int base_ry_hash_values[] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 1, 0, 0, 0, 0, 0, 0, 2,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 1, 0, 0, 0, 0, 0,
-    0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0
-}; /**< Character values for ry hash function */
-
-
-
-static const int aac_values[] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 1, 0, 2, 3, 3,
-    4, 5, 6, 7, 0, 8, 7, 7, 9, 0,
-    10, 8, 8, 11, 11, 0, 7, 4, 0, 4,
-    0, 0, 0, 0, 0, 0, 0, 1, 0, 2,
-    3, 3, 4, 5, 6, 7, 0, 8, 7, 7,
-    9, 0, 10, 8, 8, 11, 11, 0, 7, 4,
-    0, 4, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0
-}; /**< Character values for classed amino acids */
-
-
-
-static const int aa_hash_values[] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 1, 0, 2, 3, 4,
-    5, 6, 7, 8, 0, 9, 10, 11, 12, 0,
-    13, 14, 15, 16, 17, 0, 18, 19, 0, 20,
-    0, 0, 0, 0, 0, 0, 0, 1, 0, 2,
-    3, 4, 5, 6, 7, 8, 0, 9, 10, 11,
-    12, 0, 13, 14, 15, 16, 17, 0, 18, 19,
-    0, 20, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0
-}; /**< Character values for amino acids */
-
-
-static const int txt_hash_values[] = {
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 1, 2, 3, 4, 5,
-    6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
-    16, 17, 18, 19, 20, 21, 22, 23, 24, 25,
-    26, 0, 0, 0, 0, 0, 0, 1, 2, 3,
-    4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
-    14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
-    24, 25, 26, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0
-};
-
-
-#define hashAdd(S, VAL) \
-do { \
-    NODE * __ptrx; \
-    NODE * __rx; \
-    int __indexx; \
-    \
-    if ((__indexx = (*hashf) ((S))) >= 0) {	\
-     \
-    __ptrx = table[__indexx]; \
-    \
-    while (__ptrx != NULL) { \
-	if ((*strcmpf) (__ptrx->key, (S)) == 0) { \
-	    __ptrx->value += (VAL); \
-		break; \
-	} \
-	__ptrx = __ptrx->next; \
-    } \
-    if (__ptrx == NULL ) { \
-    __rx = (NODE *) malloc(sizeof(NODE)); \
-    __rx->key = (char *) malloc(sizeof(char) * (Length + 1)); \
-    strcpy(__rx->key, (S)); \
-    __rx->value = (VAL); \
-    __rx->next = table[__indexx]; \
-    table[__indexx] = __rx; \
-    keyN++; \
-     } \
-    } \
-} while(0)
-
-
-
-
-
-#define hashAssign(S,N)  \
-   do { \
-    NODE *__ptr; \
-    __ptr = table[(*hashf)(S)]; \
-    while (__ptr != NULL) { \
-	if ((*strcmpf) (__ptr->key, (S) ) == 0) { \
-		__ptr->value = (N); \
-	    break; \
-	} \
-	__ptr = __ptr->next; \
-    } \
-   } while(0)
-
-
-
 #endif				/* _HASH_H_ */
@@ -14,11 +14,14 @@
 * Gregory E. Sims (C) 2010-2012
 *
 *****************************************************/
+#define _POSIX_C_SOURCE  200809L  // To use open_memstream
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <errno.h>
+#include <pthread.h>
 #include "hashroll.h"
 #include "utils.h"
 #include "../config.h"
@@ -26,7 +29,6 @@
 #define A 16807
 #define IAMOD2P16 22039
 #define MOD2P16 0x0000ffff
-extern char *weightVector;
 
 
 /**
@@ -71,7 +73,7 @@ void resetHash(HASH * h)
 }
 
 
-void init(HASH * h, int isMasked, int mode, bool isClass, bool reverse, int k)
+void init(HASH * h, char *mask, int mode, bool isClass, bool reverse, int k)
 {
     h->k = k;
     h->s = (char *)chkmalloc(sizeof(char),k+1);
@@ -85,6 +87,12 @@ void init(HASH * h, int isMasked, int mode, bool isClass, bool reverse, int k)
     h->reverse = reverse;
     memset(h->table, 0, sizeof(NODE *) * BUCKETS);
     h->keyN = 0;
+    h->mask = mask;
+    h->multiple = false;
+    h->list = false;
+    h->inHeader = 0;
+    h->out = stdout;
+    h->flush = printFeatures;
 
     if (mode == nucleotide) {
 	if (isClass)
@@ -433,7 +441,7 @@ char *strupr(char *s)
 // the hash value in the reverse direction so that
 // we don't need to know the length of the string.
 
-int hashAdd(HASH * h, char *s, unsigned val)
+int hashAddNuc(HASH * h, char *s, unsigned val)
 {
     int i = 0;
     int k = h->k;
@@ -538,14 +546,14 @@ int hashAddw(HASH * h, char *s, unsigned val)
     ptr = h->table[idx];
 
     for (j = 0; j < h->k; j++)
-	if (weightVector[j] == '0') {
+	if (h->mask[j] == '0') {
 	    idx -= apnmod[h->hashi[(unsigned char) s[j]]][h->k - j - 1];
 	    idx &= MOD2P16;
 	}
 
 
     while (ptr != NULL) {
-	if (new_strcmpw(ptr->key, s) == 0) {
+	if (new_strcmpw(h->mask, ptr->key, s) == 0) {
 	    ptr->value += val;
 	    return 1;
 	}
@@ -671,14 +679,14 @@ int hashAddwaa(HASH * h, char *s, unsigned val)
 
 
     for (j = 0; j < h->k; j++)
-	if (weightVector[j] == '0') {
+	if (h->mask[j] == '0') {
 	    idx -= apnmodaa[h->hashi[(unsigned char) s[j]]][h->k - j - 1];
 	    idx &= MOD2P16;
 	}
 
     ptr = h->table[idx];
     while (ptr != NULL) {
-	if (new_strcmpw(ptr->key, s) == 0) {
+	if (new_strcmpw(h->mask, ptr->key, s) == 0) {
 	    ptr->value += val;
 	    return 1;
 	}
@@ -743,7 +751,7 @@ unsigned int hashValNuc(HASH * h, register char *s)
 }
 
 
-int hashAssign(HASH * h, register char *s, unsigned int val)
+int hashAssignNuc(HASH * h, register char *s, unsigned int val)
 {
     int i = 0;
     int k = h->k;
@@ -795,34 +803,32 @@ void pushatgc(HASH * h, char *c, int n,bool firstRecord)
     //calculate hash
     NODE *ptr;
     NODE *r;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned *idx;
-    extern bool mflag; // global value indicating process multiple headers
     int i;
     
     for (i = 0; i < n; i++) {
 	// Buffer and process several bases at once.
 	// Skip over header defline.
 	// 
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) 
 			i++;
 
          // check to see if we're done processing header
 	    if (i < n) 
-		inHeader = 0;
+		h->inHeader = 0;
 	    else 
 		return;
 	
          //@todo add warning for not finding any keys.	    
 	 // In this case no warnings will be produced when
 	 // no keys are found.
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -924,27 +930,25 @@ void chkpushatgc(HASH * h, char *c, int n,bool firstRecord)
 {
     //calculate hash
     NODE *ptr;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned *idx;
-    extern bool mflag;
     int i;
     for (i = 0; i < n; i++) {
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1028,30 +1032,28 @@ void chkpushatgcw(HASH * h, char *c, int n,bool firstRecord)
 {
     //calculate hash
     NODE *ptr;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned int idx;
-    extern bool mflag;
     int i, j;
     for (i = 0; i < n; i++) {
 	// It might be possible to buffer this so that we process several bases at once.
 	// w/o the expense of a function call every base.
 	// avoid the unsigned char casts, just declare as unsigned char
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1114,7 +1116,7 @@ void chkpushatgcw(HASH * h, char *c, int n,bool firstRecord)
 	    }
 
 	    for (j = 0; j < h->k; j++)
-		if (weightVector[j] == '0') {
+		if (h->mask[j] == '0') {
 		    idx -= apnmod[h->hashi[(unsigned char) s[j]]][h->k - j - 1];
 		    idx &= MOD2P16;
 		}
@@ -1122,7 +1124,7 @@ void chkpushatgcw(HASH * h, char *c, int n,bool firstRecord)
 
 	    ptr = h->table[idx];
 	    while (ptr != NULL) {
-		if (new_strcmpw(ptr->key, s) == 0) {
+		if (new_strcmpw(h->mask, ptr->key, s) == 0) {
 		    ptr->value++;	// to make generic.
 		    break;
 		}
@@ -1143,11 +1145,9 @@ void pushatgcw(HASH * h, char *c, int n,bool firstRecord)
     //calculate hash
     NODE *ptr;
     NODE *r;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned idx;
-    extern bool mflag;
     int i, j;
 
 
@@ -1157,20 +1157,20 @@ void pushatgcw(HASH * h, char *c, int n,bool firstRecord)
 	// It might be possible to buffer this so that we process several bases at once.
 	// w/o the expense of a function call every base.
 	// avoid the unsigned char casts, just declare as unsigned char
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1237,7 +1237,7 @@ void pushatgcw(HASH * h, char *c, int n,bool firstRecord)
 	    }
 	    //apply weight mask
 	    for (j = 0; j < h->k; j++)
-		if (weightVector[j] == '0') {
+		if (h->mask[j] == '0') {
 		    idx -= apnmod[h->hashi[(unsigned char) s[j]]][h->k - j - 1];
 		    idx &= MOD2P16;
 		}
@@ -1246,7 +1246,7 @@ void pushatgcw(HASH * h, char *c, int n,bool firstRecord)
 	    ptr = h->table[idx];
 
 		while (ptr != NULL) {
-		    if (new_strcmpw(ptr->key, s) == 0) {
+		    if (new_strcmpw(h->mask, ptr->key, s) == 0) {
 			ptr->value++;	// to make generic.
 			break;
 		    }
@@ -1288,30 +1288,28 @@ void pushaa(HASH * h, char *c, int n,bool firstRecord)
     //calculate hash
     NODE *ptr;
     NODE *r;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned *idx;
-    extern bool mflag;
     int i;
     for (i = 0; i < n; i++) {
 	// It might be possible to buffer this so that we process several bases at once.
 	// w/o the expense of a function call every base.
 	// avoid the unsigned char casts, just declare as unsigned char
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1387,27 +1385,25 @@ void chkpushaa(HASH * h, char *c, int n,bool firstRecord)
 {
     //calculate hash
     NODE *ptr;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned *idx;
-    extern bool mflag;
     int i;
     for (i = 0; i < n; i++) {
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1469,30 +1465,28 @@ void chkpushaaw(HASH * h, char *c, int n, bool firstRecord)
 {
     //calculate hash
     NODE *ptr;
-    static int inHeader = 0;
     unsigned char index;
     unsigned int idx;
-    extern bool mflag;
 
     int i, j;
     for (i = 0; i < n; i++) {
 	// It might be possible to buffer this so that we process several bases at once.
 	// w/o the expense of a function call every base.
 	// avoid the unsigned char casts, just declare as unsigned char
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1534,7 +1528,7 @@ void chkpushaaw(HASH * h, char *c, int n, bool firstRecord)
 	if (h->numChar == h->k) {
 	    idx = h->st_hash;
 	    for (j = 0; j < h->k; j++)
-		if (weightVector[j] == '0') {
+		if (h->mask[j] == '0') {
 		    idx -=
 			apnmodaa[h->hashi[(unsigned char) h->s[j]]][h->k - j -
 								    1];
@@ -1543,7 +1537,7 @@ void chkpushaaw(HASH * h, char *c, int n, bool firstRecord)
 
 	    ptr = h->table[idx];
 	    while (ptr != NULL) {
-		if (new_strcmpw(ptr->key, h->s) == 0) {
+		if (new_strcmpw(h->mask, ptr->key, h->s) == 0) {
 		    ptr->value++;	// to make generic.
 		    break;
 		}
@@ -1613,30 +1607,28 @@ void pushaaw(HASH * h, char *c, int n,bool firstRecord)
     //calculate hash
     NODE *ptr;
     NODE *r;
-    static int inHeader = 0;
     unsigned char index;
     char *s;
     unsigned idx;
-    extern bool mflag;
     int i, j;
 
 
     for (i = 0; i < n; i++) {
 
-	if (c[i] == '>' || inHeader) {
-	    inHeader = 1;
+	if (c[i] == '>' || h->inHeader) {
+	    h->inHeader = 1;
 	    // gulp up header
 	    while (c[i] != '\n' && i < n) {
 		i++;
 	    }
 
 	    if (i < n)
-		inHeader = 0;
+		h->inHeader = 0;
 	    else
 		return;
 
-	    if (mflag && !firstRecord)  
-		printFeatures(h);
+	    if (h->multiple && !firstRecord)  
+		(*(h->flush)) (h);
 
 	    if (firstRecord) 
 		firstRecord=false;
@@ -1683,7 +1675,7 @@ void pushaaw(HASH * h, char *c, int n,bool firstRecord)
 
 	    //apply weight mask
 	    for (j = 0; j < h->k; j++)
-		if (weightVector[j] == '0') {
+		if (h->mask[j] == '0') {
 		    idx -=
 			apnmodaa[h->hashi[(unsigned char) s[j]]][h->k - j - 1];
 		    idx &= MOD2P16;
@@ -1693,7 +1685,7 @@ void pushaaw(HASH * h, char *c, int n,bool firstRecord)
 	    ptr = h->table[idx];
 
 		while (ptr != NULL) {
-		    if (new_strcmpw(ptr->key, s) == 0) {
+		    if (new_strcmpw(h->mask, ptr->key, s) == 0) {
 			ptr->value++;	// to make generic.
 			break;
 		    }
@@ -1825,6 +1817,7 @@ int freeHash(HASH * h)
  * it can only be used by the hash functions.
  * Uses a feature mask, ignoring masked out features
  *
+ * @param w the feature mask, '0' at the positions to ignore
  * @param s a null terminated string
  * @param t a null terminated string
  * @retval 1 if s and t are equal
@@ -1833,9 +1826,8 @@ int freeHash(HASH * h)
  */
 
 //make static again.
-int new_strcmpw(register const char *s, register const char *t)
+int new_strcmpw(const char *w, register const char *s, register const char *t)
 {
-    char *w = weightVector;
     while (*s != '\0')
 	if ((*w++) == '1') {
 	    if ((*s++) != (*t++))
@@ -1895,7 +1887,7 @@ int new_strcmp(const char *s, const char *t)
  */
 
 
-void hashKeys(HASH * h, char ***s)
+void hashKeyList(HASH * h, char ***s)
 {
     int i, j;
     NODE *ptr;
@@ -2016,34 +2008,184 @@ void printFeatures(HASH * h)
     int i;
     char **keys;
     unsigned *values;
-    extern char fflag;
+    WRITER *w = writerOpen(h->out);
 
-    if (h->keyN == 0)
+    // an input without keys is an empty row, to keep the rows in step
+    if (h->keyN == 0) {
 	warn_msg("Warning: No keys of length %d found.\n", h->k);
+	writeChar(w, '\n');
+    }
 
-    if (fflag)
+    if (h->list)
 	hashValuesAndSet(h, &values);
     else
 	hashKeysAndValues(h, &keys, &values);
 
 
-    for (i = 0; i < h->keyN-1; i++) {
-	if (fflag)
-	    printf("%d\t", values[i]);
-	else {
-	    printf("%s\t%d\t", keys[i], values[i]);
+    for (i = 0; i < h->keyN; i++) {
+	if (!h->list) {
+	    writeString(w, keys[i]);
+	    writeChar(w, '\t');
 	    free(keys[i]);
 	}
+	writeUlong(w, values[i]);
+	writeChar(w, i + 1 < h->keyN ? '\t' : '\n');
     }
-	if (fflag)
-	    printf("%d\n", values[i]);
-	else {
-	    printf("%s\t%d\n", keys[i], values[i]);
-	    free(keys[i]);
-	}
+    writerClose(w);
 
     resetHash(h);
-    if (!fflag)
+    if (!h->list)
 	freeHash(h);
     free(values);
 }
+
+
+
+/* Files counted in parallel, the -T of ffpry and ffpaa.  Each
+ * thread takes the next file argument under lock, counts it in a
+ * hash of its own into memory and waits for its turn to write, so
+ * the profiles come out in argument order. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t written;
+    char **files;           // file arguments
+    int n;                  // number of file arguments
+    int nextfile;           // number of the next file to count
+    int nextout;            // number of the next file to write
+    void (*parse) (HASH *, FILE *); // counts a file and prints its FFP
+} FILEWORK;
+
+typedef struct {
+    FILEWORK *w;
+    HASH *h;                // hash of the thread, reused for each file
+} FILEJOB;
+
+
+
+/* Wait until the files before file i have been written */
+static void waitTurn(FILEWORK * w, int i)
+{
+    pthread_mutex_lock(&w->lock);
+    while (w->nextout != i)
+	pthread_cond_wait(&w->written, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+
+
+/* Count files until the arguments are exhausted.  Standard input
+ * is only read in its turn, and a file that cannot be opened ends
+ * the program in its turn, as without -T. */
+static void *fileWorker(void *arg)
+{
+    FILEJOB *job = (FILEJOB *) arg;
+    FILEWORK *w = job->w;
+    HASH *h = job->h;
+    char *outbuf;
+    size_t outlen;
+    FILE *fp;
+    int i, err;
+
+    for (;;) {
+	pthread_mutex_lock(&w->lock);
+	i = w->nextfile++;
+	pthread_mutex_unlock(&w->lock);
+	if (i >= w->n)
+	    break;
+
+	if (!strcmp(w->files[i], "-")) {
+	    waitTurn(w, i);
+	    fp = stdin;
+	} else if ((fp = fopen(w->files[i], "r")) == NULL) {
+	    err = errno;
+	    waitTurn(w, i);
+	    fatal_msg("%s: %s\n", w->files[i], strerror(err));
+	}
+	if (isDirectory(w->files[i])) {
+	    waitTurn(w, i);
+	    fatal_msg("%s: %s\n", w->files[i], strerror(EISDIR));
+	}
+
+	if ((h->out = open_memstream(&outbuf, &outlen)) == NULL)
+	    fatal_msg("%s\n", strerror(errno));
+	w->parse(h, fp);
+	fclose(h->out);
+	if (fp != stdin)
+	    fclose(fp);
+
+	waitTurn(w, i);
+	if (fwrite(outbuf, sizeof(char), outlen, stdout) != outlen)
+	    fatal_msg("Write Error: %s\n", strerror(errno));
+	free(outbuf);
+	pthread_mutex_lock(&w->lock);
+	w->nextout++;
+	pthread_cond_broadcast(&w->written);
+	pthread_mutex_unlock(&w->lock);
+    }
+    return NULL;
+}
+
+
+
+/**
+ *
+ *  Counts the files on the threads of -T, one file per thread at
+ *  a time
+ *
+ *  Every thread counts in a hash of its own, the first in h.
+ *
+ *  @param h The initialized hash of the first thread.
+ *  @param files The file arguments.
+ *  @param n The number of file arguments.
+ *  @param threads The number of threads.
+ *  @param initf Initializes the hash of another thread as h.
+ *  @param parse Counts a file in a hash and prints its FFP.
+ *  @return none
+ *
+ */
+
+void countFiles(HASH * h, char **files, int n, int threads,
+		void (*initf) (HASH *), void (*parse) (HASH *, FILE *))
+{
+    FILEWORK work;
+    FILEJOB *job;
+    pthread_t *tid;
+    int t, nt = (threads < n) ? threads : n;
+
+    job = (FILEJOB *) chkmalloc(sizeof(FILEJOB), nt);
+    tid = (pthread_t *) chkmalloc(sizeof(pthread_t), nt);
+    pthread_mutex_init(&work.lock, NULL);
+    pthread_cond_init(&work.written, NULL);
+    work.files = files;
+    work.n = n;
+    work.nextfile = 0;
+    work.nextout = 0;
+    work.parse = parse;
+    for (t = 0; t < nt; t++) {
+	job[t].w = &work;
+	if (t == 0)
+	    job[t].h = h;
+	else {
+	    job[t].h = (HASH *) chkmalloc(sizeof(HASH), 1);
+	    initf(job[t].h);
+	}
+    }
+
+    for (t = 1; t < nt; t++)
+	if (pthread_create(&tid[t], NULL, fileWorker, &job[t]))
+	    fatal_msg("Error creating thread: %s\n", strerror(errno));
+    fileWorker(&job[0]);
+    for (t = 1; t < nt; t++)
+	pthread_join(tid[t], NULL);
+
+    for (t = 1; t < nt; t++) {
+	freeHash(job[t].h);
+	free(job[t].h->s);
+	free(job[t].h->r);
+	free(job[t].h);
+    }
+    pthread_cond_destroy(&work.written);
+    pthread_mutex_destroy(&work.lock);
+    free(job);
+    free(tid);
+}
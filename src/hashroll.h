@@ -19,9 +19,10 @@
 #define _HASHROLL_H_
 
 #define BUCKETS 65536 /**< The Total number of buckets in feature hash table */
-#define hashInc(X) hashAdd((X),(1)) /**< Macro for incrementing a key-value stored in the hash */
+#define hashInc(X) hashAddNuc((X),(1)) /**< Macro for incrementing a key-value stored in the hash */
 #define numKeys(void)  keyN /**< Macro for number of keys in hash */
 #define MAX_WORD_SIZE 40
+#include <stdio.h>
 #include <stdbool.h>
 
 /** Linked list for storing values in the hash */
@@ -48,7 +49,13 @@ typedef struct hash {
 			      /**<@todo we can achieve some object orientedness by performing the inithash on this variable and
 			       * leaving the function pointers to various kinds of hashes here */
     int keyN;	  /**< The number of elements in the hash table */
+    char *mask;	  /**< Feature mask of the masked hashes, '0' at the positions to ignore */
+    bool multiple;	/**< Flush the features of each sequence at its header, ffpry -m */
+    bool list;	  /**< Print only the values, of the features listed by ffpry -f */
+    int inHeader;	/**< state: Did the last block end inside a header line? */
+    FILE *out;	  /**< Stream printFeatures writes to, stdout by default */
     int (*strcmpf) (register const char *, register const char *);
+    void (*flush) (struct hash *);	/**< Takes the features of a sequence with multiple, printFeatures by default */
 } HASH;
 
 
@@ -71,26 +78,28 @@ int hashAddwaa(HASH * h, char *s, unsigned val);
 int hashAddaa(HASH * h, char *s, unsigned val);
 
 void printFeatures(HASH * h);
-int hashAdd(HASH * h, char *s, unsigned val);
+int hashAddNuc(HASH * h, char *s, unsigned val);
 int hashAddw(HASH * h, char *s, unsigned val);
 void resetHash(HASH * h);
-void init(HASH * h, int isMasked, int mode, bool isClass, bool reverse, int k);
+void init(HASH * h, char *mask, int mode, bool isClass, bool reverse, int k);
 void pushatgc(HASH *, char *, int,bool);
 void pushatgcw(HASH *, char *, int,bool);
 void chkpushatgc(HASH * h, char *c, int,bool);
 void chkpushatgcw(HASH * h, char *c, int n,bool);
-int new_strcmpw(register const char *s, register const char *t);
+int new_strcmpw(const char *w, register const char *s, register const char *t);
 int new_strcmp(const char *s, const char *t);
 unsigned int hashValNuc(HASH * h, register char *s);
-void hashKeys(HASH *, char ***s);
+void hashKeyList(HASH *, char ***s);
 void hashKeysAndValues(HASH * h, char ***s, unsigned **d);
 int numKeys(void);
 int freeHash(HASH *);
-int hashAssign(HASH * h, register char *s, unsigned int val);
+int hashAssignNuc(HASH * h, register char *s, unsigned int val);
 void hashValues(unsigned **values);
 int hashDel(char *s);
 int hashMax(char *s, unsigned val);
 void hashValuesAndSet(HASH * h, unsigned **d);
+void countFiles(HASH * h, char **files, int n, int threads,
+		void (*initf) (HASH *), void (*parse) (HASH *, FILE *));
 
 enum hash_modes { nucleotide, amino, text }; /**< Type of hash to initialize */
 
@@ -0,0 +1,732 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#define _POSIX_C_SOURCE  200809L  // To use open_memstream and strdup
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <getopt.h>
+#include <pthread.h>
+#include "hashroll.h"
+#include "utils.h"
+#include "profile.h"
+#include "column.h"
+#include "tree.h"
+#include "ffp.h"
+#include "../config.h"
+
+
+#define TAXANAMELEN 50 /**< Length of a taxa name in the phylip matrix, as in ffpjsd */
+#define EXACT_PRECISION 16 /**< Decimals that keep a distance exactly, see ffpTree */
+#define ERRORLEN 512 /**< Longest error message kept for ffpError */
+
+
+/* Makes an error in a library call return fail from the call, see
+ * libraryReturn.  The call ends with releaseErrors before returning. */
+#define catchErrors(fail) \
+    jmp_buf jump, *outer = errorJump; \
+    if (setjmp(jump)) { \
+	errorJump = outer; \
+	return fail; \
+    } \
+    errorJump = &jump
+#define releaseErrors() errorJump = outer
+
+
+/** Counts the features of FASTA text, see ffpCounterNew */
+
+struct ffp_counter {
+    HASH h;		/**< The rolling hash, first so that its flush finds the counter */
+    bool firstRecord;	/**< No text was counted yet since ffpCountEnd */
+    char *buf;		/**< Copy of the text being counted, changed by the hash */
+    char ***keys;	/**< Features of the profiles not yet taken by ffpProfile */
+    unsigned **vals;	/**< Counts of the features */
+    unsigned *n;	/**< Number of features of each profile */
+    unsigned head, tail, size;	/**< The profiles are head ... tail-1 of size allocated */
+};
+
+
+/** Profiles put in columns, see ffpSetNew */
+
+struct ffp_set {
+    bool isClass;	/**< Class the features, ffpcol without -d */
+    char ***keys;	/**< Features of each row, until the columns are made */
+    unsigned **vals;	/**< Counts of the features of each row */
+    unsigned *n;	/**< Number of features of each row */
+    uint32_t rows, size;	/**< Number of rows and allocated rows */
+    PROFILES *p;	/**< The rows in columns, NULL until needed */
+};
+
+
+/* tree.c builds one tree at a time, see ffpTree */
+static pthread_mutex_t treeLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The last error of each thread, and where its library call returns */
+static __thread char errorText[ERRORLEN];
+static __thread jmp_buf *errorJump = NULL;
+
+
+/* Function prototypes */
+
+static void keepProfile(HASH * h);
+static PROFILES *setColumns(FFP_SET * s);
+
+
+
+/**
+ * Creates a counter of the features of nucleotide FASTA text
+ *
+ * The features are counted as by ffpry.  The text is given
+ * to ffpCount in pieces of any size, and ffpCountEnd ends
+ * the text of one input.  With multiple, each sequence of
+ * the input is a profile of its own, as with ffpry -m,
+ * otherwise the input is one profile.
+ *
+ * @param length The feature length, ffpry -l
+ * @param ry Count RY coded features, ffpry without -d
+ * @param reverse Count a feature and its reverse complement as one, ffpry without -r
+ * @param multiple Make a profile of each sequence, ffpry -m
+ * @return A new counter, freed with ffpCounterFree, or NULL on error
+ */
+
+FFP_COUNTER *ffpCounterNew(int length, bool ry, bool reverse, bool multiple)
+{
+    FFP_COUNTER *c;
+    catchErrors(NULL);
+
+    if (length < 1 || length > MAX_WORD_SIZE)
+	fatal_msg("%d: Feature length must be from 1 to %d\n", length,
+		  MAX_WORD_SIZE);
+
+    c = (FFP_COUNTER *) chkcalloc(sizeof(FFP_COUNTER), 1);
+    init(&c->h, NULL, nucleotide, ry, reverse, length);
+    c->h.multiple = multiple;
+    c->h.flush = keepProfile;
+    c->firstRecord = true;
+    c->buf = (char *) chkmalloc(sizeof(char), BUFSIZ);
+    releaseErrors();
+    return c;
+}
+
+
+
+/**
+ * Counts the features of a piece of FASTA text
+ *
+ * The text continues the text given before, so a sequence
+ * or a header may be split between pieces.
+ *
+ * @param c The counter
+ * @param buf The text
+ * @param n Length of the text
+ * @return 0, or -1 on error
+ */
+
+int ffpCount(FFP_COUNTER * c, const char *buf, size_t n)
+{
+    size_t m;
+    catchErrors(-1);
+
+    // the hash changes the text it counts, so it counts a copy
+    while (n > 0) {
+	m = n < BUFSIZ ? n : BUFSIZ;
+	memcpy(c->buf, buf, m);
+	pushatgc(&c->h, c->buf, (int) m, c->firstRecord);
+	c->firstRecord = false;
+	buf += m;
+	n -= m;
+    }
+    releaseErrors();
+    return 0;
+}
+
+
+
+/**
+ * Ends the text of an input
+ *
+ * The features counted since the last profile are the last
+ * profile of the input, and the next text starts a new
+ * input.  As ffpry, a profile without features is kept
+ * as an empty profile, with a warning.
+ *
+ * @param c The counter
+ * @return 0, or -1 on error
+ */
+
+int ffpCountEnd(FFP_COUNTER * c)
+{
+    catchErrors(-1);
+
+    keepProfile(&c->h);
+    c->firstRecord = true;
+    c->h.inHeader = 0;
+    releaseErrors();
+    return 0;
+}
+
+
+
+/**
+ * Takes the next profile of a counter
+ *
+ * The profiles are taken in the order of their sequences.
+ * The features are listed in the order ffpry prints them.
+ * The caller frees each key and both arrays, or hands them
+ * to ffpSetAdd.  An empty profile has no features and
+ * NULL arrays.
+ *
+ * @param c The counter
+ * @param keys Returns the features
+ * @param vals Returns the count of each feature
+ * @param n Returns the number of features
+ * @return 1, or 0 if no profile is left
+ */
+
+int ffpProfile(FFP_COUNTER * c, char ***keys, unsigned **vals, unsigned *n)
+{
+    if (c->head == c->tail)
+	return 0;
+
+    *keys = c->keys[c->head];
+    *vals = c->vals[c->head];
+    *n = c->n[c->head++];
+    if (c->head == c->tail)
+	c->head = c->tail = 0;
+    return 1;
+}
+
+
+
+/**
+ * Frees a counter and the profiles not taken from it
+ *
+ * @param c The counter
+ * @return None
+ */
+
+void ffpCounterFree(FFP_COUNTER * c)
+{
+    char **keys;
+    unsigned *vals;
+    unsigned n;
+
+    while (ffpProfile(c, &keys, &vals, &n)) {
+	while (n--)
+	    free(keys[n]);
+	free(keys);
+	free(vals);
+    }
+    freeHash(&c->h);
+    free(c->h.s);
+    free(c->h.r);
+    free(c->keys);
+    free(c->vals);
+    free(c->n);
+    free(c->buf);
+    free(c);
+}
+
+
+
+/**
+ * Keeps the features of the hash of a counter as a profile
+ *
+ * The flush of the hash of a counter, instead of printing
+ * the features as printFeatures.  The hash is emptied for
+ * the next profile.  Without features the profile is empty,
+ * as the empty row of printFeatures.
+ *
+ * @param h The hash of a counter
+ * @return None
+ */
+
+static void keepProfile(HASH * h)
+{
+    FFP_COUNTER *c = (FFP_COUNTER *) h;
+
+    if (c->tail == c->size) {
+	c->size = c->size ? 2 * c->size : 16;
+	if ((c->keys = (char ***) realloc(c->keys,
+				sizeof(char **) * c->size)) == NULL ||
+	    (c->vals = (unsigned **) realloc(c->vals,
+				sizeof(unsigned *) * c->size)) == NULL ||
+	    (c->n = (unsigned *) realloc(c->n,
+				sizeof(unsigned) * c->size)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    c->n[c->tail] = h->keyN;
+    if (h->keyN == 0) {
+	warn_msg("Warning: No keys of length %d found.\n", h->k);
+	c->keys[c->tail] = NULL;
+	c->vals[c->tail] = NULL;
+    } else
+	hashKeysAndValues(h, &c->keys[c->tail], &c->vals[c->tail]);
+    c->tail++;
+    resetHash(h);
+    freeHash(h);
+}
+
+
+
+/**
+ * Creates an empty set of profiles
+ *
+ * The profiles added are put in columns as by ffpcol when
+ * they are first needed.
+ *
+ * @param ry Class the features, ffpcol without -d
+ * @return A new set, freed with ffpSetFree, or NULL on error
+ */
+
+FFP_SET *ffpSetNew(bool ry)
+{
+    FFP_SET *s;
+    catchErrors(NULL);
+
+    s = (FFP_SET *) chkcalloc(sizeof(FFP_SET), 1);
+    s->isClass = ry;
+    releaseErrors();
+    return s;
+}
+
+
+
+/**
+ * Adds a profile to a set as its next row
+ *
+ * The set takes the keys and their arrays, which are freed
+ * when the columns are made.  No row can be added after.
+ *
+ * @param s The set
+ * @param keys The features, as given by ffpProfile
+ * @param vals The count of each feature
+ * @param n Number of features
+ * @return The number of rows of the set, or 0 on error
+ */
+
+uint32_t ffpSetAdd(FFP_SET * s, char **keys, unsigned *vals, unsigned n)
+{
+    catchErrors(0);
+
+    if (s->p)
+	fatal_msg("Adding a profile to a set already in columns\n");
+
+    if (s->rows == s->size) {
+	s->size = s->size ? 2 * s->size : 64;
+	if ((s->keys = (char ***) realloc(s->keys,
+				sizeof(char **) * s->size)) == NULL ||
+	    (s->vals = (unsigned **) realloc(s->vals,
+				sizeof(unsigned *) * s->size)) == NULL ||
+	    (s->n = (unsigned *) realloc(s->n,
+				sizeof(unsigned) * s->size)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    s->keys[s->rows] = keys;
+    s->vals[s->rows] = vals;
+    s->n[s->rows] = n;
+    releaseErrors();
+    return ++s->rows;
+}
+
+
+
+/**
+ * Normalizes the rows of a set as ffprwn does
+ *
+ * Every value is divided by its row sum, or by the largest
+ * row sum, in single precision and rounded to the decimals
+ * of ffprwn -d, so the rows hold the values ffpjsd reads
+ * from the output of ffprwn.  With a negative precision the
+ * values are divided in double precision and not rounded.
+ *
+ * @param s The set
+ * @param largest Divide by the largest row sum, ffprwn -n
+ * @param precision Decimals of the values, ffprwn -d
+ * @return 0, or -1 on error
+ */
+
+int ffpNormalize(FFP_SET * s, bool largest, int precision)
+{
+    PROFILES *p;
+    char *str;
+    long unsigned *sum;
+    long unsigned div;
+    uint64_t e;
+    uint32_t r;
+    catchErrors(-1);
+
+    p = setColumns(s);
+    div = 0;
+    str = (char *) chkmalloc(sizeof(char), (precision < 0 ? 0 : precision) + 32);
+    sum = (long unsigned *) chkcalloc(sizeof(long unsigned), p->rows);
+
+    for (r = 0; r < p->rows; r++) {
+	for (e = p->index[r]; e < p->index[r + 1]; e++)
+	    sum[r] += (long unsigned) p->val[e];
+	if (sum[r] > div)
+	    div = sum[r];
+    }
+
+    for (r = 0; r < p->rows; r++)
+	for (e = p->index[r]; e < p->index[r + 1]; e++)
+	    if (precision < 0)
+		p->val[e] /= largest ? div : sum[r];
+	    else {
+		formatExp(str, (float) (long unsigned) p->val[e] /
+			  (largest ? div : sum[r]), precision);
+		p->val[e] = strtod(str, NULL);
+	    }
+
+    free(str);
+    free(sum);
+    releaseErrors();
+    return 0;
+}
+
+
+
+/**
+ * Gives a row of a set in columns
+ *
+ * Only the non-zero values of the row are given, in
+ * ascending column order.  They are counts until the set
+ * is normalized.  The arrays belong to the set.
+ *
+ * @param s The set
+ * @param row The row, from 0
+ * @param cols Returns the column of each value, from 0
+ * @param vals Returns the values
+ * @return Number of values, or -1 on error
+ */
+
+int64_t ffpSetRow(FFP_SET * s, uint32_t row, const uint32_t ** cols,
+		  const double **vals)
+{
+    PROFILES *p;
+    catchErrors(-1);
+
+    p = setColumns(s);
+    if (row >= p->rows)
+	fatal_msg("%u: No such row in a set of %u\n", row, p->rows);
+
+    *cols = p->col + p->index[row];
+    *vals = p->val + p->index[row];
+    releaseErrors();
+    return (int64_t) profileLength(p, row);
+}
+
+
+
+/**
+ * Calculates the Jensen Shannon divergence between all rows
+ *
+ * The distances are those of ffpjsd, before rounding.
+ *
+ * @param s The set, normalized with ffpNormalize
+ * @return The n by n distance matrix of the n rows, row by row, freed by the caller, or NULL on error
+ */
+
+double *ffpDistances(FFP_SET * s)
+{
+    PROFILES *p;
+    double *D;
+    uint32_t n, i, j;
+    catchErrors(NULL);
+
+    p = setColumns(s);
+    n = p->rows;
+    D = (double *) chkcalloc(sizeof(double), (size_t) n * n);
+
+    for (i = 0; i < n; i++)
+	for (j = i + 1; j < n; j++)
+	    D[(size_t) i * n + j] = D[(size_t) j * n + i] =
+		jsdProfile(p, i, p, j);
+    releaseErrors();
+    return D;
+}
+
+
+
+/**
+ * Frees a set
+ *
+ * @param s The set
+ * @return None
+ */
+
+void ffpSetFree(FFP_SET * s)
+{
+    uint32_t r;
+
+    if (s->p)
+	freeProfiles(s->p);
+    else
+	for (r = 0; r < s->rows; r++) {
+	    while (s->n[r]--)
+		free(s->keys[r][s->n[r]]);
+	    free(s->keys[r]);
+	    free(s->vals[r]);
+	}
+    free(s->keys);
+    free(s->vals);
+    free(s->n);
+    free(s);
+}
+
+
+
+/**
+ * Puts the rows of a set in columns as ffpcol does
+ *
+ * @param s The set
+ * @return The rows in columns
+ */
+
+static PROFILES *setColumns(FFP_SET * s)
+{
+    uint32_t r;
+
+    if (s->p)
+	return s->p;
+    if (s->rows == 0)
+	fatal_msg("No profiles in the set\n");
+
+    s->p = columnProfiles(s->keys, s->vals, s->n, s->rows, nucleotide,
+			  s->isClass);
+    for (r = 0; r < s->rows; r++) {
+	while (s->n[r]--)
+	    free(s->keys[r][s->n[r]]);
+	free(s->keys[r]);
+	free(s->vals[r]);
+    }
+    return s->p;
+}
+
+
+
+/**
+ * Builds the tree of a distance matrix as ffptree does
+ *
+ * The matrix is handed to the tree as the phylip text of
+ * ffpjsd -p, with the distances rounded to the decimals of
+ * ffpjsd -d, or kept exactly with a negative precision.
+ * The options are those of ffptree, separated by spaces,
+ * except -h and -v.  The tree goes to tree and the progress
+ * to progress, unless sent to files with -O and -P.  The
+ * trees are built in the globals of tree.c, so concurrent
+ * calls wait for each other.  The options are parsed with
+ * getopt, whose globals are restored for the caller.
+ *
+ * @param D The n by n distance matrix, row by row
+ * @param names The taxa names, up to TAXANAMELEN characters without spaces
+ * @param n Number of taxa
+ * @param precision Decimals of the distances
+ * @param options The options of ffptree, or NULL
+ * @param tree Stream of the Newick tree, or NULL to drop it
+ * @param progress Stream of the progress and readable tree, or NULL to drop them
+ * @return 0, or -1 on error
+ */
+
+int ffpTree(const double *D, char **names, uint32_t n, int precision,
+	    const char *options, FILE * tree, FILE * progress)
+{
+    jmp_buf jump, *outer = errorJump;
+    char *volatile opts = NULL;
+    char **volatile argv = NULL;
+    FILE *volatile mem = NULL;
+    FILE *volatile null = NULL;
+    volatile bool locked = false;
+    char *text = NULL;
+    char *arg = optarg;
+    int ind = optind, err = opterr, opt = optopt;
+    size_t size, len;
+    WRITER *w;
+    int argc;
+    uint32_t i, j;
+
+    if (setjmp(jump)) {
+	if (locked) {
+	    treeAbort();
+	    optarg = arg;
+	    optind = ind;
+	    opterr = err;
+	    optopt = opt;
+	    pthread_mutex_unlock(&treeLock);
+	}
+	if (null)
+	    fclose(null);
+	if (mem)
+	    fclose(mem);
+	free(text);
+	free(argv);
+	free(opts);
+	errorJump = outer;
+	return -1;
+    }
+    errorJump = &jump;
+
+    for (i = 0; i < n; i++)
+	if (strlen(names[i]) > TAXANAMELEN)
+	    fatal_msg("%s: Taxa name longer than %d\n", names[i], TAXANAMELEN);
+    if (precision < 0)
+	precision = EXACT_PRECISION;
+
+    if ((mem = open_memstream(&text, &size)) == NULL)
+	fatal_msg("%s\n", strerror(errno));
+    w = writerOpen(mem);
+    writeUlong(w, n);
+    writeChar(w, '\n');
+    for (i = 0; i < n; i++) {
+	writeString(w, names[i]);
+	for (len = strlen(names[i]); len < TAXANAMELEN; len++)
+	    writeChar(w, ' ');
+	for (j = 0; j < n; j++) {
+	    writeExp(w, D[(size_t) i * n + j], precision);
+	    writeChar(w, ' ');
+	}
+	writeChar(w, '\n');
+    }
+    writerClose(w);
+    fclose(mem);
+    if ((mem = fmemopen(text, size, "r")) == NULL)
+	fatal_msg("%s\n", strerror(errno));
+
+    if (options && (opts = strdup(options)) == NULL)
+	fatal_msg("%s\n", strerror(ENOMEM));
+    argv = splitArgs("ffptree", opts, &argc);
+
+    // the options are parsed from the start, without getopt messages
+    pthread_mutex_lock(&treeLock);
+    locked = true;
+    optind = 0;
+    opterr = 0;
+    treeOptions(argc, argv);
+    if (optind < argc)
+	fatal_msg("%s: Not an option of ffptree\n", argv[optind]);
+    if ((!tree || !progress) && (null = fopen("/dev/null", "w")) == NULL)
+	fatal_msg("/dev/null: %s\n", strerror(errno));
+    treeOutput(tree ? tree : null, progress ? progress : null);
+    treeFile(mem);
+    treeClose();
+    optarg = arg;
+    optind = ind;
+    opterr = err;
+    optopt = opt;
+    pthread_mutex_unlock(&treeLock);
+
+    if (null)
+	fclose(null);
+    fclose(mem);
+    free(text);
+    free(argv);
+    free(opts);
+    errorJump = outer;
+    return 0;
+}
+
+
+
+/**
+ * Builds the Newick tree of a distance matrix
+ *
+ * As ffpTree, returning the tree and dropping the progress.
+ *
+ * @param D The n by n distance matrix, row by row
+ * @param names The taxa names
+ * @param n Number of taxa
+ * @param precision Decimals of the distances
+ * @param options The options of ffptree, or NULL
+ * @return The Newick tree, freed by the caller, or NULL on error
+ */
+
+char *ffpNewick(const double *D, char **names, uint32_t n, int precision,
+		const char *options)
+{
+    char *text;
+    size_t size;
+    FILE *mem;
+    catchErrors(NULL);
+
+    if ((mem = open_memstream(&text, &size)) == NULL)
+	fatal_msg("%s\n", strerror(errno));
+    releaseErrors();
+    if (ffpTree(D, names, n, precision, options, mem, NULL)) {
+	fclose(mem);
+	free(text);
+	return NULL;
+    }
+    fclose(mem);
+    return text;
+}
+
+
+
+/**
+ * Gives the message of the last error of the calling thread
+ *
+ * @return The message, without a newline, or an empty string
+ */
+
+const char *ffpError(void)
+{
+    return errorText;
+}
+
+
+
+#ifdef FFP_LIBRARY
+/**
+ * Keeps the message of an error for ffpError
+ *
+ * fatal_msg of the library calls it before libraryReturn.
+ *
+ * @param fmt The format of the message
+ * @param args Its arguments
+ * @return None
+ */
+
+void libraryError(char *fmt, va_list args)
+{
+    size_t len;
+
+    vsnprintf(errorText, ERRORLEN, fmt, args);
+    len = strlen(errorText);
+    if (len > 0 && errorText[len - 1] == '\n')
+	errorText[len - 1] = '\0';
+}
+
+
+
+/**
+ * Returns from the library call that made an error
+ *
+ * The call returns its error value.  Outside a library call,
+ * as in the threads of ffptree -T, the error ends the process
+ * as in the programs.
+ *
+ * @return None when no library call is made
+ */
+
+void libraryReturn()
+{
+    if (errorJump)
+	longjmp(*errorJump, 1);
+}
+#endif
@@ -0,0 +1,24 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#include <stdio.h>
+
+/* The messages of libffp, see ffp.h, are prefixed with its name.
+ * A program built from the sources of the library names its
+ * messages itself. */
+
+char PROG_NAME[FILENAME_MAX] = "libffp";
+char usage_str[] = "%s: the C interface of the FFP programs, see ffp.h\n";
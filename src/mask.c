@@ -14,12 +14,11 @@
 * Gregory E. Sims (C) 2010-2012
 *
 *****************************************************/
+#include <stdio.h>
 #include <stdlib.h>
 #include "mask.h"
 #include "../config.h"
 
-extern char *weightVector;
-
 
 /**
  * Create a random mismatch mask
@@ -33,21 +32,22 @@ extern char *weightVector;
  * @param s a string representing the mismatch mask
  * @param n the length of the mask
  * @param mismatch the number of mismatches
+ * @param rng the random number stream choosing the positions
  * @return none
  */
 
 
-void randweight(char *s, int n, int mismatch)
+void randweight(char *s, int n, int mismatch, RNG * rng)
 {
     int i;
 
     for (i = 0; i < n; i++)
-	weightVector[i] = '1';
+	s[i] = '1';
 
     while (mismatch > 0) {
-	weightVector[rand() % n] = '0';
+	s[rngBelow(rng, n)] = '0';
 	mismatch--;
     }
 
-    weightVector[n] = '\0';
+    s[n] = '\0';
 }
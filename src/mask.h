@@ -17,7 +17,8 @@
 /* _MASK_H_ */
 #ifndef _MASK_H_
 #define _MASK_H_
+#include "utils.h"
 
-void randweight(char *s, int n, int mismatch);
+void randweight(char *s, int n, int mismatch, RNG * rng);
 
 #endif				/* _MASK_H_ */
@@ -45,7 +45,7 @@ void parseFeatureList(HASH *h, char * filename,int len,int mode) {
     	if (zflag || wflag)
 		hashAddPtr=hashAddw;
  	else
-		hashAddPtr=hashAdd;
+		hashAddPtr=hashAddNuc;
     break;
     case amino:
 	if (zflag || wflag)
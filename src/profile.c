@@ -0,0 +1,535 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#define _POSIX_C_SOURCE  200809L  // To use mmap
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+#include "profile.h"
+
+#define PROFILE_BLOCK 100000 /**< Growth increment for the non-zero entry arrays */
+
+/**
+ * Binary profile database header
+ *
+ * The header is followed by rows+1 row offsets (uint64_t),
+ * nnz column numbers (uint32_t) padded to an 8 byte boundary
+ * and nnz values (double or float).  All values are in host
+ * byte order.
+ */
+typedef struct {
+    char magic[8];	/**< PROFILE_MAGIC */
+    uint32_t rows;	/**< Number of rows */
+    uint32_t cols;	/**< Number of columns */
+    uint64_t nnz;	/**< Number of non-zero entries */
+    uint32_t valsize;	/**< Size of a value, 4 or 8 bytes */
+    uint32_t reserved;	/**< Zero */
+} PROFILE_HEADER;
+
+#define padded(n) (((n) + 7) & ~(size_t) 7) /**< Rounds n up to a multiple of 8 */
+
+
+/**
+ * Stores a non-zero entry of profiles being read
+ *
+ * @param p Profiles being read
+ * @param nnzsize Allocated number of entries, grown as needed
+ * @param c Column of the entry
+ * @param v Value of the entry
+ * @return None
+ */
+
+static void addEntry(PROFILES * p, size_t * nnzsize, uint32_t c, double v)
+{
+    uint64_t nnz = p->index[p->rows + 1];
+
+    if (p->fval ? !(float) v : !v)
+	return;
+    if (nnz >= *nnzsize) {
+	*nnzsize += PROFILE_BLOCK;
+	if ((p->col = (uint32_t *) realloc(p->col,
+			sizeof(uint32_t) * *nnzsize)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+	if (p->fval) {
+	    if ((p->fval = (float *) realloc(p->fval,
+			sizeof(float) * *nnzsize)) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
+	} else if ((p->val = (double *) realloc(p->val,
+			sizeof(double) * *nnzsize)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    p->col[nnz] = c;
+    if (p->fval)
+	p->fval[nnz] = v;
+    else
+	p->val[nnz] = v;
+    p->index[p->rows + 1]++;
+}
+
+
+
+/**
+ * Reads a columnar FFP into sparse profiles
+ *
+ * Opens a reader on fp for parseProfiles and leaves a
+ * seekable fp just after the profiles read.
+ *
+ * @param fp A file pointer to a columnar FFP
+ * @param single Store the values in single precision
+ * @return A pointer to newly allocated profiles
+ */
+
+PROFILES *readProfiles(FILE * fp, bool single)
+{
+    READER *r = readerOpen(fp);
+    PROFILES *p = parseProfiles(r, single);
+
+    readerClose(r);
+    return p;
+}
+
+
+
+/**
+ * Parses a columnar FFP into sparse profiles
+ *
+ * The format is recognized from the first line, see
+ * profile_formats.  A binary FFP is read up to its end and
+ * a sparse FFP up to the blank line after it, so the next
+ * set can be read from r afterwards.  A dense FFP is read
+ * up to the end of r and blank lines are skipped.  Every
+ * line of a dense FFP is one row, and all rows must have
+ * the same number of columns as the first one.  The
+ * values are parsed with parseDouble, so they are
+ * identical to those read by fscanf with %lf.  In single
+ * precision the values are rounded to float, which halves
+ * the size of the profiles.
+ *
+ * @param r A reader of a columnar FFP
+ * @param single Store the values in single precision
+ * @return A pointer to newly allocated profiles
+ */
+
+PROFILES *parseProfiles(READER * r, bool single)
+{
+    PROFILES *p;
+    SPAN line;
+    const char *s, *end, *next;
+    double v;
+    unsigned long c, prev, k, n;
+    size_t nnzsize = PROFILE_BLOCK;
+    size_t rowsize = 16;
+    bool sparse = false;
+
+    if (readerPeek(r) == '#') {
+	if (!readLine(r, &line))
+	    fatal_msg("Missing FFP header.\n");
+	if (line.len >= strlen(BINARY_HEADER) &&
+	    !strncmp(line.s, BINARY_HEADER, strlen(BINARY_HEADER)))
+	    return readBinaryProfiles(r, single);
+	if (line.len < strlen(SPARSE_HEADER) ||
+	    strncmp(line.s, SPARSE_HEADER, strlen(SPARSE_HEADER)))
+	    fatal_msg("Unknown FFP header: %.*s\n", (int) line.len, line.s);
+	sparse = true;
+    }
+
+    p = (PROFILES *) chkcalloc(sizeof(PROFILES), 1);
+    p->index = (uint64_t *) chkmalloc(sizeof(uint64_t), rowsize);
+    p->col = (uint32_t *) chkmalloc(sizeof(uint32_t), nnzsize);
+    if (single)
+	p->fval = (float *) chkmalloc(sizeof(float), nnzsize);
+    else
+	p->val = (double *) chkmalloc(sizeof(double), nnzsize);
+    p->index[0] = 0;
+
+    if (sparse) {
+	parseUlong(line.s + strlen(SPARSE_HEADER), line.s + line.len, &c);
+	p->cols = c;
+    }
+
+    while (readLine(r, &line)) {
+	if (p->rows + 2 > rowsize) {
+	    rowsize *= 2;
+	    if ((p->index = (uint64_t *) realloc(p->index,
+			sizeof(uint64_t) * rowsize)) == NULL)
+		fatal_msg("%s\n", strerror(ENOMEM));
+	}
+	p->index[p->rows + 1] = p->index[p->rows];
+	end = line.s + line.len;
+
+	if (sparse) {
+	    if ((s = parseUlong(line.s, end, &n)) == line.s)	// end of the set
+		break;
+	    for (k = 0, prev = 0; k < n; k++, prev = c) {
+		next = parseUlong(s, end, &c);
+		if (next == s || next == end || *next != ':' || c <= prev ||
+		    c > p->cols)
+		    fatal_msg("Row %u: Bad sparse FFP entry %lu.\n",
+			      p->rows + 1, k + 1);
+		s = next + 1;
+		if ((next = parseDouble(s, end, &v)) == s)
+		    fatal_msg("Row %u: Bad sparse FFP entry %lu.\n",
+			      p->rows + 1, k + 1);
+		s = next;
+		addEntry(p, &nnzsize, c - 1, v);
+	    }
+	} else {
+	    for (s = line.s, c = 0;; c++) {
+		if ((next = parseDouble(s, end, &v)) == s)
+		    break;
+		s = next;
+		addEntry(p, &nnzsize, c, v);
+	    }
+
+	    if (!c)		// blank line
+		continue;
+
+	    if (!p->rows)
+		p->cols = c;
+	    else if (c != p->cols)
+		fatal_msg("Row %u has %lu columns, expected %u.\n",
+			  p->rows + 1, c, p->cols);
+	}
+	p->rows++;
+    }
+
+    return p;
+}
+
+
+
+/**
+ * Reads a binary FFP
+ *
+ * Reads the profile database that follows a BINARY_HEADER
+ * line, which has already been read.  Unlike mapProfiles
+ * this works on pipes, and r is left at the end of the
+ * FFP.
+ *
+ * @param r A reader after a BINARY_HEADER line
+ * @param single Store the values in single precision
+ * @return A pointer to newly allocated profiles
+ */
+
+PROFILES *readBinaryProfiles(READER * r, bool single)
+{
+    PROFILES *p;
+    PROFILE_HEADER h;
+    char pad[8];
+    size_t padding;
+    uint64_t e;
+    void *vals;
+
+    if (readerRead(r, &h, sizeof(h)) != sizeof(h) ||
+	strncmp(h.magic, PROFILE_MAGIC, sizeof(h.magic)))
+	fatal_msg("Not a binary FFP.\n");
+    if (h.valsize != sizeof(float) && h.valsize != sizeof(double))
+	fatal_msg("Unknown value size %u.\n", h.valsize);
+
+    p = (PROFILES *) chkcalloc(sizeof(PROFILES), 1);
+    p->rows = h.rows;
+    p->cols = h.cols;
+    p->index = (uint64_t *) chkmalloc(sizeof(uint64_t), h.rows + 1);
+    p->col = (uint32_t *) chkmalloc(sizeof(uint32_t), h.nnz + 1);
+    vals = chkmalloc(h.valsize, h.nnz + 1);
+    padding = padded(sizeof(uint32_t) * h.nnz) - sizeof(uint32_t) * h.nnz;
+
+    if (readerRead(r, p->index, sizeof(uint64_t) * (h.rows + 1)) !=
+	sizeof(uint64_t) * (h.rows + 1) ||
+	readerRead(r, p->col, sizeof(uint32_t) * h.nnz) !=
+	sizeof(uint32_t) * h.nnz ||
+	readerRead(r, pad, padding) != padding ||
+	readerRead(r, vals, h.valsize * h.nnz) != h.valsize * h.nnz)
+	fatal_msg("Truncated binary FFP.\n");
+
+    if (single == (h.valsize == sizeof(float))) {
+	if (single)
+	    p->fval = (float *) vals;
+	else
+	    p->val = (double *) vals;
+    } else if (single) {
+	p->fval = (float *) chkmalloc(sizeof(float), h.nnz + 1);
+	for (e = 0; e < h.nnz; e++)
+	    p->fval[e] = ((double *) vals)[e];
+	free(vals);
+    } else {
+	p->val = (double *) chkmalloc(sizeof(double), h.nnz + 1);
+	for (e = 0; e < h.nnz; e++)
+	    p->val[e] = ((float *) vals)[e];
+	free(vals);
+    }
+    return p;
+}
+
+
+
+/**
+ * Finds the format of a columnar FFP
+ *
+ * The first line is read and fp is returned to where it
+ * was, so fp must be seekable.
+ *
+ * @param fp A file pointer to a columnar FFP
+ * @return A profile_formats value
+ */
+
+int profileFormat(FILE * fp)
+{
+    char head[sizeof(SPARSE_HEADER)];
+    long pos = ftell(fp);
+    int format = PROFILE_DENSE;
+
+    if (fgets(head, sizeof(head), fp)) {
+	if (!strcmp(head, SPARSE_HEADER))
+	    format = PROFILE_SPARSE;
+	else if (!strcmp(head, BINARY_HEADER))
+	    format = PROFILE_BINARY;
+    }
+    fseek(fp, pos, SEEK_SET);
+    return format;
+}
+
+
+
+/**
+ * Writes profiles as a binary database
+ *
+ * The database can later be mapped into memory with
+ * mapProfiles without any parsing.
+ *
+ * @param p Profiles to write
+ * @param fp A file pointer opened for writing
+ * @return None
+ */
+
+void writeProfiles(PROFILES * p, FILE * fp)
+{
+    PROFILE_HEADER h;
+    uint64_t nnz = p->index[p->rows];
+    char pad[8] = { 0 };
+    size_t padding = padded(sizeof(uint32_t) * nnz) - sizeof(uint32_t) * nnz;
+
+    memset(&h, 0, sizeof(h));
+    strcpy(h.magic, PROFILE_MAGIC);
+    h.rows = p->rows;
+    h.cols = p->cols;
+    h.nnz = nnz;
+    h.valsize = p->fval ? sizeof(float) : sizeof(double);
+
+    if (fwrite(&h, sizeof(h), 1, fp) != 1 ||
+	fwrite(p->index, sizeof(uint64_t), p->rows + 1, fp) != p->rows + 1 ||
+	fwrite(p->col, sizeof(uint32_t), nnz, fp) != nnz ||
+	fwrite(pad, 1, padding, fp) != padding ||
+	(p->fval ? fwrite(p->fval, sizeof(float), nnz, fp) :
+	 fwrite(p->val, sizeof(double), nnz, fp)) != nnz)
+	fatal_msg("Error writing profile database: %s\n", strerror(errno));
+}
+
+
+
+/**
+ * Prints profiles as a columnar FFP
+ *
+ * Values are printed with up to 17 significant digits, so
+ * counts are printed as integers and other values read
+ * back unchanged.
+ *
+ * @param p Profiles to print
+ * @param fp A file pointer opened for writing
+ * @param format A profile_formats value
+ * @return None
+ */
+
+void printProfiles(PROFILES * p, FILE * fp, int format)
+{
+    WRITER *w;
+    uint64_t e;
+    uint32_t r, c;
+
+    if (format == PROFILE_BINARY) {
+	fprintf(fp, "%s\n", BINARY_HEADER);
+	writeProfiles(p, fp);
+	return;
+    }
+
+    w = writerOpen(fp);
+    if (format == PROFILE_SPARSE) {
+	writeString(w, SPARSE_HEADER " ");
+	writeUlong(w, p->cols);
+	writeChar(w, '\n');
+    }
+
+    for (r = 0; r < p->rows; r++) {
+	e = p->index[r];
+	if (format == PROFILE_SPARSE) {
+	    writeUlong(w, profileLength(p, r));
+	    for (; e < p->index[r + 1]; e++) {
+		writeChar(w, '\t');
+		writeUlong(w, p->col[e] + 1);
+		writeChar(w, ':');
+		writeDouble(w, profileValue(p, e));
+	    }
+	    writeChar(w, '\n');
+	    continue;
+	}
+	for (c = 0; c < p->cols; c++) {
+	    if (e < p->index[r + 1] && p->col[e] == c)
+		writeDouble(w, profileValue(p, e++));
+	    else
+		writeChar(w, '0');
+	    writeChar(w, c + 1 < p->cols ? '\t' : '\n');
+	}
+    }
+    writerClose(w);
+}
+
+
+
+/**
+ * Maps a binary profile database into memory
+ *
+ * The returned profiles point directly into a read-only
+ * mapping of the file, so a large database is paged in
+ * on demand and shared between processes.
+ *
+ * @param fname Name of a database written by writeProfiles
+ * @return A pointer to the mapped profiles
+ */
+
+PROFILES *mapProfiles(char *fname)
+{
+    PROFILES *p;
+    PROFILE_HEADER *h;
+    struct stat st;
+    char *base;
+    size_t need;
+    int fd;
+
+    if ((fd = open(fname, O_RDONLY)) == -1)
+	fatal_msg("%s: %s\n", fname, strerror(errno));
+
+    if (fstat(fd, &st) == -1)
+	fatal_msg("%s: %s\n", fname, strerror(errno));
+
+    if (st.st_size < sizeof(PROFILE_HEADER))
+	fatal_msg("%s: Not a profile database.\n", fname);
+
+    if ((base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0))
+	== MAP_FAILED)
+	fatal_msg("%s: %s\n", fname, strerror(errno));
+    close(fd);
+
+    h = (PROFILE_HEADER *) base;
+    if (strncmp(h->magic, PROFILE_MAGIC, sizeof(h->magic)))
+	fatal_msg("%s: Not a profile database.\n", fname);
+
+    if (h->valsize != sizeof(float) && h->valsize != sizeof(double))
+	fatal_msg("%s: Unknown value size %u.\n", fname, h->valsize);
+
+    need = sizeof(PROFILE_HEADER) + sizeof(uint64_t) * (h->rows + 1)
+	+ padded(sizeof(uint32_t) * h->nnz) + (size_t) h->valsize * h->nnz;
+    if (st.st_size < need)
+	fatal_msg("%s: Truncated profile database.\n", fname);
+
+    p = (PROFILES *) chkcalloc(sizeof(PROFILES), 1);
+    p->rows = h->rows;
+    p->cols = h->cols;
+    p->index = (uint64_t *) (base + sizeof(PROFILE_HEADER));
+    p->col = (uint32_t *) (p->index + p->rows + 1);
+    if (h->valsize == sizeof(float))
+	p->fval = (float *) ((char *) p->col + padded(sizeof(uint32_t) * h->nnz));
+    else
+	p->val = (double *) ((char *) p->col + padded(sizeof(uint32_t) * h->nnz));
+    p->map = base;
+    p->mapsize = st.st_size;
+
+    return p;
+}
+
+
+
+/**
+ * Releases profiles read with readProfiles or mapProfiles
+ *
+ * @param p Profiles to release
+ * @return None
+ */
+
+void freeProfiles(PROFILES * p)
+{
+    if (p->map)
+	munmap(p->map, p->mapsize);
+    else {
+	free(p->index);
+	free(p->col);
+	free(p->val);
+	free(p->fval);
+    }
+    free(p);
+}
+
+
+
+/**
+ * Calculates the Jensen Shannon Divergence of two sparse FFP rows
+ *
+ * Only the non-zero entries of the rows are visited.  They
+ * are merged in column order and accumulated exactly as the
+ * dense calculation of ffpjsd, so the result is identical to
+ * the corresponding entry of the full matrix.
+ *
+ * @param a Profiles holding the first row
+ * @param i Row number in a
+ * @param b Profiles holding the second row
+ * @param j Row number in b
+ * @return The divergence of row i of a and row j of b
+ */
+
+double jsdProfile(PROFILES * a, uint32_t i, PROFILES * b, uint32_t j)
+{
+    uint64_t p = a->index[i], pe = a->index[i + 1];
+    uint64_t q = b->index[j], qe = b->index[j + 1];
+    double ha = 0;
+    double hb = 0;
+    double x, y, m;
+
+    while (p < pe && q < qe) {
+	if (a->col[p] < b->col[q])
+	    hb -= profileValue(a, p++);
+	else if (b->col[q] < a->col[p])
+	    hb -= profileValue(b, q++);
+	else {
+	    x = profileValue(a, p++);
+	    y = profileValue(b, q++);
+	    m = (y + x) / 2.0;
+	    ha += -x * log2(m / x);
+	    hb += -y * log2(m / y);
+	}
+    }
+    while (p < pe)
+	hb -= profileValue(a, p++);
+    while (q < qe)
+	hb -= profileValue(b, q++);
+
+    return fabs(0.5 * ha + 0.5 * hb);
+}
@@ -0,0 +1,79 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+/* _PROFILE_H_ */
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils.h"
+
+#define PROFILE_MAGIC "FFPDB02" /**< Magic string at the start of a binary profile database */
+#define SPARSE_HEADER "#sparse" /**< First line of a sparse text FFP, followed by the number of columns */
+#define BINARY_HEADER "#binary" /**< Line before each binary FFP in a stream */
+
+/**
+ * Formats of a columnar FFP
+ *
+ * A dense FFP has a line of tab separated values for each
+ * row.  A sparse FFP starts with the line "#sparse COLS"
+ * and has a line "NNZ COL:VAL ..." for each row, listing
+ * its NNZ non-zero values with their column numbers,
+ * counted from 1, in ascending order.  A binary FFP is the
+ * line "#binary" followed by a profile database, see
+ * writeProfiles.  Sets of text FFPs are separated by blank
+ * lines, sets of binary FFPs follow one another.
+ */
+enum profile_formats { PROFILE_DENSE, PROFILE_SPARSE, PROFILE_BINARY };
+
+/**
+ * A set of columnar FFP rows held in sparse form.
+ *
+ * Only the non-zero entries of each row are kept.  The entries
+ * of row r are col[index[r]] ... col[index[r+1]-1] with the
+ * matching values in val, stored in ascending column order.
+ * Single precision profiles keep their values in fval instead
+ * and leave val NULL, see profileValue.
+ * When the profiles were mapped from a database file the arrays
+ * point into the mapping and map is non-NULL.
+ */
+typedef struct {
+    uint32_t rows;	/**< Number of FFP rows */
+    uint32_t cols;	/**< Number of columns in each dense row */
+    uint64_t *index;	/**< Row offsets into col and val, rows+1 entries */
+    uint32_t *col;	/**< Column number of each non-zero entry */
+    double *val;	/**< Value of each non-zero entry */
+    float *fval;	/**< Value of each non-zero entry in single precision */
+    void *map;		/**< Start of the mmapped database, or NULL */
+    size_t mapsize;	/**< Size of the mapping in bytes */
+} PROFILES;
+
+#define profileLength(p,r) ((p)->index[(r)+1]-(p)->index[(r)]) /**< Number of non-zero entries in row r */
+#define profileValue(p,e) ((p)->fval ? (double) (p)->fval[(e)] : (p)->val[(e)]) /**< Value of non-zero entry e */
+
+/* prototypes */
+PROFILES *readProfiles(FILE * fp, bool single);
+PROFILES *parseProfiles(READER * r, bool single);
+PROFILES *readBinaryProfiles(READER * r, bool single);
+int profileFormat(FILE * fp);
+void writeProfiles(PROFILES * p, FILE * fp);
+void printProfiles(PROFILES * p, FILE * fp, int format);
+PROFILES *mapProfiles(char *fname);
+void freeProfiles(PROFILES * p);
+double jsdProfile(PROFILES * a, uint32_t i, PROFILES * b, uint32_t j);
+
+#endif				/* _PROFILE_H_ */
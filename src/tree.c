@@ -0,0 +1,1904 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use 
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative 
+* use is non-commercial in nature.  Proper attribution        
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome 
+* comparison with feature frequency profiles (FFP) and 
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+#define _POSIX_C_SOURCE  200809L  // To use open_memstream
+#include <stdio.h>
+#include <time.h>
+#include <stdlib.h>
+#include <float.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <limits.h>
+#include <regex.h>
+#include <errno.h>
+#include <pthread.h>
+#include "utils.h"
+#include "vstring.h"
+#include "sighandle.h"
+#include "dmatrix.h"
+#include "tree.h"
+#include "../config.h"
+
+#define FNMLNGTH        200  /* length of array to store a file name */
+#define NMLNGTH         50   /* number of characters in species name    */
+#define MAXNCH          60   /* must be greater than or equal to NMLNGTH */
+#define MAX_COL_NEWICK 55    /* Maximum characters output per line in outtree */
+                             /* The last line seems to ignore this limit */
+#define SMALL_TREE_TH 10     /* Threshold for drawing tree with -- vs - or "  " vs " " */
+#define MAX_COL_TREE 55      /* Maximum number of chracters per line for screen */
+#define TREE_SCALE 0.43429448222   // Float width for Newick tree 
+#define NON_ZERO 0.000000001 /* Maximum allowable difference between upper and 
+                                lower triangle to allow for matrix symmetricity */
+#define DOWN            2       /* For drawing trees: vertical distance between branches */
+#define OVER          60      /* maximum width all branches of tree on screen */
+#define LEFT_MARGIN 0.5       /* Margin for setting */
+#define SHORT_DASH "-"
+#define LONG_DASH "--"
+#define SHORT_SPACE " "
+#define LONG_SPACE "  "
+
+
+typedef double * DBLVECTOR;    // Move to a .h file
+typedef int * INTVECTOR;
+typedef float * FLTVECTOR;
+
+/* NODE data structure */
+
+typedef struct node {
+  struct node *next, *back;
+  int  index;
+  double xcoord, ycoord;
+  int ymin, ymax;             /* used by printree()  */
+  double v;                             
+  bool tip;
+} NODE;
+
+typedef NODE **pointarray;
+
+/* TREE data structure */
+
+typedef struct tree {
+
+  /* An array of pointers to nodes. Each tip node and ring of nodes has a
+   * unique index starting from one. The nodep array contains pointers to each
+   * one, starting from 0. In the case of internal nodes, the entries in nodep
+   * point to the rootward node in the group. Since the trees are otherwise
+   * entirely symmetrical, except at the root, this is the only way to resolve
+   * parent, child, and sibling relationships.
+   *
+   * Indices in range [0, txn) point to tips, while indices [txn, nonodes)
+   * point to internal nodes
+   */
+  NODE ** nodep;
+  NODE  * root;   // For rooted trees.  Points to internal node w/o back ptr.                 
+  NODE  * start;  // For unrooted trees.  Points to outgroup node.                  
+
+} TREE;
+
+/* A UPGMA join found by upgmaChain */
+typedef struct {
+  int i, j;        // joined clusters, i is before j in taxaorder
+  double d;        // distance between the clusters
+  double h;        // join order, at least the h of the joins below
+  int seq;         // position in the order the chain found it
+} MERGE;
+
+/* One input set and the tree built from it.  The sets of an input
+ * file are read one after another into a DATASET; with -m and -T
+ * several DATASETs are joined at the same time, see setWorker. */
+typedef struct {
+  int ith;                /* number of the set in the input */
+  int threads;            /* threads joining this set, see joinPhase */
+  DBLVECTOR x;            /* packed distance matrix, see getx */
+  FLTVECTOR xf;           /* x in single precision */
+  int *slot;              /* slot of each taxon in x */
+  int *taxon;             /* taxon in each slot, -1 once joined */
+  int slots;              /* number of slots in x */
+  INTVECTOR *reps;
+  TREE curtree;
+  int *taxaorder;
+  char ** name;           /* taxa names */
+  NODE **cluster;         /* used in maketree */
+
+  /* Bounded neighbor joining, option -f.  srow[i] holds the
+   * columns of row i sorted by distance when the row was built
+   * in cycle born[i].  An entry is stale once its column is no
+   * longer active or was rebuilt after row i; srowhead[i] skips
+   * the leading stale entries. */
+  int **srow, *srowlen, *srowhead, *born;
+  int *pos;               /* position of each taxon in taxaorder */
+
+  FILE *outfile;          /* progress and readable tree of this set */
+  FILE *outtree;          /* Newick tree of this set */
+  char *outbuf, *treebuf; /* memory behind outfile and outtree, see setWorker */
+  size_t outlen, treelen;
+} DATASET;
+
+
+
+
+/* function prototypes */
+void doinit(void);
+void getinput(void);
+void describe(DATASET *, NODE *, double);
+void summarize(DATASET *);
+void jointree(DATASET *);
+void buildRow(DATASET *, int i, int cycle);
+void boundedSearch(DATASET *, double otu, double *R, double *qmin, int *mini, int *minj);
+void updateRow(DATASET *, int j, int mini, int minj, double *R);
+void compactMatrix(DATASET *);
+MERGE *upgmaChain(DATASET *);
+DATASET *newSet(void);
+void freeSet(DATASET *);
+void readSet(DATASET *);
+void maketree(DATASET *);
+int readNumTaxa( void );
+NODE ** allocTree(int nonodes);
+void chkTxnNumEq(int ith);
+void setupTree(TREE *a, int nonodes);
+void freetree(NODE **treenode, int nonodes);
+void connect(NODE *p, NODE *q);
+void inputdata(DATASET *, bool, bool, bool,bool);
+void printree(DATASET *, NODE *);
+void treeout(DATASET *, NODE *, int *,   NODE *);
+void treeoutr(DATASET *, NODE *, int *);
+void readName(DATASET *, int );
+void checkName(DATASET *, int );
+void inputbinary(DATASET *);
+double randum(INTVECTOR);
+void coordinates(NODE *, double, int *, double *,NODE *);
+void drawline(DATASET *, int i, double scale, NODE *start);
+ssize_t getline(char **lineptr, size_t *n, FILE *stream);
+void shuffle(int * a,int n,RNG * rng);
+
+extern char PROG_NAME[];   /* name and usage of the program, for -h and -v */
+extern char usage_str[];
+
+
+bool njoin  = true;       //Option -n
+bool jumble = false;      //Option -j
+unsigned seed=1;
+int outgrno = 0;          //Option -o Arg
+bool outgropt = false;    //Option -o
+bool lower = false;       //Option -l
+bool replicates = false;  //Option -s
+bool symmetrize = false;  //option -y
+bool trout = true;        //Option -w
+bool upper = false;       //option -u
+bool treeprint = true;    //option -t
+bool progress = true;     //option -p
+bool printdata = false;   //option -d
+bool mulsets = false;     //Option -m, sets are joined in parallel with -T
+int  datasets = INT_MAX;        //Option -m Arg
+bool quiet = false;
+int precision = 8;  //Option -w arg
+bool float32 = false;     //Option -z
+bool fast = false;        //Option -f
+int threads = 1;          //Option -T Arg
+
+/* The distance matrix is held as a packed triangle in x, or in
+ * xf with -z.  Each taxon occupies a slot, and slots are ordered
+ * as in taxaorder.  The distance between slots a < b is stored at
+ * triIndex(a,b) = triRow(b) + a, so each column of the upper
+ * triangle is contiguous and the pair loop of jointree walks the
+ * matrix in memory order.  Slots of joined taxa are dropped by
+ * compactMatrix.  The diagonal is not stored and reads as zero.
+ * Sums over the matrix are always accumulated in double.  The
+ * accessors work on the DATASET pointed to by ds. */
+#define triRow(b) ((size_t) (b) * ((b) - 1) / 2)
+#define triIndex(a,b) ((a) < (b) ? triRow(b) + (a) : triRow(a) + (b))
+#define getp(k) (float32 ? (double) ds->xf[k] : ds->x[k])
+#define setp(k,v) (float32 ? (ds->xf[k] = (v)) : (ds->x[k] = (v)))
+#define getx(i,j) ((i) == (j) ? 0.0 : getp(triIndex(ds->slot[i], ds->slot[j])))
+#define setx(i,j,v) setp(triIndex(ds->slot[i], ds->slot[j]), (v))
+
+
+FILE * infile;
+FILE * outfile;
+FILE * outtree;
+int txn; // Number of taxa
+char * buffer=NULL;
+
+char infilename[FNMLNGTH], outfilename[FNMLNGTH], outtreename[FNMLNGTH];
+int numnodes, datasets;
+bool binary = false;              /* input is a binary matrix */
+DMATRIX *dm = NULL;               /* current binary matrix, see readMatrix */
+DATASET *fileset = NULL;          /* set of treeFile, freed by treeAbort */
+
+
+/* Work of one step of a join cycle, shared by the threads of -T.
+ * Slots are handed out in blocks of JOIN_BLOCK; the minimum Q is
+ * reduced by its (ja, ia) slot position, so the result does not
+ * depend on which thread scanned which slot. */
+#define JOIN_BLOCK 64
+enum join_phases { JOIN_ROWS, JOIN_SCAN, JOIN_UPDATE };
+typedef struct {
+  DATASET *ds;
+  pthread_mutex_t lock;
+  int next;               // first row of the next block
+  int phase;              // a join_phases value
+  double otu;
+  double *R;
+  int mini, minj;         // pair found by JOIN_SCAN, joined by JOIN_UPDATE
+  double qmin;
+  int qja, qia;           // scan position of qmin
+} JOINWORK;
+static void joinPhase(JOINWORK *w, int phase);
+
+/* Sets joined in parallel with -m and -T.  Each thread reads the
+ * next set under lock, joins it on its own and waits for its turn
+ * to write the output, so the trees come out in input order. */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t written;
+  int nextset;            // number of the next set to read
+  int nextout;            // number of the next set to write
+  bool done;              // all sets have been read
+} SETWORK;
+static void joinSets(void);
+
+
+/* Parse the options of ffptree in argv with getopt_long, leaving
+ * optind at the first file argument.  The tree goes to stdout and
+ * the progress to stderr unless redirected with -O and -P. */
+void treeOptions(int argc, char *argv[])
+{
+    int opt;
+    int option_index = 0;
+
+    static struct option long_options[] = {
+	{"multiple", optional_argument, 0, 'm'},
+	{"upgma", no_argument, 0, 'n'},
+	{"jumble", optional_argument, 0, 'j'},
+	{"outgroup", required_argument, 0, 'o'},
+	{"lower", no_argument, 0, 'l'},
+	{"upper", no_argument, 0, 'u'},
+	{"print-tree", no_argument, 0, 't'},
+	{"progress", no_argument, 0, 'p'},
+	{"print-data", no_argument, 0, 'd'},
+	{"symmetrize", no_argument, 0, 'y'},
+	{"out", required_argument, 0, 'O'},
+	{"out-prg", required_argument, 0, 'P'},
+	{"precision", required_argument, 0, 'w'},
+	{"quiet", no_argument, 0, 'q'},
+	{"float32", no_argument, 0, 'z'},
+	{"fast", no_argument, 0, 'f'},
+	{"threads", required_argument, 0, 'T'},
+	{"help", no_argument, 0, 'h'},
+	{"version", no_argument, 0, 'v'},
+	{0, 0, 0, 0}
+    };
+
+  // defaults of the options, which toggle, when parsed again
+  njoin = true;
+  jumble = false;
+  seed = 1;
+  outgrno = 0;
+  outgropt = false;
+  lower = upper = false;
+  symmetrize = false;
+  treeprint = progress = true;
+  printdata = false;
+  mulsets = false;
+  datasets = INT_MAX;
+  precision = 8;
+  float32 = fast = false;
+  threads = 1;
+
+  outfile=stderr;
+  outtree=stdout;
+  strcpy(outfilename,"stderr");
+  strcpy(outtreename,"stdout");
+  // add option for user readable tree.
+
+  while ((opt = getopt_long(argc, argv, "m::nj::o:lutpdi:O:P:qhvw:yzfT:",
+			      long_options, &option_index)) != -1)
+	switch (opt) {
+	case 'm':
+	    mulsets=true;
+	    if (optarg)  
+	    	datasets=atoi(optarg);
+    	    break;	    
+	case 'n':
+	    njoin=!njoin; // Toggle
+    	    break;	    
+	case 'o':
+	    outgropt=!outgropt;
+	    outgrno=atoi(optarg)-1;
+    	    break;	    
+        case 'j':
+	    jumble=!jumble;
+	    if (optarg)
+		seed=(unsigned)atoi(optarg);
+	    else
+		seed=(unsigned)time(NULL) * getpid();
+	break;
+	case 'l':
+	    lower=!lower;
+    	    break;
+	case 'u':
+	    upper=!upper;
+    	    break;
+	case 't':  
+	    treeprint=!treeprint;
+    	    break;
+	//case 'w':  // could change to O
+	 //   trout=!trout;
+    	 //   break;
+	case 'd':
+	    printdata=!printdata;
+    	    break;
+	case 'p':
+	    progress=!progress;
+    	    break;
+	case 'q':
+	    progress=!progress;
+	    treeprint=!treeprint;
+	break; 
+        case 'O':
+		strcpy(outtreename,optarg);
+		if ((outtree=fopen(optarg,"w")) == NULL)
+			fatal_msg("%s: Failed to open.",optarg);	
+	break;	
+        case 'P':
+		strcpy(outfilename,optarg);
+		if ((outfile=fopen(optarg,"w")) == NULL)
+			fatal_msg("%s: Failed to open.",optarg);	
+	break;
+	case 'y':
+		symmetrize=!symmetrize;
+	break;
+	case 'w':
+		precision=atoi(optarg);
+	break;
+	case 'z':
+		float32=!float32;
+	break;
+	case 'f':
+		fast=!fast;
+	break;
+	case 'T':
+		threads=atoi(optarg);
+		if (threads < 1)
+			fatal_msg("Number of threads must be at least 1\n");
+	break;
+	case 'v':
+	    printVersion();
+	    exit(EXIT_SUCCESS);
+	    break;
+	case 'h':
+	    printUsageStr();
+	    exit(EXIT_SUCCESS);
+	    break;
+	default:
+	    printErrorUsageStr();
+	    exit(EXIT_FAILURE);
+	    break;
+	}
+
+  if (outgrno < 0 )  //must check again to make sure less than txn
+	fatal_msg("%ld: Outgroup number must be at least 1\n",outgrno);
+
+
+  if (fast && !njoin)
+	fatal_msg("Option -f only applies to neighbor joining\n");
+
+  if (fast && threads > 1 && !mulsets)
+	fatal_msg("Options -f and -T cannot be combined\n");
+
+  if (mulsets && datasets < 2) 
+	fatal_msg("%ld: Number of sets must be greater than 1\n",datasets);
+}
+
+
+
+/* Build the trees of all sets in the distance matrix input fp,
+ * either phylip text or a binary matrix of ffpjsd -x */
+void treeFile(FILE *fp)
+{
+  int c, ith;
+  DATASET *ds;
+
+  infile = fp;
+  c = getc(infile);
+  ungetc(c, infile);
+  binary = (c == DMATRIX_MAGIC[0]);
+
+  doinit(); // This reads the number of taxa.
+
+  if (mulsets && threads > 1)
+    joinSets();
+  else {
+    ds = fileset = newSet();
+    ds->threads = threads;
+    ds->outfile = outfile;
+    ds->outtree = outtree;
+    ith = 1;
+    do {
+      ds->ith = ith;
+      readSet(ds);
+      maketree(ds);
+      ith++;
+      ungetc(fgetc(infile),infile);
+    } while ( !feof(infile) && ith <= datasets );
+    freeSet(ds);
+    fileset = NULL;
+  }
+  if (dm) {
+    freeMatrix(dm);
+    dm = NULL;
+  }
+}
+
+
+
+/* Send the trees to tree and the progress to progress, unless
+ * treeOptions sent them to files with -O and -P */
+void treeOutput(FILE *tree, FILE *progress)
+{
+  if (!strcmp(outtreename,"stdout"))
+    outtree = tree;
+  if (!strcmp(outfilename,"stderr"))
+    outfile = progress;
+}
+
+
+
+/* Close the files of -O and -P once all inputs have been read.
+ * Other outputs belong to the caller and are only flushed. */
+void treeClose()
+{
+  free(buffer);
+  buffer = NULL;
+  if (strcmp(outfilename,"stderr"))
+    fclose(outfile);
+  else
+    fflush(outfile);
+  if (strcmp(outtreename,"stdout"))
+    fclose(outtree);
+  else
+    fflush(outtree);
+}
+
+
+
+/* After an error, as treeClose, without flushing the outputs of
+ * the caller, and free the set and matrix treeFile was reading */
+void treeAbort()
+{
+  free(buffer);
+  buffer = NULL;
+  if (strcmp(outfilename,"stderr") && outfile)
+    fclose(outfile);
+  if (strcmp(outtreename,"stdout") && outtree)
+    fclose(outtree);
+  strcpy(outfilename,"stderr");
+  strcpy(outtreename,"stdout");
+  if (dm) {
+    freeMatrix(dm);
+    dm = NULL;
+  }
+  if (fileset) {
+    freeSet(fileset);
+    fileset = NULL;
+  }
+}
+
+
+
+
+/* Allocate a set of txn taxa and its tree */
+DATASET *newSet()
+{
+  DATASET *ds;
+  int i;
+
+  ds = (DATASET *)chkcalloc(sizeof(DATASET),1);
+  ds->threads = 1;
+  ds->reps = (INTVECTOR *)chkcalloc(sizeof(INTVECTOR),txn);
+  ds->name = (char **)chkcalloc(sizeof(char*),txn); 
+  for (i = 0; i < txn; i++) {
+    if (replicates)
+      ds->reps[i] = (INTVECTOR)chkcalloc(sizeof(int),txn);
+    ds->name[i]=(char *)chkcalloc(sizeof(char),MAXNCH);
+  }
+	  
+  ds->taxaorder = (int *)chkcalloc(sizeof(int),txn);
+  ds->slot = (int *)chkmalloc(sizeof(int),txn);
+  ds->taxon = (int *)chkmalloc(sizeof(int),txn);
+  ds->cluster = (NODE **)chkcalloc(sizeof(NODE *),txn);
+  ds->curtree.nodep = allocTree(numnodes+1); 
+  setupTree(&ds->curtree, numnodes + 1);
+  return ds;
+}  
+
+
+void freeSet(DATASET *ds)
+{
+  int i;
+
+  for (i = 0; i < txn; i++) {
+    free(ds->reps[i]);
+    free(ds->name[i]);
+  }
+
+  free(ds->reps);
+  free(ds->name);
+  free(ds->x);
+  free(ds->xf);
+  free(ds->taxaorder);
+  free(ds->slot);
+  free(ds->taxon);
+  free(ds->cluster);
+  freetree(ds->curtree.nodep, numnodes+1); 
+  free(ds);
+}  
+
+
+void doinit()
+{
+  /* initializes variables */
+  //NODE *p;
+  txn=readNumTaxa();
+  if (progress)
+  	fprintf(outfile, "%d Taxa\n", txn);
+  numnodes = 2 * txn - 2;  // number of nodes in an unrooted bifurcating tree is always 2n-2
+  numnodes += (njoin ? 0 : 1);  // Add 1 node (for root) if the upgma method
+  //This code is unnecessary. It is deallocating memory which just got allocated.
+  //Why not just not allocate in the first place.
+  //This makes no sense....
+  //create a circular connected list
+  //p = curtree.nodep[numnodes]->next;   // Assign p the address pointed to by the Nth element next potr 
+ // curtree.nodep[numnodes]->next = curtree.nodep[numnodes]; //Make the Nth element point to itself
+ // free(p->next);                                           // Free curtree.nodep[numnodes]->next->next
+ // free(p);                                                 // Free curtree.nodep[numnodes]->next
+} 
+
+
+//nice use of recursion.
+
+/* print out information for one branch */
+void describe(DATASET *ds, NODE *p, double height)
+{
+  NODE *q;
+
+  q = p->back;
+  if (njoin)
+    fprintf(ds->outfile, "%d\t", q->index - txn);
+  else
+    fprintf(ds->outfile, "%d\t", q->index - txn);
+  if (p->tip) {
+      fprintf(ds->outfile,"%10s\t",ds->name[p->index]);	  
+  } else {
+      fprintf(ds->outfile, "%10d\t", p->index - txn);
+  }
+  if (njoin)
+    fprintf(ds->outfile, "%.4e\n", q->v);
+  else
+    fprintf(ds->outfile, "%6.4e\t%6.4e\n", q->v, q->v+height);
+  if (!p->tip) {
+    describe(ds, p->next->back, height+q->v);
+    describe(ds, p->next->next->back, height+q->v);
+  }
+}  
+
+
+/* print out branch lengths etc. */
+void summarize(DATASET *ds)
+{
+  putc('\n', ds->outfile);
+  if (njoin) {
+    if (outgropt)
+      fprintf(ds->outfile, "Rearranged with outgroup at root.\n");
+    fprintf(ds->outfile, "Neighbor joining is an unrooted method.\n");
+  }
+
+  fprintf(ds->outfile, "\n\tNodes\n");
+  fprintf(ds->outfile, "------------------\n");
+  if (njoin) {
+    fprintf(ds->outfile, "i\t\t j\tLength\n");
+    fprintf(ds->outfile, "-----------------------------------\n");
+  } else {
+    fprintf(ds->outfile, "i\t\tj\tLength\t\tRoot_Length\n");
+    fprintf(ds->outfile, "--------------------------------------------------\n");
+  }
+  describe(ds, ds->curtree.start->next->back, 0.0);
+  describe(ds, ds->curtree.start->next->next->back, 0.0);
+  if (njoin)
+    describe(ds, ds->curtree.start->back, 0.0);
+  fprintf(ds->outfile, "\n\n");
+}  /* summarize */
+
+
+
+#define printNodeLabel(a) fputc( (a) ? 'N':'T',ds->outfile)  
+
+  /* calculate the tree */
+void jointree(DATASET *ds)
+{
+  int c, nextnode, mini=0, minj=0, i, j, a, b, ii, jj, nude, cycles;
+  double otu, q, qmin, dio, djo, bi, bj, bk, dmin=0, d;
+  size_t k;
+  int el[3];
+  DBLVECTOR av;
+  INTVECTOR oc;
+  JOINWORK work;
+  MERGE *merge = NULL;
+
+  double *R;   
+  R = (double *)chkmalloc(sizeof(double),txn);
+
+ if (progress) { 
+ 	fprintf(ds->outfile,"Cycle\tType\ti\tLength\t        Type\tj\tLength\n");
+ }	fprintf(ds->outfile,"----------------------------------------------------------------\n");
+
+  // First initialization 
+  otu = txn - 2.0;
+  nextnode = txn;
+  av = (DBLVECTOR)chkmalloc(sizeof(double),txn);
+  oc = (INTVECTOR)chkmalloc(sizeof(int),txn);
+
+  for (i = 0; i < txn; i++) {
+    av[i] = 0.0;
+    oc[i] = 1;
+  }
+
+  if (fast) {
+    ds->srow = (int **)chkcalloc(sizeof(int *),txn);
+    ds->srowlen = (int *)chkcalloc(sizeof(int),txn);
+    ds->srowhead = (int *)chkcalloc(sizeof(int),txn);
+    ds->born = (int *)chkcalloc(sizeof(int),txn);
+    ds->pos = (int *)chkmalloc(sizeof(int),txn);
+    for (i = 0; i < txn; i++)
+      ds->pos[ds->taxaorder[i]] = i;
+  }
+
+  // UPGMA joins are all found up front, then replayed below
+  if (!njoin)
+    merge = upgmaChain(ds);
+
+  // Enter the main cycle 
+  if (njoin)
+    cycles = txn - 3;
+  else
+    cycles = txn - 1;
+  work.ds = ds;
+  work.R = R;
+  pthread_mutex_init(&work.lock, NULL);
+
+  for (c = 0; c < cycles; c++) {
+    if (fast && !c)
+      for (i = 0; i < txn; i++)
+        buildRow(ds, i, 0);
+    qmin = DBL_MAX;
+
+  // Compute Row sum of observable taxonomic units (otu)
+  // If group has been joined use the aggregate cluster.
+
+    if (njoin && ds->threads > 1)
+      joinPhase(&work, JOIN_ROWS);
+    else if (njoin && !(fast && c)) {     
+      for (i = 0; i < txn; i++)
+        R[i] = 0.0;
+
+      for (b = 1; b < ds->slots; b++) {
+        jj = ds->taxon[b];
+        if (jj < 0)
+          continue;
+        k = triRow(b);
+        for (a = 0; a < b; a++) {
+          ii = ds->taxon[a];
+          if (ii >= 0) {
+            d = getp(k + a);
+            R[ii] += d;
+            R[jj] += d;
+          }
+        }
+      }
+    }
+
+    // Compute Q matrix
+    if (!njoin) {
+      mini = merge[c].i;
+      minj = merge[c].j;
+      dmin = merge[c].d;
+    } else if (fast)
+      boundedSearch(ds, otu, R, &qmin, &mini, &minj);
+    else if (ds->threads > 1) {
+      work.otu = otu;
+      joinPhase(&work, JOIN_SCAN);
+      qmin = work.qmin;
+      mini = work.mini;
+      minj = work.minj;
+    } else
+      for (b = 1; b < ds->slots; b++) {
+        jj = ds->taxon[b];
+        if (jj < 0)
+          continue;
+        k = triRow(b);
+        for (a = 0; a < b; a++) {
+          ii = ds->taxon[a];
+          if (ii >= 0) {
+            q = otu * getp(k + a) - R[ii] - R[jj];
+            if (q < qmin) {
+              qmin = q;
+              mini = ii;
+              minj = jj;
+            }
+          }
+        }
+      }
+    
+    // compute lengths and print 
+    if (njoin) {
+      dio = 0.0;
+      djo = 0.0;
+      for (i = 0; i < txn; i++)
+        if (ds->cluster[i] != NULL) {
+          dio += getx(i, mini);
+          djo += getx(i, minj);
+        }
+      dmin = getx(mini, minj);
+      dio = (dio - dmin) / otu;
+      djo = (djo - dmin) / otu;
+      bi = (dmin + dio - djo) * 0.5;
+      bj = dmin - bi;
+      bi -= av[mini];
+      bj -= av[minj];
+    } else {
+      bi = dmin / 2.0 - av[mini];
+      bj = dmin / 2.0 - av[minj];
+      av[mini] += bi;
+    }
+    if (progress) {
+      fprintf(ds->outfile,"%d\t", cycles - c );
+      if (njoin)
+        printNodeLabel(av[mini] > 0.0 );
+      else
+        printNodeLabel(oc[mini] > 1.0);
+      fprintf(ds->outfile,"\t%d\t%.2e\t", mini+1, bi);
+      if (njoin)
+        printNodeLabel(av[minj] > 0.0);
+      else
+        printNodeLabel(oc[minj] > 1.0);
+      fprintf(ds->outfile,"\t%d\t%.2e\n", minj+1, bj);
+    }
+    connect(ds->curtree.nodep[nextnode]->next, ds->cluster[mini]);
+    connect(ds->curtree.nodep[nextnode]->next->next, ds->cluster[minj]);
+    ds->cluster[mini]->v = bi;
+    ds->cluster[minj]->v = bj;
+    ds->cluster[mini]->back->v = bi;
+    ds->cluster[minj]->back->v = bj;
+    ds->cluster[mini] = ds->curtree.nodep[nextnode];
+    ds->cluster[minj] = NULL;
+    nextnode++;
+    oc[mini] += oc[minj];
+    if (!njoin)
+      continue;
+    av[mini] = dmin * 0.5;
+    ds->taxon[ds->slot[minj]] = -1;
+    
+    // re-initialization 
+    otu -= 1.0;
+    if (ds->threads > 1) {
+      work.mini = mini;
+      work.minj = minj;
+      joinPhase(&work, JOIN_UPDATE);
+    } else
+      for (j = 0; j < txn; j++)
+        updateRow(ds, j, mini, minj, R);
+    if (fast) {
+      R[mini] = 0.0;
+      for (j = 0; j < txn; j++)
+        if (ds->cluster[j] != NULL)
+          R[mini] += getx(mini, j);
+      free(ds->srow[minj]);
+      ds->srow[minj] = NULL;
+      buildRow(ds, mini, c + 1);
+    }
+    // compacting once a quarter of the slots are free keeps
+    // its cost a fraction of that of the scans in between
+    if (4 * (ds->slots - (txn - c - 1)) > ds->slots)
+      compactMatrix(ds);
+  }
+  // Final cycle 
+  nude = 0;
+  for (i = 0; i < txn; i++) {
+    if (ds->cluster[i] != NULL) {
+      el[nude] = i; 
+      nude++;
+    }
+  }
+  pthread_mutex_destroy(&work.lock);
+  if (!njoin) {
+    ds->curtree.start = ds->cluster[el[0]];
+    ds->curtree.start->back = NULL;
+    free(av);
+    free(oc);
+    free(R);
+    free(merge);
+    return;
+  }
+  bi = (getx(el[0], el[1]) + getx(el[0], el[2]) - getx(el[1], el[2])) * 0.5;
+  bj = getx(el[0], el[1]) - bi;
+  bk = getx(el[0], el[2]) - bi;
+  bi -= av[el[0]];
+  bj -= av[el[1]];
+  bk -= av[el[2]];
+  if (progress) {
+    fprintf(ds->outfile,"0\t");
+    printNodeLabel(av[el[0]] > 0.0);
+    fprintf(ds->outfile,"\t%d\t%.2e\t", el[0]+1, bi);
+    printNodeLabel(av[el[1]] > 0.0);
+    fprintf(ds->outfile,"\t%d\t%.2e\t", el[1]+1, bj);
+    printNodeLabel(av[el[2]] > 0.0);
+    fprintf(ds->outfile,"\t%d\t%.2e\n", el[2]+1, bk);
+  }
+  connect(ds->curtree.nodep[nextnode], ds->cluster[el[0]]);
+  connect(ds->curtree.nodep[nextnode]->next, ds->cluster[el[1]]);
+  connect(ds->curtree.nodep[nextnode]->next->next, ds->cluster[el[2]]);
+  ds->cluster[el[0]]->v = bi;
+  ds->cluster[el[1]]->v = bj;
+  ds->cluster[el[2]]->v = bk;
+  ds->cluster[el[0]]->back->v = bi;
+  ds->cluster[el[1]]->back->v = bj;
+  ds->cluster[el[2]]->back->v = bk;
+  ds->curtree.start = ds->cluster[el[0]]->back;
+  free(av);
+  free(oc);
+  free(R);
+  if (fast) {
+    for (i = 0; i < txn; i++)
+      free(ds->srow[i]);
+    free(ds->srow);
+    free(ds->srowlen);
+    free(ds->srowhead);
+    free(ds->born);
+    free(ds->pos);
+  }
+}  
+
+
+
+/* Set the distance of taxon j to the new node at mini.  Only
+ * the entry of j is touched, so the taxa can be updated in any
+ * order.  The slot of minj is left for compactMatrix. */
+void updateRow(DATASET *ds, int j, int mini, int minj, double *R)
+{
+  double da;
+
+  if (ds->cluster[j] == NULL || j == mini)
+    return;
+  da = (getx(mini, j) + getx(minj, j)) * 0.5;
+  if (fast)
+    R[j] += da - getx(mini, j) - getx(minj, j);
+  setx(mini, j, da);
+}
+
+
+
+/* Drop the slots of joined taxa from the packed matrix, keeping
+ * the order of the remaining slots.  Entries only move towards
+ * the start of x, so the matrix is compacted in place and its
+ * allocation shrunk afterwards. */
+void compactMatrix(DATASET *ds)
+{
+  int a, b, n = 0;
+  size_t k, to = 0;
+
+  for (b = 1; b < ds->slots; b++) {
+    if (ds->taxon[b] < 0)
+      continue;
+    k = triRow(b);
+    for (a = 0; a < b; a++)
+      if (ds->taxon[a] >= 0) {
+        if (float32)
+          ds->xf[to++] = ds->xf[k + a];
+        else
+          ds->x[to++] = ds->x[k + a];
+      }
+  }
+  for (b = 0; b < ds->slots; b++)
+    if (ds->taxon[b] >= 0) {
+      ds->taxon[n] = ds->taxon[b];
+      ds->slot[ds->taxon[n]] = n;
+      n++;
+    }
+  ds->slots = n;
+
+  if (float32) {
+    if ((ds->xf = (FLTVECTOR)realloc(ds->xf, sizeof(float) * (triRow(n) + 1))) == NULL)
+      fatal_msg("%s\n", strerror(ENOMEM));
+  } else if ((ds->x = (DBLVECTOR)realloc(ds->x, sizeof(double) * (triRow(n) + 1))) == NULL)
+    fatal_msg("%s\n", strerror(ENOMEM));
+}
+
+
+
+static int cmpMerge(const void *a, const void *b)
+{
+  const MERGE *p = a, *q = b;
+
+  if (p->h != q->h)
+    return (p->h < q->h) ? -1 : 1;
+  return p->seq - q->seq;
+}
+
+
+
+/* Find the UPGMA joins with the nearest neighbor chain.  Average
+ * linkage is reducible, so joining mutual nearest neighbors as the
+ * chain finds them gives the same tree as always joining the
+ * closest pair, in O(n^2) rather than O(n^3) time.  The joins are
+ * returned sorted by distance, the order in which the closest
+ * pair search finds them, and never before the joins below them.
+ * Each cluster is kept under the taxon first in taxaorder, as
+ * jointree does.  The distances are averaged in the order the
+ * chain joins the clusters, so a join distance can differ in its
+ * last bits from that of the closest pair search: the tree is the
+ * same, but the distances to the root in the node table can
+ * differ in their last printed digit. */
+MERGE *upgmaChain(DATASET *ds)
+{
+  MERGE *merge;
+  int *chain, *size;
+  double *h, d, dmin;
+  int n = 0, top = 0, a, b, j, k, sa, mini, minj;
+
+  merge = (MERGE *)chkmalloc(sizeof(MERGE),txn);
+  chain = (int *)chkmalloc(sizeof(int),txn);
+  size = (int *)chkmalloc(sizeof(int),txn);
+  h = (double *)chkcalloc(sizeof(double),txn);
+  for (j = 0; j < txn; j++)
+    size[j] = 1;
+
+  while (n < txn - 1) {
+    if (!top) {
+      for (k = 0; ds->taxon[k] < 0; k++)
+        ;
+      chain[top++] = ds->taxon[k];
+    }
+
+    // nearest neighbor of a, the previous link wins ties so the
+    // chain cannot cycle
+    a = chain[top - 1];
+    sa = ds->slot[a];
+    b = (top > 1) ? chain[top - 2] : -1;
+    dmin = (b >= 0) ? getx(a, b) : DBL_MAX;
+    for (k = 0; k < ds->slots; k++)
+      if (ds->taxon[k] >= 0 && k != sa) {
+        d = getp(triIndex(sa, k));
+        if (d < dmin) {
+          dmin = d;
+          b = ds->taxon[k];
+        }
+      }
+
+    if (top == 1 || b != chain[top - 2]) {
+      chain[top++] = b;
+      continue;
+    }
+
+    top -= 2;
+    if (ds->slot[a] < ds->slot[b])
+      mini = a, minj = b;
+    else
+      mini = b, minj = a;
+    merge[n].i = mini;
+    merge[n].j = minj;
+    merge[n].d = dmin;
+    merge[n].h = dmin;
+    if (h[mini] > merge[n].h)
+      merge[n].h = h[mini];
+    if (h[minj] > merge[n].h)
+      merge[n].h = h[minj];
+    merge[n].seq = n;
+    h[mini] = merge[n].h;
+    n++;
+
+    for (k = 0; k < ds->slots; k++) {
+      j = ds->taxon[k];
+      if (j >= 0 && j != mini && j != minj) {
+        d = getx(mini, j) * size[mini] + getx(minj, j) * size[minj];
+        d /= size[mini] + size[minj];
+        setx(mini, j, d);
+      }
+    }
+    size[mini] += size[minj];
+    ds->taxon[ds->slot[minj]] = -1;
+    if (4 * (ds->slots - (txn - n)) > ds->slots)
+      compactMatrix(ds);
+  }
+
+  qsort(merge, n, sizeof(MERGE), cmpMerge);
+  free(chain);
+  free(size);
+  free(h);
+  return merge;
+}
+
+
+
+/* Work through blocks of slots, or of taxa for JOIN_UPDATE, for
+ * one phase of a join cycle.  JOIN_ROWS sums the distances of
+ * slot k in slot order, which is the order the single threaded
+ * pair loop adds them in.  JOIN_SCAN finds the minimum Q of whole
+ * columns of the pair loop, JOIN_UPDATE calls updateRow. */
+static void *joinWorker(void *arg)
+{
+  JOINWORK *w = (JOINWORK *) arg;
+  DATASET *ds = w->ds;
+  int start, end, rows, k, ia, ii, jj;
+  int qja = -1, qia = -1;
+  double q, qmin = DBL_MAX;
+  size_t base;
+
+  rows = (w->phase == JOIN_UPDATE) ? txn : ds->slots;
+  for (;;) {
+    pthread_mutex_lock(&w->lock);
+    start = w->next;
+    w->next += JOIN_BLOCK;
+    pthread_mutex_unlock(&w->lock);
+    if (start >= rows)
+      break;
+    end = (start + JOIN_BLOCK < rows) ? start + JOIN_BLOCK : rows;
+
+    for (k = start; k < end; k++)
+      switch (w->phase) {
+      case JOIN_ROWS:
+        jj = ds->taxon[k];
+        if (jj < 0)
+          break;
+        w->R[jj] = 0.0;
+        for (ia = 0; ia < ds->slots; ia++)
+          if (ia != k && ds->taxon[ia] >= 0)
+            w->R[jj] += getp(triIndex(ia, k));
+        break;
+      case JOIN_SCAN:
+        jj = ds->taxon[k];
+        if (jj < 0)
+          break;
+        base = triRow(k);
+        for (ia = 0; ia < k; ia++) {
+          ii = ds->taxon[ia];
+          if (ii >= 0) {
+            q = w->otu * getp(base + ia) - w->R[ii] - w->R[jj];
+            if (q < qmin) {
+              qmin = q;
+              qja = k;
+              qia = ia;
+            }
+          }
+        }
+        break;
+      case JOIN_UPDATE:
+        updateRow(ds, k, w->mini, w->minj, w->R);
+        break;
+      }
+  }
+
+  if (w->phase == JOIN_SCAN && qja >= 0) {
+    pthread_mutex_lock(&w->lock);
+    if (qmin < w->qmin || (qmin == w->qmin && (qja < w->qja ||
+        (qja == w->qja && qia < w->qia)))) {
+      w->qmin = qmin;
+      w->qja = qja;
+      w->qia = qia;
+    }
+    pthread_mutex_unlock(&w->lock);
+  }
+  return NULL;
+}
+
+
+
+/* Run one phase of a join cycle on the threads of -T */
+static void joinPhase(JOINWORK *w, int phase)
+{
+  DATASET *ds = w->ds;
+  pthread_t tid[ds->threads];
+  int t;
+
+  w->phase = phase;
+  w->next = 0;
+  w->qmin = DBL_MAX;
+  w->qja = w->qia = txn;
+  for (t = 1; t < ds->threads; t++)
+    if (pthread_create(&tid[t], NULL, joinWorker, w))
+      fatal_msg("Error creating thread: %s\n", strerror(errno));
+  joinWorker(w);
+  for (t = 1; t < ds->threads; t++)
+    pthread_join(tid[t], NULL);
+
+  if (phase == JOIN_SCAN) {
+    w->mini = ds->taxon[w->qia];
+    w->minj = ds->taxon[w->qja];
+  }
+}
+
+
+
+/* Read, join and write sets until the input is exhausted.  The
+ * output of a set is collected in memory and written once all
+ * sets before it have been written. */
+static void *setWorker(void *arg)
+{
+  SETWORK *w = (SETWORK *) arg;
+  DATASET *ds = newSet();
+
+  for (;;) {
+    pthread_mutex_lock(&w->lock);
+    if (w->done) {
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+    ds->ith = w->nextset++;
+    if ((ds->outfile = open_memstream(&ds->outbuf, &ds->outlen)) == NULL ||
+        (ds->outtree = open_memstream(&ds->treebuf, &ds->treelen)) == NULL)
+      fatal_msg("%s\n", strerror(errno));
+    readSet(ds);
+    ungetc(fgetc(infile),infile);
+    w->done = feof(infile) || w->nextset > datasets;
+    pthread_mutex_unlock(&w->lock);
+
+    maketree(ds);
+    fclose(ds->outfile);
+    fclose(ds->outtree);
+
+    pthread_mutex_lock(&w->lock);
+    while (w->nextout != ds->ith)
+      pthread_cond_wait(&w->written, &w->lock);
+    fwrite(ds->outbuf, 1, ds->outlen, outfile);
+    fwrite(ds->treebuf, 1, ds->treelen, outtree);
+    w->nextout++;
+    pthread_cond_broadcast(&w->written);
+    pthread_mutex_unlock(&w->lock);
+    free(ds->outbuf);
+    free(ds->treebuf);
+  }
+
+  freeSet(ds);
+  return NULL;
+}
+
+
+
+/* Join the sets of the input on the threads of -T, one set per
+ * thread at a time */
+static void joinSets()
+{
+  SETWORK work;
+  pthread_t tid[threads];
+  int t;
+
+  pthread_mutex_init(&work.lock, NULL);
+  pthread_cond_init(&work.written, NULL);
+  work.nextset = 1;
+  work.nextout = 1;
+  work.done = false;
+  for (t = 1; t < threads; t++)
+    if (pthread_create(&tid[t], NULL, setWorker, &work))
+      fatal_msg("Error creating thread: %s\n", strerror(errno));
+  setWorker(&work);
+  for (t = 1; t < threads; t++)
+    pthread_join(tid[t], NULL);
+  pthread_cond_destroy(&work.written);
+  pthread_mutex_destroy(&work.lock);
+}
+
+
+
+/* distance and column of a sorted row entry, see buildRow */
+typedef struct {
+  double d;
+  int j;
+} ROWENTRY;
+
+static int cmpRowEntry(const void *a, const void *b)
+{
+  const ROWENTRY *p = a, *q = b;
+
+  if (p->d != q->d)
+    return (p->d < q->d) ? -1 : 1;
+  return p->j - q->j;
+}
+
+
+
+/* Sort the active columns of row i by distance.  Rows built
+ * in the first cycle only hold the columns after i, so every
+ * pair of taxa is held by exactly one row. */
+void buildRow(DATASET *ds, int i, int cycle)
+{
+  ROWENTRY *e;
+  int j, n = 0;
+
+  e = (ROWENTRY *)chkmalloc(sizeof(ROWENTRY),txn);
+  for (j = (cycle ? 0 : i + 1); j < txn; j++)
+    if (j != i && ds->cluster[j] != NULL) {
+      e[n].d = getx(i, j);
+      e[n++].j = j;
+    }
+  qsort(e, n, sizeof(ROWENTRY), cmpRowEntry);
+
+  free(ds->srow[i]);
+  ds->srow[i] = (int *)chkmalloc(sizeof(int),n + 1);
+  for (j = 0; j < n; j++)
+    ds->srow[i][j] = e[j].j;
+  ds->srowlen[i] = n;
+  ds->srowhead[i] = 0;
+  ds->born[i] = cycle;
+  free(e);
+}
+
+
+
+/* Find the pair minimizing Q as in RapidNJ.  A row is scanned
+ * in order of increasing distance until otu * d - R[i] - max(R)
+ * exceeds the best Q found, since no later entry of the row can
+ * improve on it.  Ties are broken in the taxaorder scan order of
+ * the exhaustive search. */
+void boundedSearch(DATASET *ds, double otu, double *R, double *qmin, int *mini, int *minj)
+{
+  int i, j, a, b, e;
+  double d, q, umax = -DBL_MAX;
+
+  for (i = 0; i < txn; i++)
+    if (ds->cluster[i] != NULL && R[i] > umax)
+      umax = R[i];
+
+  for (i = 0; i < txn; i++) {
+    if (ds->cluster[i] == NULL)
+      continue;
+    for (e = ds->srowhead[i]; e < ds->srowlen[i]; e++) {
+      j = ds->srow[i][e];
+      if (ds->cluster[j] == NULL || ds->born[j] > ds->born[i]) {
+        if (e == ds->srowhead[i])
+          ds->srowhead[i]++;
+        continue;
+      }
+      d = getx(i, j);
+      if (otu * d - R[i] - umax > *qmin)
+        break;
+      if (ds->pos[i] < ds->pos[j])
+        a = i, b = j;
+      else
+        a = j, b = i;
+      q = otu * d - R[a] - R[b];
+      if (q < *qmin || (q == *qmin && (ds->pos[b] < ds->pos[*minj] ||
+          (ds->pos[b] == ds->pos[*minj] && ds->pos[a] < ds->pos[*mini])))) {
+        *qmin = q;
+        *mini = a;
+        *minj = b;
+      }
+    }
+  }
+}
+
+
+ 
+
+  /* Read the next input set into ds */
+void readSet(DATASET *ds)
+{
+  RNG rng;
+  int i;
+
+  if (progress && mulsets )
+      fprintf(ds->outfile,"Data set # %d:\n",ds->ith);
+  if (ds->ith != 1)
+      chkTxnNumEq(ds->ith); // Confirm # of taxa is the same as txn
+
+  for (i = 0; i < txn; i++)
+    ds->taxaorder[i] = i;
+
+  // set i is jumbled with seed + i - 1, whichever thread reads it
+  if (jumble) {
+    rngInit(&rng, seed + ds->ith - 1);
+    shuffle(ds->taxaorder,txn,&rng);
+  }
+
+  // the slots of the packed matrix follow taxaorder
+  for (i = 0; i < txn; i++) {
+    ds->slot[ds->taxaorder[i]] = i;
+    ds->taxon[i] = ds->taxaorder[i];
+  }
+  ds->slots = txn;
+  if (float32)
+    ds->xf = (FLTVECTOR)chkmalloc(sizeof(float),triRow(txn) + 1);
+  else
+    ds->x = (DBLVECTOR)chkmalloc(sizeof(double),triRow(txn) + 1);
+
+  inputdata(ds, replicates, printdata, lower, upper);
+  if (njoin && (txn < 3)) 
+    fatal_msg("\nMust have at least 3 taxa.\n");
+  
+  if (progress)
+    fprintf(ds->outfile,"\n");
+}
+
+
+
+  /* Build the tree */
+void maketree(DATASET *ds)
+{
+  int i, col;
+
+  for (i = 0; i < txn; i++)
+    ds->cluster[i] = ds->curtree.nodep[i];
+  jointree(ds);
+  free(ds->x);
+  free(ds->xf);
+  ds->x = NULL;
+  ds->xf = NULL;
+  if (njoin)
+    ds->curtree.start = ds->curtree.nodep[outgrno]->back;
+  if (treeprint)
+  	printree(ds, ds->curtree.start);
+  if (treeprint)
+    summarize(ds);
+  if (trout) {
+    col = 0;
+    if (njoin)
+      treeout(ds, ds->curtree.start, &col, ds->curtree.start);
+    else
+      ds->curtree.root = ds->curtree.start,
+      treeoutr(ds, ds->curtree.start, &col);
+  }
+} 
+
+
+int readNumTaxa( void )
+{
+  int numTaxa;
+  char newline[2];
+  if (binary) {
+    dm = readMatrix(infile);
+    return dm->n;
+  }
+  /* read species number */
+  if (fscanf(infile, "%d%[\n\r]", &numTaxa,newline) != 2 || numTaxa <= 0) 
+	fatal_msg("Can not read the number of species in input\n");
+  return numTaxa;
+} 
+
+
+
+
+/* Allocate taxa nodes and internal nodes 
+* treenode is an array of pointers to nodes 
+* Taxa nodes are stored from 0 to txn-1 and
+* internal nodes stored from txn to nonodes-1 
+*
+* structure looks like this:
+*
+* [0] ->   Node  
+* [1]
+*   
+*  Each pointer points to a connected list of three
+*  nodes.
+*/
+
+
+
+NODE ** allocTree(int n)
+{
+  NODE ** treenode;
+  int i, j;
+  NODE *p, *q;
+
+  treenode = (NODE **)chkmalloc(sizeof(NODE *),n); 
+  for (i = 0; i < txn; i++)
+   treenode[i] = (NODE *)chkmalloc(sizeof(NODE),1);
+
+  // For each internal tree node create a circular 
+  // connected list or 'ring' of three nodes.
+  for (i = txn; i < n; i++) {
+    q = NULL;
+    for (j = 0; j < 3; j++) {
+      p = (NODE *)chkmalloc(sizeof(NODE),1);
+      p->next = q;
+      q = p;
+    }
+    p->next->next->next = p;
+    treenode[i] = p;
+  }
+return treenode;  
+} 
+
+
+
+void chkTxnNumEq(int ith)
+{
+  /* check if txn is same as the first set in other data sets */
+  int curtxn;
+  char c[3];
+
+  if (binary) {
+    freeMatrix(dm);
+    dm = readMatrix(infile);
+    curtxn = dm->n;
+  } else if (fscanf(infile, "%d%[\n]", &curtxn,c) != 2) 
+    fatal_msg("Set: %d: Unable to read taxa number.\n",ith);
+  if (curtxn != txn) 
+    fatal_msg("Set: %d: Inconsist taxa number.\n",ith);	  
+} 
+
+/* initialize a tree */
+void setupTree(TREE *a, int n)
+{
+  int i=0;
+  NODE *p;
+
+  for (i = 0; i < n; i++) {
+    a->nodep[i]->back = NULL;
+    a->nodep[i]->tip = (i < txn);
+    a->nodep[i]->index = i;
+    a->nodep[i]->v = 0.0;
+    if (i >= txn) {
+      p = a->nodep[i]->next;
+      while (p != a->nodep[i]) {
+        p->back = NULL;
+        p->tip = false;
+        p->index = i;
+        p = p->next;
+      }
+    }
+  }
+  a->start = a->nodep[0];
+  a->root = NULL;
+} 
+
+void freetree(NODE **treenode, int n)
+{
+  int i;
+  NODE *p, *q;
+
+  for (i = 0; i < txn; i++)
+    free(treenode[i]);
+  for (i = txn; i < n; i++) {
+    p = treenode[i];
+    q = p->next;
+    while(q != p) {
+        NODE * r = q;
+        q = q->next;
+        free(r);
+    }
+    free(p);
+  }
+  free(treenode);
+} 
+
+
+ /* connect two nodes */
+void connect(NODE *p, NODE *q)
+{
+  p->back = q;
+  q->back = p;
+}  
+
+
+
+  /* copy in a binary distance matrix, symmetric by construction */
+
+void inputbinary(DATASET *ds)
+{
+  int i, j;
+  size_t k = 0;
+  double v;
+
+  for (i = 0; i < txn; i++) {
+    strncpy(ds->name[i], matrixName(dm, i), NMLNGTH);
+    checkName(ds, i);
+    for (j = i + 1; j < txn; j++) {
+      v = matrixValue(dm, k++);
+      setx(i, j, v);
+    }
+  }
+}
+
+
+
+  /* read in distance matrix */
+
+void inputdata(DATASET *ds, bool replicates, bool printdata, bool lower,
+                        bool upper)
+{
+  int i=0, j=0, k=0, columns=0;
+  double v;
+  bool skipit=false, skipother=false;
+  char c[3];
+
+  if (replicates)
+    columns = 4;
+  else
+    columns = 6;
+  if (printdata) {
+    fprintf(ds->outfile, "\nName                       Distances");
+    if (replicates)
+      fprintf(ds->outfile, " (replicates)");
+    fprintf(ds->outfile, "\n----                       ---------");
+    if (replicates)
+      fprintf(ds->outfile, "-------------");
+    fprintf(ds->outfile, "\n\n");
+  }
+  if (binary)
+    inputbinary(ds);
+  else
+    for (i = 0; i < txn; i++) {
+      readName(ds, i);
+      for (j = 0; j < txn; j++) {
+        skipit = ((lower && j + 1 >= i + 1) || (upper && j + 1 <= i + 1));
+        skipother = ((lower && i + 1 >= j + 1) || (upper && i + 1 <= j + 1));
+        if (skipit)
+          continue;
+        if (fscanf(infile, "%lf%*[ ]%[\n]", &v,c) < 1)  
+          fatal_msg("The infile is of the wrong type\n");
+        if (replicates) { // decide how replicates are handled.
+          if (fscanf(infile, "%d", &ds->reps[i][j]) != 1) 
+            fatal_msg("The infile is of the wrong type\n");
+          if (skipother)
+            ds->reps[j][i] = ds->reps[i][j];
+        }
+        if (i == j) {
+          if (fabs(v) > NON_ZERO) 
+            fatal_msg("Diagonal of row %d from input matrix is not zero.", i+1);
+          continue;
+        }
+        if (float32)
+          v = (float) v;
+
+        // only one triangle is stored, the lower one is checked against it
+        if (j > i || skipother)
+          setx(i, j, v);
+        else if (symmetrize)
+          setx(i, j, (getx(i, j) + v) / 2.0);
+	else if (fabs(v - getx(i, j)) > NON_ZERO +
+		 (float32 ? FLT_EPSILON * fabs(v) : 0))
+          fatal_msg("Matrix is assymetric: (%d,%d) not equal to (%d,%d).\n",
+                    i+1, j+1, j+1, i+1);
+      }
+    }
+  if (!printdata)
+    return;
+  for (i = 0; i < txn; i++) {
+    for (j = 0; j < NMLNGTH; j++)
+      putc(ds->name[i][j], ds->outfile);
+    putc(' ', ds->outfile);
+    for (j = 0; j < txn; j++) {
+      fprintf(ds->outfile, "%10.5f", getx(i, j));
+      if (replicates)
+        fprintf(ds->outfile, " (%3d)", ds->reps[i][j]);
+      if (j % columns == 0 && j < txn) {
+        putc('\n', ds->outfile);
+        for (k = 0; k < NMLNGTH + 1; k++)
+          putc(' ', ds->outfile);
+      }
+    }
+    putc('\n', ds->outfile);
+  }
+  putc('\n', ds->outfile);
+} 
+
+
+/***********************************
+*
+* shuffle()
+* Performs a Fischer-Yates shuffle
+* Durstenfeld, Richard (July 1964). 
+* Algorithm 235: Random permutation. 
+* Communications of the ACM 7, 420.
+*
+*************************************/
+
+void shuffle(int * a,int n,RNG * rng) {
+	int k,tmp;
+	while (n > 1) {
+		n--;
+		k = rngBelow(rng, n + 1);
+		tmp=a[k];	
+		a[k]=a[n];
+		a[n]=tmp;	
+	}	
+}
+
+
+
+
+  /* prints out diagram of the tree */
+void printree(DATASET *ds, NODE *start)
+{
+  int i,tipy;
+  double scale,tipmax;
+
+  putc('\n', ds->outfile);
+  tipy = 1;
+  tipmax = 0.0;
+  coordinates(start, 0.0, &tipy, &tipmax, start);
+  scale = 1.0 / (int)(tipmax + 1.0);
+  for (i = 0; i <= (tipy - DOWN); i++)
+    drawline(ds, i, scale, start );
+  putc('\n', ds->outfile);
+}  
+
+
+
+/*UPGMA write out file with representation of final tree. */
+   
+void treeoutr(DATASET *ds, NODE *p, int *col)
+{
+  char * cptr;
+
+
+  if (p->tip) {
+    //replace spaces in name with underscores.
+    while ((cptr=strchr(ds->name[p->index],' ')) != NULL ) 
+	    *cptr='_';
+
+    fprintf(ds->outtree,"%s",ds->name[p->index]); 
+
+    (*col) += strlen(ds->name[p->index]);
+  } else {
+    putc('(', ds->outtree);
+    (*col)++;
+    treeoutr(ds, p->next->back,col);
+    putc(',', ds->outtree);
+    (*col)++;
+    if ((*col) > MAX_COL_TREE ) {
+      putc('\n', ds->outtree);
+      (*col) = 0;
+    }
+    treeoutr(ds, p->next->next->back,col);
+    putc(')', ds->outtree);
+    (*col)++;
+  }
+  if (p == ds->curtree.root)
+    fprintf(ds->outtree, ";\n");
+  else {
+    fprintf(ds->outtree, ":%.*e", precision,p->v);
+    *col += precision+5;
+  }
+} 
+
+
+/*Neighbor joining: write out rerpesentation of tree */
+void treeout(DATASET *ds, NODE *p, int *col, NODE *start)
+{
+  char * cptr;
+
+  if (p->tip) {
+    //replace spaces in name with underscores.
+    while ((cptr=strchr(ds->name[p->index],' ')) != NULL ) 
+  	    *cptr='_';
+    fprintf(ds->outtree,"%s",ds->name[p->index]);
+
+    *col += strlen(ds->name[p->index]);
+  } else {
+    putc('(', ds->outtree);
+    (*col)++;
+    treeout(ds, p->next->back, col, start);
+    putc(',', ds->outtree);
+    (*col)++;
+    if (*col > MAX_COL_NEWICK) {
+      putc('\n', ds->outtree);
+      *col = 0;
+    }
+    treeout(ds, p->next->next->back, col, start);
+    if (p == start && njoin) {
+      putc(',', ds->outtree);
+      if (*col > MAX_COL_NEWICK) {
+        putc('\n', ds->outtree);
+        *col = 0;
+      }
+      treeout(ds, p->back, col, start);
+    }
+    putc(')', ds->outtree);
+    (*col)++;
+  }
+  if (p == start)
+    fprintf(ds->outtree, ";\n");
+  else {
+    fprintf(ds->outtree, ":%.*e", precision,p->v);
+    *col += precision+5;
+  }
+}  
+
+/* read in taxa name */
+void readName(DATASET *ds, int i)
+{
+	if (!fread(ds->name[i],sizeof(char),NMLNGTH,infile)) 
+		fatal_msg("Read zero items.");
+
+	checkName(ds, i);
+} 
+
+
+/* check and trim taxa name */
+void checkName(DATASET *ds, int i)
+{
+	regex_t    re;
+	regmatch_t pm;
+	char * c;
+
+	if (regcomp(&re, "[]:;(),\n[]", 0) != 0) 
+		fatal_msg("Failed to compile regular expression");
+
+	if (regexec(&re, ds->name[i], (size_t) 1, &pm, 0) == 0 ) 
+		fatal_msg("Unexpected character: %c in taxa %s\n",ds->name[i][pm.rm_so],ds->name[i]);
+
+	//trim terminating whitespace
+	while ((c=strrchr(ds->name[i],' ')) != NULL) 
+		*c='\0';
+
+	regfree(&re);
+
+} 
+
+
+/* establishes coordinates of nodes */
+//Uses recursion
+void coordinates(NODE *p, double lengthsum, int *tipy, double *tipmax,
+                        NODE *start )
+{
+  NODE *q, *first, *last;
+
+  if (p->tip) {
+    p->xcoord = (int)(OVER * lengthsum + LEFT_MARGIN);
+    p->ycoord = *tipy;
+    p->ymin = *tipy;
+    p->ymax = *tipy;
+    (*tipy) += DOWN;
+    if (lengthsum > *tipmax)
+      *tipmax = lengthsum;
+    return;
+  }
+  q = p->next;
+  do {
+    if (q->back)
+      coordinates(q->back, lengthsum + q->v, tipy,tipmax, start);
+    q = q->next;
+  } while ((p == start || p != q) && (p != start || p->next != q));
+  first = p->next->back;
+  q = p;
+  while (q->next != p && q->next->back)  /* is this right ? */
+    q = q->next;
+  last = q->back;
+  p->xcoord = (int)(OVER * lengthsum + LEFT_MARGIN);
+  if (p == start && p->back) 
+    p->ycoord = p->next->next->back->ycoord;
+  else
+    p->ycoord = (first->ycoord + last->ycoord) / 2;
+  p->ymin = first->ymin;
+  p->ymax = last->ymax;
+}  
+
+
+
+
+  /* draws one row of the tree diagram by moving up tree */
+void drawline(DATASET *ds, int i, double scale, NODE *start)
+{
+  NODE *p, *q;
+  int n=0, j=0;
+  bool extra=false, trif=false;
+  NODE *r, *first =NULL, *last =NULL;
+  bool done=false;
+
+  p = start;
+  q = start;
+  extra = false;
+  trif = false;
+  if (i == (int)p->ycoord && p == start) {  /* display the root */
+    if (!njoin) {
+      if (p->index - txn >= SMALL_TREE_TH)
+        fprintf(ds->outfile, SHORT_DASH);
+      else
+        fprintf(ds->outfile, LONG_DASH);
+    }
+    else {
+      if (p->index - txn >= SMALL_TREE_TH)
+        fprintf(ds->outfile, SHORT_SPACE);
+      else
+        fprintf(ds->outfile, LONG_SPACE);
+    }
+    if (p->index - txn >= SMALL_TREE_TH)
+      fprintf(ds->outfile, "%2d", p->index - txn + 1);
+    else
+      fprintf(ds->outfile, "%d", p->index - txn + 1);
+    extra = true;
+    trif = true;
+  } else
+    fprintf(ds->outfile, LONG_SPACE);
+  do {
+    if (!p->tip) { /* internal nodes */
+      r = p->next;
+      /* r->back here is going to the same node. */
+      do {
+        if (!r->back) {
+          r = r->next;
+          continue;
+        }
+        if (i >= r->back->ymin && i <= r->back->ymax) {
+          q = r->back;
+          break;
+        }
+        r = r->next;
+      } while (!((p != start && r == p) || (p == start && r == p->next)));
+      first = p->next->back;
+      r = p;
+      while (r->next != p) 
+        r = r->next;
+      last = r->back;
+      if (njoin && (p == start))
+        last = p->back;
+    } /* end internal node case... */
+    /* draw the line: */
+    done = (p->tip || p == q);
+    n = (int)(scale * (q->xcoord - p->xcoord) + LEFT_MARGIN);
+    if (!q->tip) {
+      if ((n < 3) && (q->index - txn >= SMALL_TREE_TH))
+        n = 3;
+      if ((n < 2) && (q->index - txn < SMALL_TREE_TH))
+        n = 2;
+    }
+    if (extra) {
+      n--;
+      extra = false;
+    }
+    if ((int)q->ycoord == i && !done) {
+      if (p->ycoord != q->ycoord)
+        putc('+', ds->outfile);
+      if (trif) {
+        n++;
+        trif = false;
+      } 
+      if (!q->tip) {
+        for (j = 2; j < n; j++)
+          putc('-', ds->outfile);
+        if (q->index - txn >= SMALL_TREE_TH)
+          fprintf(ds->outfile, "%2d", q->index - txn + 1);
+        else
+          fprintf(ds->outfile, "-%d", q->index - txn + 1);
+        extra = true;
+      } else {
+        for (j = 1; j < n; j++)
+          putc('-', ds->outfile);
+      }
+    } else if (!p->tip) {
+      if ((int)last->ycoord > i && (int)first->ycoord < i
+           && i != (int)p->ycoord) {
+        putc('|', ds->outfile);
+        for (j = 1; j < n; j++)
+          putc(' ', ds->outfile);
+      } else {
+        for (j = 0; j < n; j++)
+          putc(' ', ds->outfile);
+        trif = false;
+      }
+    }
+    if (q != p)
+      p = q;
+  } while (!done);
+  if ((int)p->ycoord == i && p->tip) {
+    fprintf(ds->outfile,"%s",ds->name[p->index]);	  
+  }
+  putc('\n', ds->outfile);
+} 
+
+
@@ -0,0 +1,39 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+/* _TREE_H_ */
+#ifndef _TREE_H_
+#define _TREE_H_
+#include <stdio.h>
+
+/*
+ * Neighbor joining and UPGMA trees of distance matrices,
+ * as built by ffptree.  The options of ffptree are parsed
+ * with treeOptions, then treeFile builds the trees of each
+ * input and treeClose flushes the outputs, or treeAbort
+ * closes them after an error of the library.  The trees are
+ * built in the globals of tree.c, so only one can be built at
+ * a time.
+ */
+
+/* prototypes */
+void treeOptions(int argc, char *argv[]);
+void treeOutput(FILE * tree, FILE * progress);
+void treeFile(FILE * fp);
+void treeClose(void);
+void treeAbort(void);
+
+#endif				/* _TREE_H_ */
@@ -16,8 +16,8 @@
 *****************************************************/
 /* UTILS.C */
 
-#define _POSIX_C_SOURCE  200112L  // To use fdopen
-#define _XOPEN_SOURCE  600  // to use mkstemp
+#define _POSIX_C_SOURCE  200809L  // To use fdopen and fmemopen
+#define _XOPEN_SOURCE  700  // to use mkstemp
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -27,11 +27,15 @@
 #include <string.h>
 #include <stdarg.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include "utils.h"
 
 extern char PROG_NAME[];
 
+#define isBlank(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r')) /**< Separates the fields of a line */
+#define isDigit(c) ((c) >= '0' && (c) <= '9') /**< Locale independent isdigit */
+
 /**@todo Error functions placed in their own object file */
 
 char error_usage_str[] = "Usage: %s [OPTION]... [FILE]... \n\
@@ -40,14 +44,25 @@ Try `%s --help' for more information\n";
 
 void printErrorUsageStr()
 {
+#ifdef FFP_LIBRARY
+    fatal_msg("Invalid option, or an option without its argument\n");
+#endif
     fprintf(stderr, error_usage_str, PROG_NAME, PROG_NAME);
     exit(EXIT_FAILURE);
 }
 
 
+/* In the library the errors return from the library call that
+ * made them, see libffp.c, instead of ending the process */
 void fatal_msg(char *fmt, ...)
 {
     va_list args;
+#ifdef FFP_LIBRARY
+    va_start(args, fmt);
+    libraryError(fmt, args);
+    va_end(args);
+    libraryReturn();
+#endif
     fprintf(stderr, "%s: ", PROG_NAME);
     va_start(args, fmt);
     vfprintf(stderr, fmt, args);
@@ -58,6 +73,12 @@ void fatal_msg(char *fmt, ...)
 void fatal_at_line(char *fmt, ...)
 {
     va_list args;	
+#ifdef FFP_LIBRARY
+    va_start(args, fmt);
+    libraryError(fmt, args);
+    va_end(args);
+    libraryReturn();
+#endif
     fprintf(stderr,"%s: %s:%d in function \'%s\': ",
 	       PROG_NAME,__FILE__,__LINE__,__func__);
     va_start(args, fmt);
@@ -97,13 +118,13 @@ char * basename (const char *name)
 
 bool isDirectory(char * fname) {
 	struct stat input;
-	stat(fname,&input);
-	return (S_ISDIR( input.st_mode) );
+	// "-" and files that cannot be stat'ed are not directories
+	return (stat(fname,&input) == 0 && S_ISDIR( input.st_mode) );
 }
 
 
 
-/**@todo possibly place isRegularFile and convertPipeToFile in a special file utilities object file */
+/**@todo possibly place isRegularFile and rewindablePipe in a special file utilities object file */
 
 /**
  *
@@ -141,34 +162,39 @@ int dirExists(char * name)
 
 
 /**
+ * Finds how much of a pipe is kept in memory
  *
- * Test whether a file is a regular file or FIFO/pipe
- * 
- * Streams the contents of the FIFO/PIPE to a temporary
- * file.  The temp file is usually saved in /tmp. It is
- * immediately unlinked after creation so you will not
- * be able to see it in the file system.  See tempfile()
- * for specifics.  The file pointer of the
- * temporary file is returned.  
+ * The environmental variable MAX_PIPE_BUFFER gives the size
+ * in megabytes, PIPE_BUFFER_MB by default.  With 0 pipes
+ * are always copied to a temporary file.
  *
- * @param fp File pointer to be tested.
- * @return FILE*
- * @retval FILE* Pointer to temporary file structure.
+ * @return Size in bytes
+ */
+
+static size_t pipeBufferSize(void)
+{
+    char *env = getenv("MAX_PIPE_BUFFER");
+    size_t mb = env ? (size_t) strtoul(env, NULL, 10) : PIPE_BUFFER_MB;
+
+    return mb > SIZE_MAX >> 21 ? SIZE_MAX >> 1 : mb << 20;
+}
+
+
+
+/**
+ * Creates a temporary file
  *
+ * The file is made in the directory TMP, /tmp by default,
+ * and unlinked at once, so it is removed when closed.
  *
+ * @return A file pointer opened for update
  */
 
-/**@TODO Could fork and run this so file could be parsed immediately */
-
 char * tempfile=NULL;
 
-FILE *convertPipeToFile(FILE * fp)
+static FILE *spillFile(void)
 {
     FILE *tmp;
-    struct stat fattr;
-    static size_t optimal_size;
-    ssize_t nr, nw;
-    static char *buf = NULL;
     char tmpdir[FILENAME_MAX];
     int fd;
 
@@ -185,33 +211,170 @@ FILE *convertPipeToFile(FILE * fp)
 	
     sprintf(tempfile,"%s/ffp.XXXXXX",tmpdir);
 
-    //For some reason tempfile is not rewindable.
     if ((fd=mkstemp(tempfile)) == -1 )
 	fatal_msg("%s: %s\n",tempfile,strerror(errno));
 
-
     if ((tmp=fdopen(fd, "w+")) == NULL )
 	fatal_msg("%s: %s\n",tempfile,strerror(errno));
 
-    if (fstat(fd, &fattr))
-	fatal_msg("%s: %s\n",tempfile,strerror(errno));
+    unlink(tempfile);
+    free(tempfile);
+    tempfile = NULL;
+    return tmp;
+}
 
-    //Find optimal size for Disk IO 
-    optimal_size = (fattr.st_blksize >= BUFSIZ) ? fattr.st_blksize : BUFSIZ;
 
-    if ((buf = (char *) malloc(optimal_size)) == NULL)
-	fatal_at_line("%s\n",strerror(errno));
 
-    while ((nr = fread(buf, sizeof(char), optimal_size, fp)) != -1 && nr != 0)
-	if ((nw = fwrite(buf, sizeof(char), nr, tmp)) == 0 || nw == -1)
-	    fatal_msg("%s: %s\n",tempfile,strerror(errno));
+/**
+ * Copies the rest of a stream to another
+ *
+ * @param in Stream read up to its end
+ * @param out Stream written
+ * @param buf Buffer of size characters
+ * @param size Size of buf
+ * @return None
+ */
+
+static void copyStream(FILE * in, FILE * out, char *buf, size_t size)
+{
+    size_t n;
+
+    while ((n = fread(buf, sizeof(char), size, in)) != 0)
+	if (fwrite(buf, sizeof(char), n, out) != n)
+	    fatal_msg("%s\n", strerror(errno));
+    if (ferror(in))
+	fatal_msg("Read Error: %s\n", strerror(errno));
+}
+
+
+
+/**
+ *
+ * Makes a pipe rewindable
+ *
+ * The contents of the FIFO/pipe are read into a stream in
+ * memory, see pipeBufferSize.  Only a pipe that does not
+ * fit is copied to a temporary file instead, see spillFile,
+ * so the text is still one seekable stream.  The returned
+ * stream is at the start of the text, and the memory or
+ * file is released when it is closed.
+ *
+ * @param fp File pointer of a pipe
+ * @return A seekable file pointer to the text of the pipe
+ */
+
+FILE *rewindablePipe(FILE * fp)
+{
+    size_t cap = pipeBufferSize();
+    size_t len = 0, n;
+    char *buf = (char *) chkmalloc(sizeof(char), READ_BLOCK);
+    FILE *mem = NULL, *tmp;
+    int c;
+
+    if (cap && (mem = fmemopen(NULL, cap + 1, "w+")) != NULL) {
+	while (len < cap &&
+	       (n = fread(buf, sizeof(char), cap - len < READ_BLOCK ?
+			  cap - len : READ_BLOCK, fp)) != 0) {
+	    if (fwrite(buf, sizeof(char), n, mem) != n)
+		fatal_msg("%s\n", strerror(errno));
+	    len += n;
+	}
+	if (ferror(fp))
+	    fatal_msg("Read Error: %s\n", strerror(errno));
+	if (len < cap || (c = getc(fp)) == EOF) {
+	    free(buf);
+	    rewind(mem);
+	    return mem;
+	}
+	ungetc(c, fp);
+    }
 
+    tmp = spillFile();
+    if (mem) {
+	rewind(mem);
+	copyStream(mem, tmp, buf, READ_BLOCK);
+	fclose(mem);
+    }
+    copyStream(fp, tmp, buf, READ_BLOCK);
     free(buf);
     rewind(tmp);
     return tmp;
 }
 
 
+
+/**
+ *
+ * Finds the next set of rows in a columnar FFP
+ *
+ * Sets are separated by blank lines, as in the replicates
+ * written by ffpboot -n.  An input holding a single set is
+ * rewound and returned as it is.  Otherwise the rows of the
+ * next set are copied to a stream in memory, or to a
+ * temporary file if larger than pipeBufferSize, which are
+ * released when closed, and fp is left at the start of the following
+ * set.  Blank lines that are not followed by more rows do
+ * not start a new set.
+ *
+ * @param fp A seekable file pointer at the start of a set.
+ * @param more Set true if another set follows.
+ * @return A file pointer to the rows of the set.
+ *
+ */
+
+FILE *nextSet(FILE * fp, bool * more)
+{
+    FILE *tmp;
+    long start, pos, line, end = -1, next = -1;
+    bool data = false, blank = true;
+    char buf[BUFSIZ];
+    size_t n;
+    int c;
+
+    start = pos = line = ftell(fp);
+    while ((c = getc(fp)) != EOF) {
+	pos++;
+	if (c == '\n') {
+	    if (blank && data && end < 0)
+		end = line;
+	    line = pos;
+	    blank = true;
+	} else if (blank && !isspace(c)) {
+	    blank = false;
+	    if (end >= 0) {
+		next = line;
+		break;
+	    }
+	    data = true;
+	}
+    }
+
+    *more = next >= 0;
+    if (!*more && !start) {
+	rewind(fp);
+	return fp;
+    }
+
+    if (*more)
+	pos = end;
+    if ((size_t) (pos - start) >= pipeBufferSize() ||
+	(tmp = fmemopen(NULL, pos - start + 1, "w+")) == NULL)
+	tmp = spillFile();
+    fseek(fp, start, SEEK_SET);
+    while (pos > start) {
+	n = fread(buf, sizeof(char), (size_t) (pos - start) < sizeof(buf) ?
+		  (size_t) (pos - start) : sizeof(buf), fp);
+	if (!n || fwrite(buf, sizeof(char), n, tmp) != n)
+	    fatal_msg("%s\n", strerror(errno));
+	start += n;
+    }
+    if (*more)
+	fseek(fp, next, SEEK_SET);
+    rewind(tmp);
+    return tmp;
+}
+
+
 unsigned long numFeatures(int l)
 {
     if (l % 2 == 1)
@@ -530,4 +693,876 @@ void * chkmalloc(size_t size, size_t n) {
 
 
 
+/**
+ * Splits a string of options into an argument vector
+ *
+ * The options are separated by white space, so an option
+ * argument cannot hold any.  The white space of s is
+ * overwritten and the vector points into s.
+ *
+ * @param name Program name, the first argument
+ * @param s The options, or NULL
+ * @param argc Returns the number of arguments
+ * @return The arguments, terminated by NULL
+ */
+
+char **splitArgs(char *name, char *s, int *argc)
+{
+    char **argv;
+    char *c;
+    int n = 2;
+
+    for (c = s; c && *c; c++)
+	if (isspace((unsigned char) *c))
+	    n++;
+    argv = (char **) chkmalloc(sizeof(char *), n + 1);
+    argv[0] = name;
+    n = 1;
+    for (c = s; c && *c;) {
+	while (isspace((unsigned char) *c))
+	    *c++ = '\0';
+	if (*c == '\0')
+	    break;
+	argv[n++] = c;
+	while (*c && !isspace((unsigned char) *c))
+	    c++;
+    }
+    argv[n] = NULL;
+    *argc = n;
+    return argv;
+}
+
+
+
+
+/**
+ * Seeds a random number stream
+ *
+ * The four state words are drawn from splitmix64 started at
+ * seed, so streams of nearby seeds are unrelated.  A program
+ * that needs many reproducible streams, such as one for each
+ * replicate or input set, seeds each with the base seed plus
+ * its index.  The streams then do not depend on the order in
+ * which they are used, or on the number of threads using them.
+ *
+ * @param rng The stream to seed
+ * @param seed Any value, including 0
+ * @return None
+ */
+
+void rngInit(RNG * rng, uint64_t seed)
+{
+    uint64_t z;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+	z = (seed += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+
+
+/**
+ * Draws the next 64 bits of a random number stream
+ *
+ * Blackman and Vigna's xoshiro256** generator, which is
+ * much faster than rand and has a period of 2^256 - 1.
+ *
+ * @param rng A stream seeded with rngInit
+ * @return 64 random bits
+ */
+
+uint64_t rngNext(RNG * rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t x = s[1] * 5;
+    uint64_t t = s[1] << 17;
+
+    x = ((x << 7) | (x >> 57)) * 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return x;
+}
+
+
+
+/**
+ * Draws a random integer below n
+ *
+ * Uses Lemire's multiply and shift with rejection, so every
+ * value is equally likely, unlike rand() % n.
+ *
+ * @param rng A stream seeded with rngInit
+ * @param n The number of values, at least 1
+ * @return A value from 0 to n - 1
+ */
+
+uint32_t rngBelow(RNG * rng, uint32_t n)
+{
+    uint64_t m = (rngNext(rng) >> 32) * n;
+    uint32_t t;
+
+    if ((uint32_t) m < n) {
+	t = -n % n;
+	while ((uint32_t) m < t)
+	    m = (rngNext(rng) >> 32) * n;
+    }
+    return (uint32_t) (m >> 32);
+}
+
+
+
+/**
+ * Draws a random double in [0, 1)
+ *
+ * @param rng A stream seeded with rngInit
+ * @return A uniform value with 53 random bits
+ */
+
+double rngUniform(RNG * rng)
+{
+    return (rngNext(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+
+/**
+ * Opens a reader on a stream of FFP text
+ *
+ * The text is read from the current position of fp.  A
+ * regular file is mapped into memory, so its lines are
+ * split without copying, and any other stream is read in
+ * blocks of READ_BLOCK or more characters.  The reader
+ * reads ahead, so fp should not be used directly until
+ * readerClose.
+ *
+ * @param fp A file pointer opened for reading
+ * @return A newly allocated reader
+ */
+
+READER *readerOpen(FILE * fp)
+{
+    READER *r = (READER *) chkcalloc(sizeof(READER), 1);
+    struct stat fattr;
+    long pos;
+    void *map;
+
+    r->fp = fp;
+    r->offset = ftell(fp);
+
+    if (r->offset >= 0 && !fstat(fileno(fp), &fattr) &&
+	S_ISREG(fattr.st_mode) && fattr.st_size > r->offset &&
+	(map = mmap(NULL, fattr.st_size, PROT_READ, MAP_PRIVATE,
+		    fileno(fp), 0)) != MAP_FAILED) {
+	posix_madvise(map, fattr.st_size, POSIX_MADV_SEQUENTIAL);
+	pos = r->offset;
+	r->buf = (char *) map;
+	r->size = r->end = fattr.st_size;
+	r->pos = pos;
+	r->offset = 0;
+	r->mapped = r->eof = true;
+	return r;
+    }
+
+    r->size = READ_BLOCK;
+    r->buf = (char *) chkmalloc(sizeof(char), r->size);
+    return r;
+}
+
+
+
+/**
+ * Closes a reader
+ *
+ * A seekable fp is left just after the text that was
+ * read, so it can be read on from there.  fp itself is
+ * not closed.
+ *
+ * @param r A reader from readerOpen
+ * @return None
+ */
+
+void readerClose(READER * r)
+{
+    if (r->offset >= 0)
+	fseek(r->fp, r->offset + (long) r->pos, SEEK_SET);
+    if (r->mapped)
+	munmap(r->buf, r->size);
+    else
+	free(r->buf);
+    free(r);
+}
+
+
+
+/**
+ * Returns a reader to the start of its file
+ *
+ * @param r A reader of a seekable stream
+ * @return None
+ */
+
+void readerRewind(READER * r)
+{
+    r->lineno = 0;
+    if (r->mapped) {
+	r->pos = 0;
+	return;
+    }
+    if (r->offset < 0)
+	fatal_msg("Cannot rewind a pipe.\n");
+    rewind(r->fp);
+    r->pos = r->end = 0;
+    r->offset = 0;
+    r->eof = false;
+}
+
+
+
+/**
+ * Reads the next block of a stream into a reader
+ *
+ * The unread text is moved to the start of the buffer,
+ * which is doubled when full, so it always holds at
+ * least one whole line.
+ *
+ * @param r A reader
+ * @return false if nothing more could be read
+ */
+
+static bool refill(READER * r)
+{
+    size_t n;
+
+    if (r->eof)
+	return false;
+    if (r->pos) {
+	memmove(r->buf, r->buf + r->pos, r->end - r->pos);
+	r->end -= r->pos;
+	if (r->offset >= 0)
+	    r->offset += r->pos;
+	r->pos = 0;
+    }
+    if (r->end == r->size) {
+	r->size *= 2;
+	if ((r->buf = (char *) realloc(r->buf, r->size)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    if ((n = fread(r->buf + r->end, sizeof(char), r->size - r->end,
+		   r->fp)) == 0) {
+	if (ferror(r->fp))
+	    fatal_msg("Read Error: %s\n", strerror(errno));
+	r->eof = true;
+	return false;
+    }
+    r->end += n;
+    return true;
+}
+
+
+
+/**
+ * Reads the next line of text
+ *
+ * Line ends are found with memchr, which scans many
+ * characters per instruction.  The line is valid until
+ * the next call and does not hold its line terminator,
+ * \n or \r\n.  A last line without a terminator is
+ * returned as well.
+ *
+ * @param r A reader
+ * @param line Returns the line
+ * @return false at the end of the text
+ */
+
+bool readLine(READER * r, SPAN * line)
+{
+    size_t scanned = 0;
+    char *nl;
+
+    while ((nl = (char *) memchr(r->buf + r->pos + scanned, '\n',
+				 r->end - r->pos - scanned)) == NULL) {
+	scanned = r->end - r->pos;
+	if (!refill(r)) {
+	    if (r->pos == r->end)
+		return false;
+	    nl = r->buf + r->end;
+	    break;
+	}
+    }
+
+    line->s = r->buf + r->pos;
+    line->len = nl - line->s;
+    r->pos = nl - r->buf + (nl < r->buf + r->end);
+    if (line->len && line->s[line->len - 1] == '\r')
+	line->len--;
+    r->lineno++;
+    return true;
+}
+
+
+
+/**
+ * Returns the next character without reading it
+ *
+ * @param r A reader
+ * @return The character as an unsigned char, or EOF
+ */
+
+int readerPeek(READER * r)
+{
+    if (r->pos == r->end && !refill(r))
+	return EOF;
+    return (unsigned char) r->buf[r->pos];
+}
+
+
+
+/**
+ * Reads binary data
+ *
+ * @param r A reader
+ * @param dst Returns the data
+ * @param n Number of bytes to read
+ * @return Number of bytes read, less than n at the end of the data
+ */
+
+size_t readerRead(READER * r, void *dst, size_t n)
+{
+    size_t done = 0, k;
+
+    while (done < n) {
+	if (r->pos == r->end && !refill(r))
+	    break;
+	k = r->end - r->pos < n - done ? r->end - r->pos : n - done;
+	memcpy((char *) dst + done, r->buf + r->pos, k);
+	r->pos += k;
+	done += k;
+    }
+    return done;
+}
+
+
+
+/**
+ * Splits the next whitespace separated field off a line
+ *
+ * @param line The rest of a line, advanced past the field
+ * @param field Returns the field
+ * @return false if no field is left
+ */
+
+bool nextField(SPAN * line, SPAN * field)
+{
+    const char *c = line->s, *end = line->s + line->len;
+
+    while (c < end && isBlank(*c))
+	c++;
+    field->s = c;
+    while (c < end && !isBlank(*c))
+	c++;
+    field->len = c - field->s;
+    line->len = end - c;
+    line->s = c;
+    return field->len > 0;
+}
+
+
+
+/**
+ * Copies a span to a NUL terminated string
+ *
+ * @param f The span to copy
+ * @param buf A buffer grown as needed, may point to NULL
+ * @param size Allocated size of buf
+ * @return The string, *buf
+ */
+
+char *spanCopy(const SPAN * f, char **buf, size_t * size)
+{
+    if (f->len + 1 > *size) {
+	*size = 2 * (f->len + 1);
+	if ((*buf = (char *) realloc(*buf, *size)) == NULL)
+	    fatal_msg("%s\n", strerror(ENOMEM));
+    }
+    memcpy(*buf, f->s, f->len);
+    (*buf)[f->len] = '\0';
+    return *buf;
+}
+
+
+
+/**
+ * Copies a span to a string of limited size
+ *
+ * @param f The span to copy
+ * @param s Returns the first size - 1 characters of f
+ * @param size Size of s
+ * @return s
+ */
+
+char *spanToString(const SPAN * f, char *s, size_t size)
+{
+    size_t n = f->len < size ? f->len : size - 1;
+
+    memcpy(s, f->s, n);
+    s[n] = '\0';
+    return s;
+}
+
+
+
+/**
+ * Splits the next (key,value) pair off a line
+ *
+ * The key and the value are separated by whitespace, as
+ * in the lines of a (key,value) FFP.  A key without a
+ * count is a fatal error.
+ *
+ * @param line The rest of a line, advanced past the pair
+ * @param key Returns the key
+ * @param val Returns the value
+ * @return false if no pair is left
+ */
+
+bool nextPair(SPAN * line, SPAN * key, unsigned long *val)
+{
+    const char *next;
+
+    if (!nextField(line, key))
+	return false;
+    if ((next = parseUlong(line->s, line->s + line->len, val)) == line->s)
+	fatal_msg("Key %.*s has no value.\n", (int) key->len, key->s);
+    line->len -= next - line->s;
+    line->s = next;
+    return true;
+}
+
+
+
+/**
+ * Parses an unsigned integer
+ *
+ * Works like strtoul in base 10 on text that need not be
+ * NUL terminated, without the cost of locale handling.
+ * Leading whitespace is skipped and values that overflow
+ * are ULONG_MAX.
+ *
+ * @param s The text to parse
+ * @param end End of the text
+ * @param v Returns the value
+ * @return A pointer after the number, or s if there is none
+ */
+
+const char *parseUlong(const char *s, const char *end, unsigned long *v)
+{
+    const char *c = s;
+    unsigned long x = 0, d;
+
+    while (c < end && isBlank(*c))
+	c++;
+    if (c < end && *c == '+')
+	c++;
+    if (c == end || !isDigit(*c))
+	return s;
+    for (; c < end && isDigit(*c); c++) {
+	d = *c - '0';
+	x = (x > (ULONG_MAX - d) / 10) ? ULONG_MAX : 10 * x + d;
+    }
+    *v = x;
+    return c;
+}
+
+
+
+/**
+ * Parses a floating point number
+ *
+ * Works like strtod on text that need not be NUL
+ * terminated.  Decimal numbers of up to 19 significant
+ * digits whose value and power of ten are exact doubles
+ * are computed with one multiplication or division, which
+ * rounds correctly, so the value is always the one strtod
+ * returns.  Anything else, such as the 17 digit values of
+ * printProfiles, inf or hexadecimal, is copied and handed
+ * to strtod.
+ *
+ * @param s The text to parse
+ * @param end End of the text
+ * @param v Returns the value
+ * @return A pointer after the number, or s if there is none
+ */
+
+const char *parseDouble(const char *s, const char *end, double *v)
+{
+    static const double pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *start = s, *c, *t, *num;
+    uint64_t m = 0;
+    int nd = 0, e = 0, x = 0;
+    bool neg = false, digits = false, xneg;
+    char tmp[64], *str, *stop;
+    size_t len;
+
+    while (s < end && isBlank(*s))
+	s++;
+    c = num = s;
+    if (c < end && (*c == '-' || *c == '+'))
+	neg = (*c++ == '-');
+
+    for (; c < end && isDigit(*c); c++, digits = true)
+	if (m || *c != '0') {
+	    if (++nd <= 19)
+		m = 10 * m + (*c - '0');
+	    else
+		e++;
+	}
+    if (c < end && *c == '.') {
+	for (c++; c < end && isDigit(*c); c++, digits = true) {
+	    if (!m && *c == '0')
+		e--;
+	    else if (++nd <= 19) {
+		m = 10 * m + (*c - '0');
+		e--;
+	    }
+	}
+    }
+
+    if (digits && c < end && (*c == 'e' || *c == 'E')) {
+	t = c + 1;
+	xneg = (t < end && *t == '-');
+	if (t < end && (*t == '-' || *t == '+'))
+	    t++;
+	if (t < end && isDigit(*t)) {
+	    for (; t < end && isDigit(*t); t++)
+		if (x < 100000)
+		    x = 10 * x + (*t - '0');
+	    e += xneg ? -x : x;
+	    c = t;
+	}
+    }
+
+    if (digits && nd <= 19 && !(c < end && (*c == 'x' || *c == 'X'))) {
+	if (!m) {
+	    *v = neg ? -0.0 : 0.0;
+	    return c;
+	}
+	if (m <= (1ULL << 53) && e >= -22 && e <= 22) {
+	    *v = e < 0 ? (double) m / pow10[-e] : (double) m * pow10[e];
+	    if (neg)
+		*v = -*v;
+	    return c;
+	}
+    }
+
+    // let strtod handle the rest of the field
+    while (c < end && !isBlank(*c))
+	c++;
+    len = c - num;
+    str = len < sizeof(tmp) ? tmp : (char *) chkmalloc(sizeof(char), len + 1);
+    memcpy(str, num, len);
+    str[len] = '\0';
+    *v = strtod(str, &stop);
+    c = (stop == str) ? start : num + (stop - str);
+    if (str != tmp)
+	free(str);
+    return c;
+}
+
+
+
+/**
+ * Formats an unsigned integer in decimal
+ *
+ * Two digits are converted at a time with a table, which
+ * is much faster than printf.  The text is not NUL
+ * terminated.
+ *
+ * @param s Returns the digits, at most 20
+ * @param v The value
+ * @return Number of characters written
+ */
+
+size_t formatUlong(char *s, unsigned long v)
+{
+    static const char pairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930"
+	"31323334353637383940414243444546474849505152535455565758596061"
+	"6263646566676869707172737475767778798081828384858687888990919293"
+	"949596979899";
+    char t[24], *c = t + sizeof(t);
+    size_t n;
+
+    while (v >= 100) {
+	c -= 2;
+	memcpy(c, pairs + 2 * (v % 100), 2);
+	v /= 100;
+    }
+    if (v >= 10) {
+	c -= 2;
+	memcpy(c, pairs + 2 * v, 2);
+    } else
+	*--c = '0' + v;
+    n = t + sizeof(t) - c;
+    memcpy(s, c, n);
+    return n;
+}
+
+
+
+/**
+ * Formats a number as printf does with %.*e
+ *
+ * For up to 8 decimals the digits are found by scaling v
+ * with one exact power of ten, which rounds correctly.
+ * The result is the same as printf's unless the scaled
+ * value is within 1e-5 of a rounding tie, or out of the
+ * range of the exact powers of ten, and those numbers,
+ * like inf and nan, are formatted by printf itself.  The
+ * text is NUL terminated.
+ *
+ * @param s Returns the text, at least precision + 32 characters
+ * @param v The value
+ * @param precision Number of decimals
+ * @return Number of characters written, not counting the NUL
+ */
+
+size_t formatExp(char *s, double v, int precision)
+{
+    static const double pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    char *c = s;
+    char digits[16];
+    double a = fabs(v), x = 0, f;
+    unsigned long d = 0;
+    int e = 0, k, n;
+
+    if (precision < 0 || precision > 8 || !isfinite(v))
+	return sprintf(s, "%.*e", precision, v);
+
+    if (a != 0) {
+	e = (int) floor(log10(a));
+	for (n = 0; n < 3; n++) {	// a misjudged exponent is off by one
+	    k = precision - e;
+	    if (k > 22 || k < -22)
+		return sprintf(s, "%.*e", precision, v);
+	    x = k >= 0 ? a * pow10[k] : a / pow10[-k];
+	    if (x < pow10[precision])
+		e--;
+	    else if (x >= pow10[precision + 1])
+		e++;
+	    else
+		break;
+	}
+	f = x - floor(x);
+	if (n == 3 || fabs(f - 0.5) < 1e-5)
+	    return sprintf(s, "%.*e", precision, v);
+	d = (unsigned long) (x + 0.5);
+	if (d == (unsigned long) pow10[precision + 1]) {	// 9.99 to 1.00
+	    d /= 10;
+	    e++;
+	}
+    }
+
+    if (signbit(v))
+	*c++ = '-';
+    if (d)
+	formatUlong(digits, d);
+    else
+	memset(digits, '0', precision + 1);
+    *c++ = digits[0];
+    if (precision) {
+	*c++ = '.';
+	memcpy(c, digits + 1, precision);
+	c += precision;
+    }
+    *c++ = 'e';
+    *c++ = e < 0 ? '-' : '+';
+    if (e < 0)
+	e = -e;
+    if (e < 10)
+	*c++ = '0';
+    c += formatUlong(c, e);
+    *c = '\0';
+    return c - s;
+}
+
+
+
+/**
+ * Opens a writer on a stream
+ *
+ * Text is gathered in a buffer of WRITE_BLOCK characters
+ * and written to fp when the buffer is full or the writer
+ * is flushed.  fp should not be written directly before
+ * the writer is flushed or closed.
+ *
+ * @param fp A file pointer opened for writing
+ * @return A newly allocated writer
+ */
+
+WRITER *writerOpen(FILE * fp)
+{
+    WRITER *w = (WRITER *) chkmalloc(sizeof(WRITER), 1);
+
+    w->fp = fp;
+    w->buf = (char *) chkmalloc(sizeof(char), WRITE_BLOCK);
+    w->len = 0;
+    return w;
+}
+
+
+
+/**
+ * Writes the buffered text of a writer to its stream
+ *
+ * @param w A writer
+ * @return None
+ */
+
+void writerFlush(WRITER * w)
+{
+    if (w->len && fwrite(w->buf, sizeof(char), w->len, w->fp) != w->len)
+	fatal_msg("Write Error: %s\n", strerror(errno));
+    w->len = 0;
+}
+
+
+
+/**
+ * Flushes and frees a writer
+ *
+ * The stream itself is not closed.
+ *
+ * @param w A writer from writerOpen
+ * @return None
+ */
+
+void writerClose(WRITER * w)
+{
+    writerFlush(w);
+    free(w->buf);
+    free(w);
+}
+
+
+
+/**
+ * Writes characters
+ *
+ * @param w A writer
+ * @param s The characters
+ * @param n Number of characters
+ * @return None
+ */
+
+void writeBytes(WRITER * w, const char *s, size_t n)
+{
+    size_t k;
+
+    while (n) {
+	if (w->len == WRITE_BLOCK)
+	    writerFlush(w);
+	k = WRITE_BLOCK - w->len < n ? WRITE_BLOCK - w->len : n;
+	memcpy(w->buf + w->len, s, k);
+	w->len += k;
+	s += k;
+	n -= k;
+    }
+}
+
+
+
+/**
+ * Writes a string
+ *
+ * @param w A writer
+ * @param s A NUL terminated string
+ * @return None
+ */
+
+void writeString(WRITER * w, const char *s)
+{
+    writeBytes(w, s, strlen(s));
+}
+
+
+
+/**
+ * Writes an unsigned integer as %lu does
+ *
+ * @param w A writer
+ * @param v The value
+ * @return None
+ */
+
+void writeUlong(WRITER * w, unsigned long v)
+{
+    if (WRITE_BLOCK - w->len < 24)
+	writerFlush(w);
+    w->len += formatUlong(w->buf + w->len, v);
+}
+
+
+
+/**
+ * Writes a number as %.*e does, see formatExp
+ *
+ * @param w A writer
+ * @param v The value
+ * @param precision Number of decimals
+ * @return None
+ */
+
+void writeExp(WRITER * w, double v, int precision)
+{
+    char *s;
+
+    if (precision + 32 > WRITE_BLOCK / 2) {
+	s = (char *) chkmalloc(sizeof(char), precision + 32);
+	writeBytes(w, s, formatExp(s, v, precision));
+	free(s);
+	return;
+    }
+    if (WRITE_BLOCK - w->len < (size_t) precision + 32)
+	writerFlush(w);
+    w->len += formatExp(w->buf + w->len, v, precision);
+}
+
+
+
+/**
+ * Writes a number as %.17g does, which reads back exactly
+ *
+ * Whole numbers, such as counts, are written as integers
+ * without going through printf.
+ *
+ * @param w A writer
+ * @param v The value
+ * @return None
+ */
+
+void writeDouble(WRITER * w, double v)
+{
+    if (WRITE_BLOCK - w->len < 32)
+	writerFlush(w);
+    if (v >= 0 && v < 1e9 && !signbit(v) && v == (double) (unsigned long) v)
+	w->len += formatUlong(w->buf + w->len, (unsigned long) v);
+    else
+	w->len += sprintf(w->buf + w->len, "%.17g", v);
+}
+
+
+
 /* UTILS.C */
@@ -18,6 +18,61 @@
 #ifndef _UTILS_H_
 #define _UTILS_H_
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/**
+ * State of a random number stream, see rngInit
+ */
+typedef struct {
+    uint64_t s[4];	/**< xoshiro256** state */
+} RNG;
+
+#define READ_BLOCK 262144 /**< Initial buffer size of a READER */
+
+/**
+ * Characters of a READER line or field, not NUL terminated
+ */
+typedef struct {
+    const char *s;	/**< First character */
+    size_t len;		/**< Number of characters */
+} SPAN;
+
+/**
+ * Reads FFP text in large blocks, see readerOpen
+ */
+typedef struct {
+    FILE *fp;		/**< Stream being read */
+    char *buf;		/**< Text read ahead, or the whole mapped file */
+    size_t size;	/**< Allocated size of buf */
+    size_t pos;		/**< Offset of the next unread character in buf */
+    size_t end;		/**< Offset after the last character in buf */
+    long offset;	/**< File offset of buf[0], -1 if fp is not seekable */
+    bool mapped;	/**< buf is a mapping of the file */
+    bool eof;		/**< Nothing more to read from fp */
+    unsigned long lineno; /**< Number of lines read */
+} READER;
+
+#define PIPE_BUFFER_MB 512 /**< Megabytes of a pipe kept in memory, see rewindablePipe */
+
+#define WRITE_BLOCK 262144 /**< Buffer size of a WRITER */
+
+/**
+ * Buffers formatted output, see writerOpen
+ */
+typedef struct {
+    FILE *fp;		/**< Stream written */
+    char *buf;		/**< Text not yet written to fp */
+    size_t len;		/**< Length of the text in buf */
+} WRITER;
+
+#define writeChar(w, c) \
+	do { \
+	    if ((w)->len == WRITE_BLOCK) \
+		writerFlush(w); \
+	    (w)->buf[(w)->len++] = (c); \
+	} while (0) /**<Macro: Writes a character to a WRITER */
 
 /* prototypes */
 unsigned int numCols(FILE * fp);
@@ -32,8 +87,13 @@ void fatal_msg(char *fmt, ...);
 void fatal_at_line(char *fmt, ...);
 void warn_msg(char *fmt, ...);
 void printErrorUsageStr();
+#ifdef FFP_LIBRARY
+void libraryError(char *fmt, va_list args);
+void libraryReturn();
+#endif
 int isRegularFile(FILE * fp);
-FILE *convertPipeToFile(FILE * fp);
+FILE *nextSet(FILE * fp, bool * more);
+FILE *rewindablePipe(FILE * fp);
 int fileno(FILE * fp);
 void randaaword(char *s, int n);
 void * chkcalloc(size_t size, size_t n);
@@ -41,6 +101,33 @@ void * chkmalloc(size_t size, size_t n);
 char * basename (const char *name);
 int dirExists(char * name);
 bool isDirectory(char * fname);
+char **splitArgs(char *name, char *s, int *argc);
+void rngInit(RNG * rng, uint64_t seed);
+uint64_t rngNext(RNG * rng);
+uint32_t rngBelow(RNG * rng, uint32_t n);
+double rngUniform(RNG * rng);
+READER *readerOpen(FILE * fp);
+void readerClose(READER * r);
+void readerRewind(READER * r);
+bool readLine(READER * r, SPAN * line);
+int readerPeek(READER * r);
+size_t readerRead(READER * r, void *dst, size_t n);
+bool nextField(SPAN * line, SPAN * field);
+char *spanCopy(const SPAN * f, char **buf, size_t * size);
+char *spanToString(const SPAN * f, char *s, size_t size);
+bool nextPair(SPAN * line, SPAN * key, unsigned long *val);
+const char *parseUlong(const char *s, const char *end, unsigned long *v);
+const char *parseDouble(const char *s, const char *end, double *v);
+size_t formatUlong(char *s, unsigned long v);
+size_t formatExp(char *s, double v, int precision);
+WRITER *writerOpen(FILE * fp);
+void writerClose(WRITER * w);
+void writerFlush(WRITER * w);
+void writeBytes(WRITER * w, const char *s, size_t n);
+void writeString(WRITER * w, const char *s);
+void writeUlong(WRITER * w, unsigned long v);
+void writeExp(WRITER * w, double v, int precision);
+void writeDouble(WRITER * w, double v);
 
 // For some reason this isn't recognized in the header file
 // even though I can clearly see it in stdio.h
@@ -57,7 +144,12 @@ bool isDirectory(char * fname);
   });
 */
 
+#ifdef FFP_LIBRARY
+/* The library has no usage to print, see libffp.c */
+#define printUsageStr() fatal_msg("Option -h is not available in the library\n");
+#else
 #define printUsageStr() printf(usage_str,PROG_NAME, YEAR, AUTHORS, EMAIL);
+#endif
 
 #define isBase(c) base_values[(unsigned char)(c)]  /**<Macro: Tests if valid nucleotide character */
 #define atgc_to_ry(c) base_rycoded_values[(unsigned char)(c)] /**<Macro: Returns RY class of Nucleotide */
@@ -22,6 +22,10 @@
 #define YEAR    COPY_YEAR
 #define URL	PACKAGE_URL
 #define EMAIL PACKAGE_BUGREPORT
+#ifdef FFP_LIBRARY
+#define printVersion() fatal_msg("Option -v is not available in the library\n");
+#else
 #define printVersion() printf("%s %s\nCopyright (C) %s.\n%s\nWritten by %s.\n%s\n",PROG_NAME,VSTRING,YEAR,URL,AUTHORS,EMAIL);
+#endif
 
 #endif /*_VSTRING_H_*/
@@ -0,0 +1,8 @@
+# Sourced by the tests that need many related sequences: cuts ecoli
+# into pieces of 300 bases, the FASTA files s01, s02, ... in
+# $TMP_DIR, whose names are listed in $TMP_DIR/names.
+
+grep -v '>' ecoli | tr -d '\n' | fold -w 300 | \
+	awk -v d=$TMP_DIR '{ f = sprintf("%s/s%02d", d, NR); \
+		print ">s" NR > f; print > f; print "s" NR > d "/names" }'
+[ $(wc -l < $TMP_DIR/names) -gt 8 ] || cleanup 1
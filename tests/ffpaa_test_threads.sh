@@ -0,0 +1,10 @@
+#!/usr/bin/env bash
+
+echo "ffpaa: Comparing threaded and single threaded counting of files" 2>&1
+for opt in "" -m -d; do
+	diff <( ../src/ffpaa -l 3 $opt -T 2 test?.faa 2> /dev/null ) \
+		<( ../src/ffpaa -l 3 $opt test?.faa 2> /dev/null ) \
+		&> /dev/null || exit 1
+done
+
+exit 0
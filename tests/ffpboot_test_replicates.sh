@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpboot: Comparing -n replicates with separate runs" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 3 *.fna | $BIN/ffpcol > $TMP_DIR/vector
+for s in 4 5 6; do
+	[ $s -gt 4 ] && echo
+	$BIN/ffpboot -s $s $TMP_DIR/vector
+done > $TMP_DIR/runs
+for s in 4 5 6; do
+	$BIN/ffpboot -s $s $TMP_DIR/vector | $BIN/ffprwn | $BIN/ffpjsd
+done > $TMP_DIR/matrices
+diff $TMP_DIR/runs <( $BIN/ffpboot -n 3 -s 4 $TMP_DIR/vector ) \
+	&> /dev/null || cleanup 1
+diff $TMP_DIR/matrices \
+	<( $BIN/ffpboot -n 3 -s 4 $TMP_DIR/vector | $BIN/ffprwn | $BIN/ffpjsd ) \
+	&> /dev/null || cleanup 1
+cleanup 0
@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpcol: Keeping the empty row of a file without features" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+printf ">none\nNNNNNNNN\n" > $TMP_DIR/none.fna
+for f in $TMP_DIR/none.fna test1.fna; do
+	$BIN/ffpry -l 8 $f test2.fna $TMP_DIR/none.fna 2> /dev/null \
+		> $TMP_DIR/kv
+	[ $(wc -l < $TMP_DIR/kv) -eq 3 ] || cleanup 1
+	$BIN/ffpcol $TMP_DIR/kv > $TMP_DIR/dense
+	$BIN/ffpcol -S $TMP_DIR/kv > $TMP_DIR/sparse
+	[ $(wc -l < $TMP_DIR/dense) -eq 3 ] || cleanup 1
+	[ "$(sed -n 4p $TMP_DIR/sparse)" = "0" ] || cleanup 1
+	diff <( $BIN/ffpcol $TMP_DIR/sparse ) $TMP_DIR/dense &> /dev/null || \
+		cleanup 1
+	[ $($BIN/ffprwn $TMP_DIR/dense 2> /dev/null | $BIN/ffpjsd 2> /dev/null | \
+		wc -l) -eq 3 ] || cleanup 1
+done
+cleanup 0
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpcol: Comparing sparse, binary and dense columnar FFPs" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 8 *.fna > $TMP_DIR/kv
+$BIN/ffpcol $TMP_DIR/kv > $TMP_DIR/dense
+$BIN/ffpcol -S $TMP_DIR/kv > $TMP_DIR/sparse
+$BIN/ffpcol -x $TMP_DIR/kv > $TMP_DIR/binary
+[ -s $TMP_DIR/dense ] || cleanup 1
+for f in sparse binary; do
+	diff <( $BIN/ffpcol $TMP_DIR/$f ) $TMP_DIR/dense &> /dev/null || \
+		cleanup 1
+	diff <( $BIN/ffpboot -n 3 -s 4 $TMP_DIR/$f | $BIN/ffpcol ) \
+		<( $BIN/ffpboot -n 3 -s 4 $TMP_DIR/dense ) &> /dev/null || \
+		cleanup 1
+	diff <( $BIN/ffpjsd -i $TMP_DIR/$f ) \
+		<( $BIN/ffpjsd -i $TMP_DIR/dense ) &> /dev/null || cleanup 1
+done
+diff <( $BIN/ffprwn $TMP_DIR/sparse | $BIN/ffpjsd ) \
+	<( $BIN/ffprwn $TMP_DIR/dense | $BIN/ffpjsd ) &> /dev/null || cleanup 1
+cleanup 0
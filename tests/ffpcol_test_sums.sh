@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpcol: Comparing row sums of key value and columnar FFPs" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+for opt in "" -d; do
+	$BIN/ffpry $opt -l 4 *.fna > $TMP_DIR/kv
+	awk '{ s = 0; for (i = 2; i <= NF; i += 2) s += $i; print s }' \
+		$TMP_DIR/kv > $TMP_DIR/kvsums
+	$BIN/ffpcol $opt $TMP_DIR/kv | \
+		awk '{ s = 0; for (i = 1; i <= NF; i++) s += $i; print s }' \
+		> $TMP_DIR/colsums
+	[ -s $TMP_DIR/colsums ] || cleanup 1
+	diff $TMP_DIR/kvsums $TMP_DIR/colsums &> /dev/null || cleanup 1
+done
+cleanup 0
@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpcol: Comparing shards columnized with a shared vocabulary" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 6 test1.fna test2.fna > $TMP_DIR/kv1
+$BIN/ffpry -l 6 test3.fna > $TMP_DIR/kv2
+$BIN/ffpcol -e $TMP_DIR/kv1 > $TMP_DIR/v1
+$BIN/ffpcol -e $TMP_DIR/kv2 > $TMP_DIR/v2
+$BIN/ffpcol -e $TMP_DIR/v1 $TMP_DIR/v2 > $TMP_DIR/vocab
+[ -s $TMP_DIR/vocab ] || cleanup 1
+sort -c $TMP_DIR/vocab &> /dev/null || cleanup 1
+diff <( $BIN/ffpcol -e $TMP_DIR/kv1 $TMP_DIR/kv2 ) $TMP_DIR/vocab \
+	&> /dev/null || cleanup 1
+cat $TMP_DIR/kv1 $TMP_DIR/kv2 | $BIN/ffpcol -k $TMP_DIR/vocab \
+	> $TMP_DIR/all
+cat <( $BIN/ffpcol -k $TMP_DIR/vocab $TMP_DIR/kv1 ) \
+	<( $BIN/ffpcol -k $TMP_DIR/vocab $TMP_DIR/kv2 ) > $TMP_DIR/shards
+diff $TMP_DIR/all $TMP_DIR/shards &> /dev/null || cleanup 1
+diff <( $BIN/ffpjsd -i $TMP_DIR/all ) \
+	<( cat $TMP_DIR/kv1 $TMP_DIR/kv2 | $BIN/ffpcol | $BIN/ffpjsd -i ) \
+	&> /dev/null || cleanup 1
+# sparse and binary FFPs have no keys to look up
+$BIN/ffpcol -S $TMP_DIR/kv1 > $TMP_DIR/sparse
+$BIN/ffpcol -k $TMP_DIR/vocab $TMP_DIR/sparse &> /dev/null && cleanup 1
+$BIN/ffpcol -x $TMP_DIR/kv1 > $TMP_DIR/binary
+$BIN/ffpcol -k $TMP_DIR/vocab $TMP_DIR/binary &> /dev/null && cleanup 1
+cleanup 0
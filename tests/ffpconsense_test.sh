@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpconsense: Comparing consensus trees of the phylip consense example" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+cat > $TMP_DIR/intree <<END
+(A,(B,(H,(D,(J,(((G,E),(F,I)),C))))));
+(A,(B,(D,((J,H),(((G,E),(F,I)),C)))));
+(A,(B,(D,(H,(J,(((G,E),(F,I)),C))))));
+(A,(B,(E,(G,((F,I),((J,(H,D)),C))))));
+(A,(B,(E,(G,((F,I),(((J,H),D),C))))));
+(A,(B,(E,((F,I),(G,((J,(H,D)),C))))));
+(A,(B,(E,((F,I),(G,(((J,H),D),C))))));
+(A,(B,(E,((G,(F,I)),((J,(H,D)),C)))));
+(A,(B,(E,((G,(F,I)),(((J,H),D),C)))));
+END
+cat > $TMP_DIR/majority <<END
+(A:100.0,B:100.0,((((H:100.0,D:100.0,J:100.0):66.7,C:100.0):66.7,
+G:100.0,(F:100.0,I:100.0):100.0):66.7,E:100.0):100.0);
+END
+cat > $TMP_DIR/extended <<END
+(A:100.0,B:100.0,((((((H:100.0,J:100.0):44.4,D:100.0):66.7,
+C:100.0):66.7,(F:100.0,I:100.0):100.0):22.2,G:100.0):66.7,
+E:100.0):100.0);
+END
+cat > $TMP_DIR/reference <<END
+(A,(B,(H,(D,(J,(((G,E)33.3,(F,I)100.0)33.3,C)33.3)22.2)11.1)100.0)100.0);
+END
+head -1 $TMP_DIR/intree > $TMP_DIR/tree
+diff $TMP_DIR/majority <( $BIN/ffpconsense $TMP_DIR/intree ) \
+	&> /dev/null || cleanup 1
+diff $TMP_DIR/extended <( $BIN/ffpconsense -e < $TMP_DIR/intree ) \
+	&> /dev/null || cleanup 1
+diff $TMP_DIR/reference <( $BIN/ffpconsense -r $TMP_DIR/tree $TMP_DIR/intree ) \
+	&> /dev/null || cleanup 1
+cleanup 0
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_FILE
+exit $1
+}
+
+
+echo "ffpfilt: Comparing stdin in memory and spilled vs file arg input" 2>&1 
+TMP_FILE=$(mktemp)
+BIN=../src
+$BIN/ffpry -l 6 test[1-3].fna > $TMP_FILE
+for size in 512 0; do
+	diff <( cat $TMP_FILE | MAX_PIPE_BUFFER=$size $BIN/ffpfilt -e -u 0.9 ) \
+		<( $BIN/ffpfilt -e -u 0.9 $TMP_FILE ) &> /dev/null || cleanup 1
+done
+
+
+cleanup 0
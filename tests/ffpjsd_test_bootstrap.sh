@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpjsd: Comparing -W replicates with ffpboot -n" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 3 *.fna | $BIN/ffpcol > $TMP_DIR/vector
+$BIN/ffpjsd -d 6 -W 3 -Q 4 $TMP_DIR/vector > $TMP_DIR/fused
+[ -s $TMP_DIR/fused ] || cleanup 1
+diff $TMP_DIR/fused \
+	<( $BIN/ffpboot -n 3 -s 4 $TMP_DIR/vector | $BIN/ffpjsd -d 6 -i ) \
+	&> /dev/null || cleanup 1
+for m in -j -L; do
+	diff <( $BIN/ffpjsd $m -W 3 -Q 4 $TMP_DIR/vector ) \
+		<( $BIN/ffpboot -n 3 -s 4 $TMP_DIR/vector | $BIN/ffprwn | \
+		$BIN/ffpjsd $m ) &> /dev/null || cleanup 1
+done
+cleanup 0
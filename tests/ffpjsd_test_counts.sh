@@ -0,0 +1,16 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_FILE
+exit $1
+}
+
+echo "ffpjsd: Comparing raw count JSD with row normalized JSD" 2>&1
+TMP_FILE=$(mktemp)
+BIN=../src
+$BIN/ffpry -l 4 test{1,2,3}.fna | $BIN/ffpcol > $TMP_FILE
+diff <( $BIN/ffpjsd -i $TMP_FILE ) \
+	<( $BIN/ffprwn -d 12 $TMP_FILE | $BIN/ffpjsd ) &> /dev/null || cleanup 1
+diff <( $BIN/ffpjsd -i -r 2 $TMP_FILE ) \
+	<( $BIN/ffprwn -d 12 $TMP_FILE | $BIN/ffpjsd -r 2 ) &> /dev/null || cleanup 1
+cleanup 0
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_FILE
+exit $1
+}
+
+echo "ffpjsd: Comparing single and double precision matrices" 2>&1
+TMP_FILE=$(mktemp)
+BIN=../src
+$BIN/ffpry -l 4 test{1,2,3}.fna | $BIN/ffpcol | $BIN/ffprwn > $TMP_FILE
+diff <( $BIN/ffpjsd -z $TMP_FILE ) <( $BIN/ffpjsd $TMP_FILE ) &> /dev/null \
+	|| cleanup 1
+diff <( $BIN/ffpjsd -z -e $TMP_FILE ) <( $BIN/ffpjsd -e $TMP_FILE ) \
+	&> /dev/null || cleanup 1
+diff <( $BIN/ffpjsd -z -r 2 $TMP_FILE ) <( $BIN/ffpjsd -r 2 $TMP_FILE ) \
+	&> /dev/null || cleanup 1
+cleanup 0
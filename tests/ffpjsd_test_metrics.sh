@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_FILE $TMP_DIR
+exit $1
+}
+
+echo "ffpjsd: Comparing -X metrics with single metric matrices" 2>&1
+TMP_FILE=$(mktemp)
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 4 test{1,2,3}.fna | $BIN/ffpcol | $BIN/ffprwn > $TMP_FILE
+$BIN/ffpjsd -X jsd,cosine,jaccard,euclid,pearson -O $TMP_DIR/m $TMP_FILE || cleanup 1
+diff $TMP_DIR/m.jsd <( $BIN/ffpjsd $TMP_FILE ) &> /dev/null || cleanup 1
+diff $TMP_DIR/m.cosine <( $BIN/ffpjsd -c $TMP_FILE ) &> /dev/null || cleanup 1
+diff $TMP_DIR/m.jaccard <( $BIN/ffpjsd -j $TMP_FILE ) &> /dev/null || cleanup 1
+diff $TMP_DIR/m.euclid <( $BIN/ffpjsd -e $TMP_FILE ) &> /dev/null || cleanup 1
+diff $TMP_DIR/m.pearson <( $BIN/ffpjsd -R $TMP_FILE ) &> /dev/null || cleanup 1
+# each set of rows has its own files, with its taxa names
+$BIN/ffpry -l 4 test{1,2}.fna | $BIN/ffpcol | $BIN/ffprwn > $TMP_DIR/two
+printf "a\nb\nc\n" > $TMP_DIR/names
+{ cat $TMP_FILE; echo; cat $TMP_DIR/two; } | \
+	$BIN/ffpjsd -X jsd,cosine -p $TMP_DIR/names -O $TMP_DIR/s || cleanup 1
+[ -e $TMP_DIR/s.jsd ] && cleanup 1
+diff $TMP_DIR/s.jsd.1 <( $BIN/ffpjsd -p $TMP_DIR/names $TMP_FILE ) &> /dev/null || \
+	cleanup 1
+diff $TMP_DIR/s.cosine.2 <( $BIN/ffpjsd -c -p $TMP_DIR/names $TMP_DIR/two ) \
+	&> /dev/null || cleanup 1
+cleanup 0
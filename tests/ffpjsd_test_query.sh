@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_FILE $DB_FILE
+exit $1
+}
+
+echo "ffpjsd: Comparing database queries with -r rows" 2>&1
+TMP_FILE=$(mktemp)
+DB_FILE=$(mktemp)
+BIN=../src
+$BIN/ffpry -l 3 test{1,2,3}.fna | $BIN/ffpcol | $BIN/ffprwn > $TMP_FILE
+$BIN/ffpjsd -F $DB_FILE $TMP_FILE || cleanup 1
+diff <( for r in $( seq $(wc -l < $TMP_FILE) ); do $BIN/ffpjsd -d 12 -r $r $TMP_FILE; done ) \
+	<( $BIN/ffpjsd -d 12 -T 2 -f $DB_FILE $TMP_FILE ) &> /dev/null || cleanup 1
+diff <( cat $TMP_FILE | $BIN/ffpjsd -d 12 -f $DB_FILE ) \
+	<( $BIN/ffpjsd -d 12 -f $DB_FILE $TMP_FILE ) &> /dev/null || cleanup 1
+cleanup 0
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpmerge: Merging a (key,value) FFP read from a pipe" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 4 test1.fna test2.fna > $TMP_DIR/kv
+$BIN/ffpmerge -k $TMP_DIR/kv > $TMP_DIR/file || cleanup 1
+$BIN/ffpry -l 4 test1.fna test2.fna | $BIN/ffpmerge -k > $TMP_DIR/pipe || \
+	cleanup 1
+cat $TMP_DIR/kv | $BIN/ffpmerge -k - > $TMP_DIR/dash || cleanup 1
+[ -s $TMP_DIR/file ] || cleanup 1
+cmp -s $TMP_DIR/file $TMP_DIR/pipe || cleanup 1
+cmp -s $TMP_DIR/file $TMP_DIR/dash || cleanup 1
+cleanup 0
@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffprun: Comparing the in-process driver with the pipeline" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+for opts in "-l 5||||" "-l 8 -r||-n|-d 4|-n" "-l 4 -d|-d|-d 5||-j3"; do
+	IFS='|' read ry col rwn jsd tree <<< "$opts"
+	$BIN/ffpry $ry $TMP_DIR/s?? | $BIN/ffpcol $col | $BIN/ffprwn $rwn | \
+		$BIN/ffpjsd $jsd -p $TMP_DIR/names | \
+		$BIN/ffptree $tree > $TMP_DIR/pipe 2> /dev/null
+	$BIN/ffprun --ry="$ry" --col="$col" --rwn="$rwn" \
+		--jsd="$jsd -p $TMP_DIR/names" --tree="$tree" $TMP_DIR/s?? \
+		> $TMP_DIR/run 2> /dev/null || cleanup 1
+	[ -s $TMP_DIR/run ] || cleanup 1
+	cmp -s $TMP_DIR/pipe $TMP_DIR/run || cleanup 1
+done
+# a file without features keeps its row, in step with the names
+printf ">none\nNNNNNNNN\n" > $TMP_DIR/none
+files="$TMP_DIR/s01 $TMP_DIR/none $(ls $TMP_DIR/s?? | tail -n +2)"
+{ echo s1; echo none; tail -n +2 $TMP_DIR/names; } > $TMP_DIR/nonames
+$BIN/ffpry -l 5 $files 2> /dev/null | $BIN/ffpcol | $BIN/ffprwn 2> /dev/null | \
+	$BIN/ffpjsd -p $TMP_DIR/nonames 2> /dev/null | \
+	$BIN/ffptree > $TMP_DIR/pipe 2> /dev/null
+$BIN/ffprun --ry="-l 5" --jsd="-p $TMP_DIR/nonames" $files \
+	> $TMP_DIR/run 2> /dev/null || cleanup 1
+grep -q none $TMP_DIR/run || cleanup 1
+cmp -s $TMP_DIR/pipe $TMP_DIR/run || cleanup 1
+# too few names is an error, not a tree with stale names
+head -n 3 $TMP_DIR/names > $TMP_DIR/few
+$BIN/ffprun --jsd="-p $TMP_DIR/few" $TMP_DIR/s?? &> /dev/null && cleanup 1
+# the sequences of one file need names of their own with -m
+cat $TMP_DIR/s01 $TMP_DIR/s02 $TMP_DIR/s03 > $TMP_DIR/multi.fna
+head -n 3 $TMP_DIR/names > $TMP_DIR/three
+$BIN/ffprun --ry="-l 5 -m" $TMP_DIR/multi.fna &> /dev/null && cleanup 1
+$BIN/ffpry -l 5 -m $TMP_DIR/multi.fna 2> /dev/null | $BIN/ffpcol | \
+	$BIN/ffprwn 2> /dev/null | $BIN/ffpjsd -p $TMP_DIR/three 2> /dev/null | \
+	$BIN/ffptree > $TMP_DIR/pipe 2> /dev/null
+$BIN/ffprun --ry="-l 5 -m" --jsd="-p $TMP_DIR/three" $TMP_DIR/multi.fna \
+	> $TMP_DIR/run 2> /dev/null || cleanup 1
+cmp -s $TMP_DIR/pipe $TMP_DIR/run || cleanup 1
+cleanup 0
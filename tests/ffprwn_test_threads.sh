@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffprwn: Comparing threaded and single threaded normalization" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+$BIN/ffpry -l 3 *.fna | $BIN/ffpcol > $TMP_DIR/vector
+$BIN/ffpboot -n 3 -s 4 $TMP_DIR/vector > $TMP_DIR/sets
+for opt in "" -n; do
+	for f in vector sets; do
+		diff <( $BIN/ffprwn $opt $TMP_DIR/$f 2>&1 ) \
+			<( cat $TMP_DIR/$f | $BIN/ffprwn -T 3 $opt 2>&1 ) \
+			&> /dev/null || cleanup 1
+	done
+done
+[ $(grep -c '^$' <( $BIN/ffprwn -n $TMP_DIR/sets )) -eq 2 ] || cleanup 1
+cleanup 0
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffpry: Comparing threaded and single threaded counting of files" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+$BIN/ffpry -l 5 test1.fna | tr '\t' '\n' | awk 'NR % 2' | \
+	head -20 > $TMP_DIR/features
+for opt in "" -m "-f $TMP_DIR/features" "-d -w 10111"; do
+	diff <( $BIN/ffpry -l 5 $opt -T 3 $TMP_DIR/s?? test?.fna 2> /dev/null ) \
+		<( $BIN/ffpry -l 5 $opt $TMP_DIR/s?? test?.fna 2> /dev/null ) \
+		&> /dev/null || cleanup 1
+done
+# Standard input is read in its turn
+diff <( $BIN/ffpry -l 5 -T 3 test1.fna - test2.fna < test3.fna ) \
+	<( $BIN/ffpry -l 5 test1.fna test3.fna test2.fna ) \
+	&> /dev/null || cleanup 1
+cleanup 0
@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffptree: Comparing trees from binary and text matrices" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+$BIN/ffpry -l 5 $TMP_DIR/s?? | $BIN/ffpcol | $BIN/ffprwn > $TMP_DIR/ffp
+$BIN/ffpjsd -x -p $TMP_DIR/names $TMP_DIR/ffp > $TMP_DIR/binary
+$BIN/ffpjsd -d 17 -p $TMP_DIR/names $TMP_DIR/ffp > $TMP_DIR/text
+for opt in "" -n; do
+	$BIN/ffptree -q $opt $TMP_DIR/binary > $TMP_DIR/t1 2> /dev/null || \
+		cleanup 1
+	$BIN/ffptree -q $opt $TMP_DIR/text > $TMP_DIR/t2 2> /dev/null
+	[ -s $TMP_DIR/t1 ] || cleanup 1
+	cmp -s $TMP_DIR/t1 $TMP_DIR/t2 || cleanup 1
+done
+cleanup 0
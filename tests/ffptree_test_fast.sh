@@ -0,0 +1,24 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+# Lists each taxon and internal branch with its length, which
+# does not depend on where the unrooted tree is written from.
+function edges() {
+tr -d '\n;' | tr ',()' '\n\n\n' | grep -v '^$' | sort
+}
+
+echo "ffptree: Comparing bounded and exhaustive neighbor joining" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+$BIN/ffpry -l 5 $TMP_DIR/s?? | $BIN/ffpcol | $BIN/ffprwn | \
+	$BIN/ffpjsd -x -p $TMP_DIR/names > $TMP_DIR/matrix
+[ $(wc -l < $TMP_DIR/names) -gt 8 ] || cleanup 1
+diff <( $BIN/ffptree -q -w 4 -f $TMP_DIR/matrix 2> /dev/null | edges ) \
+	<( $BIN/ffptree -q -w 4 $TMP_DIR/matrix 2> /dev/null | edges ) \
+	&> /dev/null || cleanup 1
+cleanup 0
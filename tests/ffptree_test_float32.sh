@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffptree: Comparing single precision trees with a known tree" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+# the distances of the tree (B:2,(C:3,(D:2,E:1):2):1,A:1), in eighths,
+# which single precision holds exactly
+awk 'BEGIN { n = split("A B C D E", t, " ");
+	split("0 3 5 6 5 3 0 6 7 6 5 6 0 7 6 6 7 7 0 3 5 6 6 3 0", d, " ");
+	print n;
+	for (i = 1; i <= n; i++) {
+		printf "%-50s", t[i];
+		for (j = 1; j <= n; j++)
+			printf "%.3e ", d[(i - 1) * n + j] / 8;
+		printf "\n" } }' > $TMP_DIR/matrix
+cat > $TMP_DIR/known << EOF2
+(B:2.50000000e-01,(C:3.75000000e-01,(D:2.50000000e-01,E:1.25000000e-01):2.50000000e-01):1.25000000e-01,
+A:1.25000000e-01);
+EOF2
+$BIN/ffptree -q -z $TMP_DIR/matrix > $TMP_DIR/tree 2> /dev/null || cleanup 1
+diff $TMP_DIR/tree $TMP_DIR/known &> /dev/null || cleanup 1
+diff <( $BIN/ffptree -q $TMP_DIR/matrix 2> /dev/null ) $TMP_DIR/known \
+	&> /dev/null || cleanup 1
+# UPGMA joins the same pairs in single precision
+diff <( $BIN/ffptree -q -n -z $TMP_DIR/matrix 2> /dev/null | \
+	sed 's/:[-0-9.e+]*//g' ) \
+	<( $BIN/ffptree -q -n $TMP_DIR/matrix 2> /dev/null | \
+	sed 's/:[-0-9.e+]*//g' ) &> /dev/null || cleanup 1
+cleanup 0
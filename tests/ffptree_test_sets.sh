@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffptree: Comparing parallel and sequential joining of sets" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+$BIN/ffpry -l 5 $TMP_DIR/s?? | $BIN/ffpcol | $BIN/ffprwn | \
+	$BIN/ffpjsd -x -p $TMP_DIR/names > $TMP_DIR/matrix
+[ $(wc -l < $TMP_DIR/names) -gt 8 ] || cleanup 1
+cat $TMP_DIR/matrix $TMP_DIR/matrix $TMP_DIR/matrix > $TMP_DIR/sets
+for opt in "" -n; do
+	diff <( $BIN/ffptree -j5 -m -T 2 $opt $TMP_DIR/sets 2>&1 ) \
+		<( $BIN/ffptree -j5 -m $opt $TMP_DIR/sets 2>&1 ) \
+		&> /dev/null || cleanup 1
+done
+cleanup 0
@@ -0,0 +1,20 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffptree: Comparing multithreaded and single threaded joining" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+$BIN/ffpry -l 5 $TMP_DIR/s?? | $BIN/ffpcol | $BIN/ffprwn | \
+	$BIN/ffpjsd -x -p $TMP_DIR/names > $TMP_DIR/matrix
+[ $(wc -l < $TMP_DIR/names) -gt 8 ] || cleanup 1
+for opt in "" -n; do
+	diff <( $BIN/ffptree -q $opt -T 3 $TMP_DIR/matrix 2> /dev/null ) \
+		<( $BIN/ffptree -q $opt $TMP_DIR/matrix 2> /dev/null ) \
+		&> /dev/null || cleanup 1
+done
+cleanup 0
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "ffptree: Comparing UPGMA trees with those of the closest pair scan" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+. ./ecoli_pieces.sh
+$BIN/ffpry -l 5 $TMP_DIR/s?? | $BIN/ffpcol | $BIN/ffprwn | \
+	$BIN/ffpjsd -p $TMP_DIR/names > $TMP_DIR/matrix
+# the tree built by the closest pair scan before upgmaChain
+cat > $TMP_DIR/known << EOF2
+((((s1:5.15000000e-03,s5:5.15000000e-03):4.20000000e-03,(s7:4.41000000e-03,
+s8:4.41000000e-03):4.94000000e-03):6.37500000e-04,(s4:5.95000000e-03,
+s9:5.95000000e-03):4.03750000e-03):4.13472222e-03,((s2:6.90000000e-03,
+s11:6.90000000e-03):4.91875000e-03,(((s3:3.78000000e-03,s10:3.78000000e-03):1.18000000e-03,
+s12:4.96000000e-03):2.15833333e-03,s6:7.11833333e-03):4.70041667e-03):2.30347222e-03);
+EOF2
+for opt in "" -y; do
+	$BIN/ffptree -q -n $opt $TMP_DIR/matrix > $TMP_DIR/tree 2> /dev/null || \
+		cleanup 1
+	diff $TMP_DIR/tree $TMP_DIR/known &> /dev/null || cleanup 1
+done
+cleanup 0
@@ -0,0 +1,355 @@
+/*****************************************************
+* This code is distributed under a Non-commercial use
+* license.  For details see LICENSE.  Use of this
+* code must be properly attributed to its author
+* Gregory E. Sims provided that its use or derivative
+* use is non-commercial in nature.  Proper attribution
+* can be made by citing:
+*
+* Sims GE, et al (2009) Alignment-free genome
+* comparison with feature frequency profiles (FFP) and
+* optimal resolutions. Proc. Natl. Acad. Sci. USA.
+* 106, 2677-82.
+*
+* Gregory E. Sims (C) 2010-2012
+*
+*****************************************************/
+/* LIBFFP_TEST.C */
+#define _POSIX_C_SOURCE  200809L  // To use strdup
+
+/*
+ * A client of libffp for libffp_test.sh, which compares its
+ * output with the pipeline
+ *
+ *   libffp_test count LEN FILE...        ffpry -l LEN FILE...
+ *   libffp_test rows LEN FILE...         ... | ffpcol | ffprwn
+ *   libffp_test jsd LEN FILE...          ... | ffpjsd
+ *   libffp_test tree LEN NAMES FILE...   ... | ffpjsd -p NAMES | ffptree
+ *   libffp_test threads LEN NAMES FILE...
+ *
+ * The text of the files is counted in small pieces.  With
+ * threads, THREADS threads build the tree at once, each with
+ * counters of its own and pieces of another size, and the tree
+ * is printed once if all of them agree.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "ffp.h"
+
+#define PIECE 7  /**< Size of the pieces of text counted */
+#define PRECISION 2  /**< Decimals of ffprwn and ffpjsd without -d */
+#define THREADS 4  /**< Threads building the tree at once */
+#define NAMELEN 256  /**< Longest taxa name read */
+
+
+/* The input, shared by all threads */
+
+int length;	/**< Feature length */
+int files;	/**< Number of files */
+char **texts;	/**< Text of each file */
+size_t *sizes;	/**< Size of each text */
+char **names;	/**< Taxa names, one per row */
+
+
+/** The tree of a thread and its counting, see treeWorker */
+
+typedef struct {
+    size_t piece;	/**< Size of the pieces of text */
+    char *tree;		/**< The Newick tree built */
+} TREEWORK;
+
+
+/* Function prototypes */
+
+static void fail(const char *what);
+static void readTexts(char **argv);
+static void readNames(char *file);
+static void countText(FFP_COUNTER * c, int i, size_t piece);
+static FFP_SET *countSet(size_t piece);
+static char *buildTree(size_t piece);
+static void *treeWorker(void *arg);
+
+
+
+int main(int argc, char **argv)
+{
+    FFP_COUNTER *c;
+    FFP_SET *s;
+    TREEWORK work[THREADS];
+    pthread_t tid[THREADS];
+    const uint32_t *cols;
+    const double *vals;
+    char **keys;
+    unsigned *v;
+    unsigned n, k;
+    uint32_t rows, cmax, r, i;
+    int64_t m, e;
+    double *D;
+    char *tree;
+    int f, t;
+
+    if (argc < 4)
+	fail("Usage: libffp_test count|rows|jsd|tree|threads LEN [NAMES] FILE...");
+    length = atoi(argv[2]);
+
+    if (!strcmp(argv[1], "count")) {
+	readTexts(argv + 3);
+	if ((c = ffpCounterNew(length, true, true, false)) == NULL)
+	    fail(ffpError());
+	for (f = 0; f < files; f++) {
+	    countText(c, f, PIECE);
+	    while (ffpProfile(c, &keys, &v, &n)) {
+		for (k = 0; k < n; k++) {
+		    printf("%s\t%u%c", keys[k], v[k], k + 1 < n ? '\t' : '\n');
+		    free(keys[k]);
+		}
+		if (n == 0)
+		    putchar('\n');
+		free(keys);
+		free(v);
+	    }
+	}
+	ffpCounterFree(c);
+
+    } else if (!strcmp(argv[1], "rows")) {
+	readTexts(argv + 3);
+	s = countSet(PIECE);
+	if (ffpNormalize(s, false, PRECISION))
+	    fail(ffpError());
+	// as many columns as features, the last column of a row at most
+	for (cmax = 0, r = 0; r < (uint32_t) files; r++) {
+	    if ((m = ffpSetRow(s, r, &cols, &vals)) < 0)
+		fail(ffpError());
+	    if (m > 0 && cols[m - 1] + 1 > cmax)
+		cmax = cols[m - 1] + 1;
+	}
+	for (r = 0; r < (uint32_t) files; r++) {
+	    m = ffpSetRow(s, r, &cols, &vals);
+	    for (i = 0, e = 0; i < cmax; i++)
+		printf("%.*e%c", PRECISION, e < m && cols[e] == i ?
+		       vals[e++] : 0.0, i + 1 < cmax ? '\t' : '\n');
+	}
+	ffpSetFree(s);
+
+    } else if (!strcmp(argv[1], "jsd")) {
+	readTexts(argv + 3);
+	s = countSet(PIECE);
+	rows = (uint32_t) files;
+	if (ffpNormalize(s, false, PRECISION) ||
+	    (D = ffpDistances(s)) == NULL)
+	    fail(ffpError());
+	for (r = 0; r < rows; r++) {
+	    for (i = 0; i < rows; i++)
+		printf("%.*e ", PRECISION, D[(size_t) r * rows + i]);
+	    putchar('\n');
+	}
+	free(D);
+	ffpSetFree(s);
+
+    } else if (!strcmp(argv[1], "tree") && argc > 4) {
+	readNames(argv[3]);
+	readTexts(argv + 4);
+	tree = buildTree(PIECE);
+	fputs(tree, stdout);
+	free(tree);
+
+    } else if (!strcmp(argv[1], "threads") && argc > 4) {
+	readNames(argv[3]);
+	readTexts(argv + 4);
+	for (t = 0; t < THREADS; t++) {
+	    work[t].piece = PIECE + 13 * t;
+	    if ((errno = pthread_create(&tid[t], NULL, treeWorker, &work[t])))
+		fail(strerror(errno));
+	}
+	for (t = 0; t < THREADS; t++)
+	    pthread_join(tid[t], NULL);
+	for (t = 1; t < THREADS; t++)
+	    if (strcmp(work[t].tree, work[0].tree))
+		fail("The trees of the threads differ");
+	fputs(work[0].tree, stdout);
+	for (t = 0; t < THREADS; t++)
+	    free(work[t].tree);
+
+    } else
+	fail("Usage: libffp_test count|rows|jsd|tree|threads LEN [NAMES] FILE...");
+
+    for (f = 0; f < files; f++)
+	free(texts[f]);
+    free(texts);
+    free(sizes);
+    return EXIT_SUCCESS;
+}
+
+
+
+/**
+ * Ends the test with a message
+ *
+ * @param what The message
+ * @return None
+ */
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "libffp_test: %s\n", what);
+    exit(EXIT_FAILURE);
+}
+
+
+
+/**
+ * Reads the text of the files into texts and sizes
+ *
+ * @param argv The file names, up to a NULL
+ * @return None
+ */
+
+static void readTexts(char **argv)
+{
+    FILE *fp;
+    size_t nr;
+
+    for (files = 0; argv[files]; files++);
+    if ((texts = (char **) calloc(files, sizeof(char *))) == NULL ||
+	(sizes = (size_t *) calloc(files, sizeof(size_t))) == NULL)
+	fail(strerror(ENOMEM));
+
+    for (files = 0; argv[files]; files++) {
+	if ((fp = fopen(argv[files], "r")) == NULL)
+	    fail(strerror(errno));
+	do {
+	    if ((texts[files] = (char *) realloc(texts[files],
+				sizes[files] + BUFSIZ)) == NULL)
+		fail(strerror(ENOMEM));
+	    nr = fread(texts[files] + sizes[files], 1, BUFSIZ, fp);
+	    sizes[files] += nr;
+	} while (nr == BUFSIZ);
+	fclose(fp);
+    }
+}
+
+
+
+/**
+ * Reads the taxa names, one per line, into names
+ *
+ * @param file The file of names, as of ffpjsd -p
+ * @return None
+ */
+
+static void readNames(char *file)
+{
+    FILE *fp;
+    char buffer[NAMELEN];
+    int n = 0;
+
+    if ((fp = fopen(file, "r")) == NULL)
+	fail(strerror(errno));
+    while (fscanf(fp, "%255s", buffer) == 1) {
+	if ((names = (char **) realloc(names, sizeof(char *) * (n + 1))) == NULL ||
+	    (names[n] = strdup(buffer)) == NULL)
+	    fail(strerror(ENOMEM));
+	n++;
+    }
+    fclose(fp);
+}
+
+
+
+/**
+ * Counts the text of a file in pieces
+ *
+ * @param c The counter
+ * @param i The file
+ * @param piece Size of the pieces
+ * @return None
+ */
+
+static void countText(FFP_COUNTER * c, int i, size_t piece)
+{
+    size_t at;
+
+    for (at = 0; at < sizes[i]; at += piece)
+	if (ffpCount(c, texts[i] + at,
+		     sizes[i] - at < piece ? sizes[i] - at : piece))
+	    fail(ffpError());
+    if (ffpCountEnd(c))
+	fail(ffpError());
+}
+
+
+
+/**
+ * Counts the files into a set, one row per file
+ *
+ * @param piece Size of the pieces of text
+ * @return The set
+ */
+
+static FFP_SET *countSet(size_t piece)
+{
+    FFP_COUNTER *c;
+    FFP_SET *s;
+    char **keys;
+    unsigned *v;
+    unsigned n;
+    int f;
+
+    if ((c = ffpCounterNew(length, true, true, false)) == NULL ||
+	(s = ffpSetNew(true)) == NULL)
+	fail(ffpError());
+    for (f = 0; f < files; f++) {
+	countText(c, f, piece);
+	while (ffpProfile(c, &keys, &v, &n))
+	    if (ffpSetAdd(s, keys, v, n) == 0)
+		fail(ffpError());
+    }
+    ffpCounterFree(c);
+    return s;
+}
+
+
+
+/**
+ * Builds the Newick tree of the files
+ *
+ * @param piece Size of the pieces of text
+ * @return The tree
+ */
+
+static char *buildTree(size_t piece)
+{
+    FFP_SET *s = countSet(piece);
+    double *D;
+    char *tree;
+
+    if (ffpNormalize(s, false, PRECISION) ||
+	(D = ffpDistances(s)) == NULL ||
+	(tree = ffpNewick(D, names, (uint32_t) files, PRECISION,
+			  NULL)) == NULL)
+	fail(ffpError());
+    free(D);
+    ffpSetFree(s);
+    return tree;
+}
+
+
+
+/**
+ * Builds the tree in a thread, see TREEWORK
+ *
+ * @param arg The TREEWORK of the thread
+ * @return NULL
+ */
+
+static void *treeWorker(void *arg)
+{
+    TREEWORK *work = (TREEWORK *) arg;
+
+    work->tree = buildTree(work->piece);
+    return NULL;
+}
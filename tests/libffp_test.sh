@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+
+function cleanup() {
+rm -fr $TMP_DIR
+exit $1
+}
+
+echo "libffp: Comparing a client of the library with the pipeline" 2>&1
+TMP_DIR=$(mktemp -d)
+BIN=../src
+export LD_LIBRARY_PATH=$BIN${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}
+. ./ecoli_pieces.sh
+# a file without features keeps its row
+printf ">none\nNNNNNNNN\n" > $TMP_DIR/s99
+echo none >> $TMP_DIR/names
+for l in 4 8; do
+	$BIN/ffpry -l $l $TMP_DIR/s?? 2> /dev/null > $TMP_DIR/kv
+	$BIN/ffpcol $TMP_DIR/kv | $BIN/ffprwn 2> /dev/null > $TMP_DIR/rwn
+	$BIN/ffpjsd $TMP_DIR/rwn > $TMP_DIR/jsd 2> /dev/null
+	$BIN/ffpjsd -p $TMP_DIR/names $TMP_DIR/rwn 2> /dev/null | \
+		$BIN/ffptree > $TMP_DIR/tree 2> /dev/null
+	[ -s $TMP_DIR/tree ] || cleanup 1
+	for test in count:kv rows:rwn jsd:jsd; do
+		./libffp_test ${test%:*} $l $TMP_DIR/s?? 2> /dev/null \
+			> $TMP_DIR/lib || cleanup 1
+		cmp -s $TMP_DIR/${test#*:} $TMP_DIR/lib || cleanup 1
+	done
+	for test in tree threads; do
+		./libffp_test $test $l $TMP_DIR/names $TMP_DIR/s?? \
+			2> /dev/null > $TMP_DIR/lib || cleanup 1
+		cmp -s $TMP_DIR/tree $TMP_DIR/lib || cleanup 1
+	done
+done
+cleanup 0